@@ -0,0 +1,68 @@
+/**
+ * Deinterleave microbenchmark
+ *
+ * Compares the strided per-channel loop DeliverBlocks used to run against
+ * the SIMD kernels in src/deinterleave.cc, and checks they agree.
+ *
+ * Build and run (no N-API or PortAudio needed):
+ *   make -C bench && ./build/bench/deinterleave_bench
+ */
+
+#include "deinterleave.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using Kernel = void (*)(const float*, float* const*, size_t, int);
+
+static double NsPerFrame(Kernel kernel, const std::vector<float>& src, std::vector<float*>& dst,
+                         size_t frames, int channels) {
+    // Size the iteration count so each measurement moves ~256 MB
+    size_t iterations = (64u << 20) / (frames * channels) + 1;
+    kernel(src.data(), dst.data(), frames, channels);   // Warm caches
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t it = 0; it < iterations; it++) {
+        kernel(src.data(), dst.data(), frames, channels);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    return ns / static_cast<double>(iterations * frames);
+}
+
+int main() {
+    const int channelCounts[] = {1, 2, 4, 8, 16, 32, 64};
+    const size_t frameCounts[] = {64, 256, 1024};
+
+    std::printf("%8s %8s %14s %14s %8s\n", "channels", "frames", "scalar ns/f", "simd ns/f", "speedup");
+
+    for (int channels : channelCounts) {
+        for (size_t frames : frameCounts) {
+            std::vector<float> src(frames * channels);
+            for (size_t i = 0; i < src.size(); i++) {
+                src[i] = static_cast<float>(std::rand()) / RAND_MAX - 0.5f;
+            }
+
+            std::vector<std::vector<float>> expected(channels, std::vector<float>(frames));
+            std::vector<std::vector<float>> actual(channels, std::vector<float>(frames));
+            std::vector<float*> expectedPtrs, actualPtrs;
+            for (int ch = 0; ch < channels; ch++) {
+                expectedPtrs.push_back(expected[ch].data());
+                actualPtrs.push_back(actual[ch].data());
+            }
+
+            kernels::DeinterleaveScalar(src.data(), expectedPtrs.data(), frames, channels);
+            kernels::Deinterleave(src.data(), actualPtrs.data(), frames, channels);
+            if (expected != actual) {
+                std::fprintf(stderr, "Mismatch at %d channels, %zu frames\n", channels, frames);
+                return 1;
+            }
+
+            double scalar = NsPerFrame(kernels::DeinterleaveScalar, src, expectedPtrs, frames, channels);
+            double simd = NsPerFrame(kernels::Deinterleave, src, actualPtrs, frames, channels);
+            std::printf("%8d %8zu %14.3f %14.3f %7.2fx\n", channels, frames, scalar, simd, scalar / simd);
+        }
+    }
+    return 0;
+}
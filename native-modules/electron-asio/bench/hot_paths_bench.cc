@@ -0,0 +1,290 @@
+/**
+ * Hot path microbenchmarks (Google Benchmark)
+ *
+ * Covers the per-period work of the stream across 1-64 channels and
+ * 32-2048 frame buffers, using the same N-API-free code the addon runs:
+ *
+ *   CallbackBody      - PaCallback's steady-state sequence: write ring read,
+ *                       meter, InputCapture append/enqueue, stage timing
+ *   Deinterleave      - kernels::Deinterleave
+ *   WriteInterleave   - write(): SpscRing::WriteInterleaved into free space
+ *   CaptureAppend     - InputCapture::Append with the consumer draining
+ *   TsfnEnqueue       - a model of napi_call_threadsafe_function (mutex,
+ *                       queue push, uv_async_send), ungated and behind the
+ *                       wakePending_ gate the stream uses
+ *
+ * Build and run on any platform (no N-API, PortAudio or ASIO needed):
+ *   make -C bench hot_paths.json
+ */
+
+#include <benchmark/benchmark.h>
+#include "callback_profiler.h"
+#include "deinterleave.h"
+#include "input_capture.h"
+#include "level_meter.h"
+#include "spsc_ring.h"
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <vector>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+static void HotPathArgs(benchmark::internal::Benchmark* b) {
+    for (int channels : {1, 2, 8, 16, 32, 64}) {
+        for (int frames : {32, 128, 512, 2048}) {
+            b->Args({channels, frames});
+        }
+    }
+}
+
+static std::vector<float> Signal(size_t samples) {
+    std::vector<float> data(samples);
+    for (size_t i = 0; i < samples; i++) {
+        data[i] = static_cast<float>(std::sin(0.001 * i));
+    }
+    return data;
+}
+
+static void SetCounters(benchmark::State& state, size_t frames, int channels) {
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * frames * channels));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * frames * channels * sizeof(float)));
+    state.counters["ns_per_frame"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * frames),
+        benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+// Model of node's napi_call_threadsafe_function: take the TSFN mutex, push
+// the call, then uv_async_send, which writes the loop's eventfd unless a
+// wakeup is already pending. The consumer side is drained inline.
+class TsfnModel {
+public:
+    TsfnModel() : pending_(false) {
+#if defined(__linux__)
+        fd_ = eventfd(0, EFD_NONBLOCK);
+#endif
+    }
+    ~TsfnModel() {
+#if defined(__linux__)
+        close(fd_);
+#endif
+    }
+
+    void Call(void* data) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(data);
+        }
+        if (!pending_.exchange(true)) {
+#if defined(__linux__)
+            uint64_t one = 1;
+            if (write(fd_, &one, sizeof(one)) < 0) {
+                pending_ = false;
+            }
+#endif
+        }
+    }
+
+    void Drain() {
+        pending_ = false;
+#if defined(__linux__)
+        uint64_t count;
+        if (read(fd_, &count, sizeof(count)) < 0) {
+            count = 0;
+        }
+#endif
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.clear();
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<void*> queue_;
+    std::atomic<bool> pending_;
+#if defined(__linux__)
+    int fd_;
+#endif
+};
+
+// The stream's wake hook: at most one call in flight
+struct GatedWake {
+    TsfnModel tsfn;
+    std::atomic<bool> wakePending{false};
+
+    static void Wake(void* context) {
+        GatedWake* self = static_cast<GatedWake*>(context);
+        if (!self->wakePending.exchange(true)) {
+            self->tsfn.Call(self);
+        }
+    }
+
+    void Drain() {
+        wakePending = false;
+        tsfn.Drain();
+    }
+};
+
+static InputCaptureConfig CaptureConfig(int channels, size_t frames, bool planarBlocks) {
+    InputCaptureConfig config;
+    config.channels = channels;
+    config.blockFrames = frames;
+    config.framesPerDelivery = frames;
+    config.poolBlocks = 18;
+    config.queueDepth = 16;
+    config.planarBlocks = planarBlocks;
+    return config;
+}
+
+static void DrainCapture(InputCapture& capture) {
+    while (AudioBlock* block = capture.Next()) {
+        capture.Release(block);
+    }
+}
+
+static void BM_CallbackBody(benchmark::State& state) {
+    int channels = static_cast<int>(state.range(0));
+    size_t frames = static_cast<size_t>(state.range(1));
+
+    std::vector<float> input = Signal(frames * channels);
+    std::vector<float> playback = Signal(frames * channels);
+    std::vector<float> output(frames * channels);
+
+    SpscRing<float> outputRing;
+    outputRing.Reset(frames * channels * 4);
+    LevelMeter meter;
+    meter.Reset(channels, 48000, 30, 1.0, 20);
+    InputCapture capture;
+    capture.Reset(CaptureConfig(channels, frames, false));
+    GatedWake wake;
+    capture.SetWake(GatedWake::Wake, &wake);
+    CallbackProfiler profiler;
+    profiler.Configure(48000, 0.75);
+
+    for (auto _ : state) {
+        // JS side, untimed: keep the write ring fed and drain input
+        outputRing.Write(playback.data(), frames * channels);
+        DrainCapture(capture);
+        wake.Drain();
+
+        uint64_t start = MonotonicNanos();
+        outputRing.Read(output.data(), frames * channels);
+        uint64_t mark = MonotonicNanos();
+        profiler.Record(ProfileStage::Output, mark - start);
+        meter.Process(input.data(), frames, false);
+        uint64_t now = MonotonicNanos();
+        profiler.Record(ProfileStage::Tap, now - mark);
+        mark = now;
+        uint64_t enqueue = capture.Append(input.data(), frames);
+        now = MonotonicNanos();
+        profiler.Record(ProfileStage::Input, now - mark - enqueue);
+        profiler.Record(ProfileStage::Enqueue, enqueue);
+        uint64_t total = MonotonicNanos() - start;
+        profiler.EndCallback(total, frames);
+        benchmark::DoNotOptimize(output.data());
+        state.SetIterationTime(total * 1e-9);
+    }
+    SetCounters(state, frames, channels);
+}
+BENCHMARK(BM_CallbackBody)->Apply(HotPathArgs)->UseManualTime();
+
+static void BM_Deinterleave(benchmark::State& state) {
+    int channels = static_cast<int>(state.range(0));
+    size_t frames = static_cast<size_t>(state.range(1));
+
+    std::vector<float> src = Signal(frames * channels);
+    std::vector<std::vector<float>> planes(channels, std::vector<float>(frames));
+    std::vector<float*> dst(channels);
+    for (int ch = 0; ch < channels; ch++) {
+        dst[ch] = planes[ch].data();
+    }
+
+    for (auto _ : state) {
+        kernels::Deinterleave(src.data(), dst.data(), frames, channels);
+        benchmark::ClobberMemory();
+    }
+    SetCounters(state, frames, channels);
+}
+BENCHMARK(BM_Deinterleave)->Apply(HotPathArgs);
+
+static void BM_WriteInterleave(benchmark::State& state) {
+    int channels = static_cast<int>(state.range(0));
+    size_t frames = static_cast<size_t>(state.range(1));
+
+    std::vector<std::vector<float>> planes(channels, Signal(frames));
+    std::vector<const float*> src(channels);
+    std::vector<size_t> srcFrames(channels, frames);
+    for (int ch = 0; ch < channels; ch++) {
+        src[ch] = planes[ch].data();
+    }
+
+    // Same headroom as the stream: four periods
+    SpscRing<float> ring;
+    ring.Reset(frames * channels * 4);
+    std::vector<float> sink(frames * channels);
+
+    for (auto _ : state) {
+        size_t written = ring.WriteInterleaved(src.data(), srcFrames.data(), channels, frames);
+        benchmark::DoNotOptimize(written);
+        // The audio thread's read, so the write position keeps wrapping
+        ring.Read(sink.data(), written * channels);
+    }
+    SetCounters(state, frames, channels);
+}
+BENCHMARK(BM_WriteInterleave)->Apply(HotPathArgs);
+
+static void BM_CaptureAppend(benchmark::State& state) {
+    int channels = static_cast<int>(state.range(0));
+    size_t frames = static_cast<size_t>(state.range(1));
+    bool planarBlocks = state.range(2) != 0;
+
+    std::vector<float> input = Signal(frames * channels);
+    InputCapture capture;
+    capture.Reset(CaptureConfig(channels, frames, planarBlocks));
+
+    for (auto _ : state) {
+        uint64_t start = MonotonicNanos();
+        capture.Append(input.data(), frames);
+        state.SetIterationTime((MonotonicNanos() - start) * 1e-9);
+        DrainCapture(capture);
+    }
+    SetCounters(state, frames, channels);
+    state.SetLabel(planarBlocks ? "zero-copy layout" : "interleaved");
+}
+BENCHMARK(BM_CaptureAppend)->Apply([](benchmark::internal::Benchmark* b) {
+    for (int planar : {0, 1}) {
+        for (int channels : {1, 2, 8, 16, 32, 64}) {
+            for (int frames : {32, 128, 512, 2048}) {
+                b->Args({channels, frames, planar});
+            }
+        }
+    }
+})->UseManualTime();
+
+static void BM_TsfnEnqueue(benchmark::State& state) {
+    bool gated = state.range(0) != 0;
+    GatedWake wake;
+    int calls = 0;
+
+    for (auto _ : state) {
+        uint64_t start = MonotonicNanos();
+        if (gated) {
+            GatedWake::Wake(&wake);
+        } else {
+            wake.tsfn.Call(&wake);
+        }
+        state.SetIterationTime((MonotonicNanos() - start) * 1e-9);
+        // The JS thread drains about once per delivery when it keeps up;
+        // draining every 16 calls models a JS thread that is a little behind
+        if (++calls == 16) {
+            wake.Drain();
+            calls = 0;
+        }
+    }
+    state.SetLabel(gated ? "gated by wakePending_" : "every block");
+}
+BENCHMARK(BM_TsfnEnqueue)->Arg(0)->Arg(1)->UseManualTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,126 @@
+/**
+ * IPC transport benchmark
+ *
+ * Compares the 'send' path (Array.from per channel, structured clone of
+ * plain number arrays, Float32Array rebuilt on the far side) with the
+ * 'port' path (Float32Arrays posted on a MessagePort, cloned as raw bytes).
+ *
+ * Runs under plain Node: Electron's IPC serializer is V8's ValueSerializer,
+ * modelled here with v8.serialize, and MessagePortMain behaves like a
+ * worker_threads MessagePort. The receiver runs on a worker so main-thread
+ * time only covers what the main process would spend per block.
+ *
+ *   node bench/ipc_transport_bench.js [blocks]
+ */
+
+'use strict';
+
+const v8 = require('v8');
+const { Worker, MessageChannel, isMainThread, parentPort, workerData } = require('worker_threads');
+
+const SAMPLE_RATE = 48000;
+const FRAMES = 256;
+
+if (!isMainThread) {
+    // Receiver: rebuild Float32Arrays the way asio-preload.js does
+    const { port, mode } = workerData;
+    let received = 0;
+    port.on('message', (message) => {
+        let buffers;
+        if (mode === 'send') {
+            buffers = v8.deserialize(message).buffers.map(arr => new Float32Array(arr));
+        } else {
+            buffers = message.buffers;
+        }
+        if (buffers[0].length !== FRAMES) throw new Error('bad block');
+        received++;
+        if (received === workerData.blocks) {
+            parentPort.postMessage('done');
+        }
+    });
+    return;
+}
+
+// Main-thread CPU needs process.threadCpuUsage (Node 23.9+). Older Node
+// only has process CPU, which includes the receiving worker, so the column
+// is relabelled rather than passed off as main-thread time.
+const HAS_THREAD_CPU = typeof process.threadCpuUsage === 'function';
+
+function threadCpuMs() {
+    const usage = HAS_THREAD_CPU ? process.threadCpuUsage() : process.cpuUsage();
+    return (usage.user + usage.system) / 1000;
+}
+
+function makeBlock(channels) {
+    const buffers = [];
+    for (let ch = 0; ch < channels; ch++) {
+        const buf = new Float32Array(FRAMES);
+        for (let i = 0; i < FRAMES; i++) buf[i] = Math.sin((i + ch) * 0.01);
+        buffers.push(buf);
+    }
+    return buffers;
+}
+
+async function run(mode, channels, blocks) {
+    const { port1, port2 } = new MessageChannel();
+    const worker = new Worker(__filename, {
+        workerData: { port: port2, mode, blocks },
+        transferList: [port2]
+    });
+    const done = new Promise(resolve => worker.once('message', resolve));
+    const inputBuffers = makeBlock(channels);
+
+    const bytes = mode === 'send'
+        ? v8.serialize({ streamId: 'stream_1', buffers: inputBuffers.map(buf => Array.from(buf)) }).length
+        : v8.serialize({ buffers: inputBuffers }).length;
+
+    const start = process.hrtime.bigint();
+    const cpuStart = threadCpuMs();
+    for (let b = 0; b < blocks; b++) {
+        if (mode === 'send') {
+            // ipc-handlers.js: Array.from per channel, then the IPC serializer
+            const serialized = inputBuffers.map(buf => Array.from(buf));
+            port1.postMessage(v8.serialize({ streamId: 'stream_1', buffers: serialized }));
+        } else {
+            port1.postMessage({ buffers: inputBuffers });
+        }
+        // Let the receiver keep up instead of measuring queue growth
+        if (b % 64 === 63) await new Promise(setImmediate);
+    }
+    const mainCpu = threadCpuMs() - cpuStart;
+    await done;
+    const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+
+    await worker.terminate();
+    port1.close();
+
+    return {
+        blocksPerSecond: blocks / seconds,
+        realtime: blocks / seconds / (SAMPLE_RATE / FRAMES),
+        mainUsPerBlock: (mainCpu * 1000) / blocks,
+        bytes
+    };
+}
+
+async function main() {
+    const blocks = parseInt(process.argv[2], 10) || 5000;
+    console.log(`${FRAMES}-frame blocks at ${SAMPLE_RATE} Hz, ${blocks} blocks per run`);
+    if (!HAS_THREAD_CPU) {
+        console.log('process.threadCpuUsage unavailable (Node < 23.9): CPU column is whole-process, ' +
+            'receiver included');
+    }
+    console.log(['channels', 'mode', 'blocks/s', 'x realtime', HAS_THREAD_CPU ? 'main us/blk' : 'proc us/blk',
+        'bytes/blk'].map(s => s.padStart(12)).join(''));
+
+    for (const channels of [2, 16, 64]) {
+        for (const mode of ['send', 'port']) {
+            const r = await run(mode, channels, blocks);
+            console.log([
+                channels, mode, r.blocksPerSecond.toFixed(0), r.realtime.toFixed(1),
+                r.mainUsPerBlock.toFixed(1), r.bytes
+            ].map(v => String(v).padStart(12)).join(''));
+        }
+    }
+}
+
+main();
@@ -0,0 +1,72 @@
+/**
+ * Virtual stream benchmark
+ *
+ * Runs a virtual-device stream (no audio hardware) for a few seconds per
+ * configuration and reports what the realtime and delivery paths cost:
+ * callback stage times, deadline misses and capture-to-JS latency. Works on
+ * any host the addon builds on, so results are comparable between builds.
+ *
+ *   node bench/virtual_stream_bench.js [seconds]
+ */
+
+'use strict';
+
+const asio = require('../lib');
+
+const SECONDS = Number(process.argv[2]) || 3;
+
+const CONFIGS = [
+    { label: '2 ch / 64', inputChannels: 2, bufferSize: 64 },
+    { label: '16 ch / 128', inputChannels: 16, bufferSize: 128 },
+    { label: '64 ch / 256', inputChannels: 64, bufferSize: 256 },
+    { label: '64 ch / 256 planar', inputChannels: 64, bufferSize: 256, planar: true },
+    { label: '64 ch / 256 10ms', inputChannels: 64, bufferSize: 256, deliveryIntervalMs: 10 },
+];
+
+function run(config) {
+    return new Promise((resolve) => {
+        const stream = asio.createStream({
+            device: 'virtual',
+            sampleRate: 48000,
+            outputChannels: 2,
+            virtualDevice: { signal: 'noise' },
+            ...config,
+        });
+        let samples = 0;
+        stream.setProcessCallback((inputBuffers) => {
+            samples += inputBuffers[0].length;
+        });
+        stream.start();
+        setTimeout(() => {
+            stream.stop();
+            const { stats, profile } = stream;
+            stream.close();
+            resolve({ stats, profile, samples });
+        }, SECONDS * 1000);
+    });
+}
+
+function fmt(value) {
+    return value.toFixed(1).padStart(8);
+}
+
+async function main() {
+    if (!asio.native) {
+        console.error('electron-asio native module not built');
+        process.exit(1);
+    }
+
+    console.log(`${SECONDS} s per configuration; stage times in microseconds, latency in ms\n`);
+    console.log(`${'config'.padEnd(20)} ${'total p50'.padStart(9)} ${'p99'.padStart(8)} ${'max'.padStart(8)}` +
+                ` ${'input p99'.padStart(9)} ${'misses'.padStart(7)} ${'lat p50'.padStart(8)} ${'lat p99'.padStart(8)}`);
+    for (const { label, ...config } of CONFIGS) {
+        const { stats, profile } = await run(config);
+        const total = profile.stages.total;
+        console.log(`${label.padEnd(20)} ${fmt(total.p50).padStart(9)} ${fmt(total.p99)} ${fmt(total.max)}` +
+                    ` ${fmt(profile.stages.input.p99).padStart(9)} ${String(profile.deadlineMisses).padStart(7)}` +
+                    ` ${fmt(stats.deliveryLatency.p50)} ${fmt(stats.deliveryLatency.p99)}`);
+    }
+    asio.terminate();
+}
+
+main();
@@ -1,4 +1,7 @@
 {
+  "variables": {
+    "with_opus%": "<!(node -e \"try{require('fs').accessSync('deps/opus/include/opus.h');console.log(1)}catch(e){console.log(0)}\")"
+  },
   "targets": [
     {
       "target_name": "electron_asio",
@@ -6,7 +9,23 @@
       "cflags_cc!": [ "-fno-exceptions" ],
       "sources": [
         "src/addon.cc",
-        "src/asio_wrapper.cc"
+        "src/asio_wrapper.cc",
+        "src/deinterleave.cc",
+        "src/input_capture.cc",
+        "src/mix_graph.cc",
+        "src/level_meter.cc",
+        "src/shared_ring.cc",
+        "src/sample_format.cc",
+        "src/resampler.cc",
+        "src/channel_workers.cc",
+        "src/virtual_device.cc",
+        "src/drift_compensator.cc",
+        "src/fractional_resampler.cc",
+        "src/jitter_buffer.cc",
+        "src/recorder.cc",
+        "src/wav_writer.cc",
+        "src/history_ring.cc",
+        "src/opus_pipeline.cc"
       ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")",
@@ -17,6 +36,9 @@
       ],
       "defines": [ "NAPI_DISABLE_CPP_EXCEPTIONS", "PA_USE_ASIO=1" ],
       "conditions": [
+        ["OS=='linux'", {
+          "libraries": [ "-lportaudio", "-lpthread" ]
+        }],
         ["OS=='win'", {
           "libraries": [
             "-l<(module_root_dir)/deps/portaudio/lib/portaudio_x64.lib"
@@ -30,6 +52,18 @@
               "ExceptionHandling": 1
             }
           }
+        }],
+        ["with_opus==1", {
+          "defines": [ "ELECTRON_ASIO_HAVE_OPUS=1" ],
+          "include_dirs": [ "deps/opus/include" ],
+          "conditions": [
+            ["OS=='linux'", {
+              "libraries": [ "-lopus" ]
+            }],
+            ["OS=='win'", {
+              "libraries": [ "-l<(module_root_dir)/deps/opus/lib/opus.lib" ]
+            }]
+          ]
         }]
       ]
     }
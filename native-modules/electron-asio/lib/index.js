@@ -6,6 +6,7 @@
 
 const path = require('path');
 const EventEmitter = require('events');
+const { createSharedRing, SharedRingReader } = require('./shared-ring');
 
 // Load native addon - handles both development and packaged (asar unpacked) paths
 let native = null;
@@ -156,6 +157,151 @@ class AsioStream extends EventEmitter {
         });
     }
 
+    /**
+     * Receive meter levels at the configured rate (see StreamConfig.meter).
+     * Levels are a Float32Array of [peak, rms, peakHold] per channel, linear.
+     * @param {Function} callback - (levels: Float32Array) => void
+     */
+    setMeterCallback(callback) {
+        this._native.setMeterCallback((levels) => {
+            try {
+                callback(levels);
+            } catch (e) {
+                this.emit('error', e);
+            }
+        });
+    }
+
+    /**
+     * Add a further consumer of the captured input. Blocks are captured once
+     * and shared with every subscriber, each with its own queue and
+     * backpressure policy, so a slow subscriber only drops its own blocks.
+     * Subscribers receive float32 at the device rate, one array per channel.
+     * @param {Function} callback - (inputBuffers: Float32Array[]) => void
+     * @param {SubscribeOptions} [options]
+     * @returns {number} Subscriber id for unsubscribe()
+     */
+    subscribe(callback, options) {
+        return this._native.subscribe((inputBuffers) => {
+            try {
+                callback(inputBuffers);
+            } catch (e) {
+                this.emit('error', e);
+            }
+        }, options || {});
+    }
+
+    /**
+     * Remove a subscriber; its queued blocks go back to the pool
+     * @param {number} id - Id returned by subscribe()
+     * @returns {boolean} false if there was no such subscriber
+     */
+    unsubscribe(id) {
+        return this._native.unsubscribe(id);
+    }
+
+    /**
+     * Receive Opus packets from the native encoder (see StreamConfig.encoder).
+     * Every frame encoded since the last call is passed at once, oldest first.
+     * @param {Function} callback - (frames: EncodedFrame[]) => void
+     */
+    setPacketCallback(callback) {
+        this._native.setPacketCallback((frames) => {
+            try {
+                callback(frames);
+            } catch (e) {
+                this.emit('error', e);
+            }
+        });
+    }
+
+    /**
+     * Enable or disable PCM delivery to the process callback. Meter-only
+     * consumers can turn it off and skip per-sample transport entirely.
+     * @param {boolean} enabled
+     */
+    setPcmEnabled(enabled) {
+        this._native.setPcmEnabled(enabled);
+    }
+
+    /**
+     * Drain output captured by a virtual device (virtualDevice.captureSeconds)
+     * @param {number} [maxFrames] - Frames to read at most (default: all)
+     * @returns {Float32Array[]} One array per output channel; empty for real devices
+     */
+    readCapture(maxFrames) {
+        return this._native.readCapture(maxFrames);
+    }
+
+    /**
+     * Clear the delivery latency/jitter histograms, the callback profile and
+     * peakQueueDepth
+     */
+    resetStats() {
+        this._native.resetStats();
+    }
+
+    /**
+     * Have the audio thread write input straight into a SharedArrayBuffer
+     * ring (see createSharedRing). Replaces any ring already attached.
+     * @param {SharedArrayBuffer} sab
+     */
+    attachSharedRing(sab) {
+        if (!(sab instanceof SharedArrayBuffer)) {
+            throw new TypeError('SharedArrayBuffer expected');
+        }
+        this._native.attachSharedRing(new Uint8Array(sab));
+    }
+
+    /**
+     * Stop writing to the attached ring
+     */
+    detachSharedRing() {
+        this._native.detachSharedRing();
+    }
+
+    /**
+     * Record the stream's input to WAV (RF64 beyond 4 GB) from a native
+     * writer thread. Throws if a file cannot be created or a recording is
+     * already running.
+     * @param {string} path - Output file; with split, the channel number is appended to the name
+     * @param {RecordingOptions} [options]
+     * @returns {string[]} The files being written
+     */
+    startRecording(path, options) {
+        return this._native.startRecording(path, options || {});
+    }
+
+    /**
+     * Finish the recording: write out buffered audio, finalize the headers
+     * and close the files. The work runs on a worker thread; a new recording
+     * may start before the promise settles.
+     * @returns {Promise<RecordingSummary|null>} null if nothing was being recorded
+     */
+    stopRecording() {
+        return this._native.stopRecording();
+    }
+
+    /**
+     * Export the last seconds of input held by the history buffer
+     * (StreamConfig.historySeconds). The copy runs on a worker thread while
+     * capture continues.
+     * @param {number} seconds - Window length, ending now (capped at historySeconds)
+     * @param {SnapshotOptions} [options] - With path, write a WAV file instead of returning buffers
+     * @returns {Promise<Snapshot>}
+     */
+    snapshot(seconds, options) {
+        return this._native.snapshot(seconds, options || {});
+    }
+
+    /**
+     * Latest meter snapshot: [peak, rms, peakHold] per channel
+     * @returns {Float32Array}
+     */
+    get levels() {
+        return this._native.levels;
+    }
+
     /**
      * Write audio data to output (for async/event-based mode)
      * @param {Float32Array[]} buffers - Array of channel buffers
@@ -165,6 +311,61 @@ class AsioStream extends EventEmitter {
         return this._native.write(buffers);
     }
 
+    /**
+     * Return zero-copy input buffers to the native pool before GC does.
+     * The views are detached and read as empty afterwards.
+     * @param {Float32Array[]|Float32Array} inputBuffers - Buffers passed to the process callback
+     * @returns {boolean} True if a pooled block was returned
+     */
+    release(inputBuffers) {
+        return this._native.release(inputBuffers);
+    }
+
+    /**
+     * Install (or with null, remove) the native monitoring graph. It runs
+     * inside the audio callback and is summed into the output on top of
+     * write() playback, so monitoring needs no JS round trip.
+     * @param {GraphConfig|null} graph
+     */
+    setGraph(graph) {
+        this._native.setGraph(graph);
+    }
+
+    /**
+     * Set a bus gain without rebuilding the graph (ramped over one buffer)
+     * @param {number} bus - Bus index
+     * @param {number} gain - Linear gain
+     */
+    setBusGain(bus, gain) {
+        this._native.setBusGain(bus, gain);
+    }
+
+    /**
+     * Mute or unmute a bus without rebuilding the graph
+     * @param {number} bus - Bus index
+     * @param {boolean} mute
+     */
+    setBusMute(bus, mute) {
+        this._native.setBusMute(bus, mute);
+    }
+
+    /**
+     * Set the trim applied to an input channel wherever the graph taps it
+     * @param {number} channel - Input channel
+     * @param {number} gain - Linear gain
+     */
+    setInputGain(channel, gain) {
+        this._native.setInputGain(channel, gain);
+    }
+
+    /**
+     * Process-wide stream id, for bindProcessCallback in a worker_thread
+     * @returns {number}
+     */
+    get id() {
+        return this._native.id;
+    }
+
     /**
      * Check if stream is currently running
      * @returns {boolean}
@@ -237,6 +438,14 @@ class AsioStream extends EventEmitter {
         return this._native.stats;
     }
 
+    /**
+     * Execution time of the audio callback, per internal stage
+     * @returns {CallbackProfile}
+     */
+    get profile() {
+        return this._native.profile;
+    }
+
     /**
      * Get buffer size in milliseconds
      * @returns {number}
@@ -255,6 +464,26 @@ function createStream(config) {
     return new AsioStream(config);
 }
 
+/**
+ * Take over a stream's process callback from another thread, typically a
+ * worker_thread that was handed stream.id. Input is then delivered on that
+ * thread's event loop instead of the stream owner's; setProcessCallback on
+ * the owner, or passing null here, hands it back. The stream itself (start,
+ * stop, write, close) stays with the thread that created it.
+ *
+ * An exception thrown by the callback is an uncaught exception in the
+ * binding thread, surfacing as the Worker's 'error' event.
+ *
+ * @param {number} streamId - AsioStream#id
+ * @param {Function|null} callback - (inputBuffers: Float32Array[], outputBuffers: Float32Array[]) => void
+ */
+function bindProcessCallback(streamId, callback) {
+    if (!native) {
+        throw new Error('electron-asio native module not available');
+    }
+    native.bindProcessCallback(streamId, callback || null);
+}
+
 /**
  * Initialize the ASIO subsystem (called automatically on load)
  * @returns {boolean}
@@ -289,11 +518,14 @@ module.exports = {
     getDevices,
     getDeviceInfo,
     createStream,
+    createSharedRing,
+    bindProcessCallback,
     initialize,
     terminate,
 
     // Classes
     AsioStream,
+    SharedRingReader,
 
     // Native module (for advanced use)
     native
@@ -314,12 +546,67 @@ module.exports = {
 
 /**
  * @typedef {Object} StreamConfig
- * @property {number|string} [device] - Device index or name
+ * @property {number|string} [device] - Device index, or 'virtual' for the hardware-free virtual device
+ * @property {VirtualDeviceConfig} [virtualDevice] - Virtual device options (implies device: 'virtual')
  * @property {number} [deviceIndex] - Device index (alternative to device)
  * @property {number} [sampleRate=48000] - Sample rate in Hz
  * @property {number} [bufferSize=256] - Buffer size in frames
- * @property {number[]} [inputChannels] - Input channel indices (0-based)
- * @property {number[]} [outputChannels] - Output channel indices (0-based)
+ * @property {number|number[]} [inputChannels] - Input channel count, or device channel indices
+ *   (0-based) to capture in the given order
+ * @property {number|number[]} [outputChannels] - Output channel count, or device channel indices
+ *   (0-based) to play in the given order
+ * @property {AggregateMemberConfig[]} [aggregate] - Further input devices locked to this device's
+ *   clock; their channels follow this device's input channels
+ * @property {boolean|JitterBufferConfig} [jitterBuffer=false] - Play write() output through an
+ *   adaptive jitter buffer that conceals late writes instead of playing silence
+ * @property {number} [historySeconds=0] - Keep the last N seconds of input in memory for
+ *   snapshot(); costs N x sampleRate x channels x 4 bytes, plus 2 s of headroom
+ * @property {boolean|EncoderConfig} [encoder=false] - Encode input to Opus natively and deliver
+ *   packets to setPacketCallback() (needs a build with libopus)
+ * @property {number} [inputPoolBlocks=32] - Preallocated input blocks awaiting JS delivery; every
+ *   subscribe() queue reserves its queueDepth of them
+ * @property {boolean|MeterConfig} [meter=false] - Compute peak/RMS/peak-hold levels natively
+ * @property {boolean} [deliverPcm=true] - Deliver PCM to the process callback
+ * @property {boolean} [planar=false] - Open the device non-interleaved (paNonInterleaved) so
+ *   input and write() move one memcpy per channel
+ * @property {boolean} [zeroCopy=false] - Deliver input as views over pooled native memory
+ *   (falls back to copying where external ArrayBuffers are not allowed)
+ * @property {number} [deliveryIntervalMs] - Accumulate input periods and call back once per interval
+ * @property {number} [framesPerDelivery] - Same as deliveryIntervalMs, in frames (takes precedence)
+ * @property {string} [transport='send'] - IPC only: 'port' moves binary blocks over a MessagePortMain
+ * @property {string} [deliveryFormat='float32'] - Input sample format: 'float32' (Float32Array),
+ *   'int16' (Int16Array), 'int24' (Uint8Array, 3 bytes per sample little endian) or 'float16'
+ *   (Uint16Array of IEEE half bit patterns)
+ * @property {boolean} [dither=false] - Add TPDF dither when converting to int16/int24
+ * @property {number} [deliverySampleRate] - Resample input to this rate before delivery (e.g. 48000)
+ * @property {string} [resampleQuality='medium'] - 'low' (16 taps), 'medium' (32) or 'high' (64)
+ * @property {number} [deadlineFraction=0.75] - Share of the buffer period a callback may use
+ *   before it counts as a deadline miss in the profile
+ * @property {number} [resampleThreads] - Worker threads for per-channel resampling (default: auto for 16+ channels)
+ * @property {number} [queueDepth=16] - Input blocks that may wait for the JS callback
+ * @property {string} [backpressure='drop-oldest'] - What to do when the queue is full:
+ *   'drop-oldest', 'drop-newest', or 'coalesce' (deliver the backlog as one longer block)
+ */
+
+/**
+ * @typedef {Object} MeterConfig
+ * @property {number} [rateHz=30] - Level snapshots per second
+ * @property {number} [holdMs=1000] - Peak-hold time before decay starts
+ * @property {number} [decayDbPerSecond=20] - Peak-hold fall rate
+ */
+
+/**
+ * @typedef {Object} GraphConfig
+ * @property {GraphBus[]} buses - Summing buses
+ * @property {number[]} [inputGains] - Per-input-channel trims (linear)
+ */
+
+/**
+ * @typedef {Object} GraphBus
+ * @property {Array<number|{channel: number, gain: number}>} inputs - Input channels summed into the bus
+ * @property {number} [gain=1] - Bus gain (linear)
+ * @property {boolean} [mute=false] - Mute the bus
+ * @property {number[]} outputs - Output channels the bus is routed to
  */
 
 /**
@@ -328,4 +615,242 @@ module.exports = {
  * @property {number} inputUnderflows - Number of input underflows
  * @property {number} outputUnderflows - Number of output underflows
  * @property {number} cpuLoad - CPU load (0.0 - 1.0)
+ * @property {Object} [virtualDevice] - Virtual devices only: callbacks, missedDeadlines,
+ *   captureFrames and captureOverruns
+ * @property {AggregateMemberStats[]} [aggregate] - Aggregate streams only, one per member
+ * @property {number} outputBufferFill - Frames queued by write() awaiting playback
+ * @property {number} outputBufferCapacity - Capacity of the write ring in frames
+ * @property {number} outputOverruns - write() calls that could not queue every frame
+ * @property {number} outputStarved - Callbacks that played silence because write() fell behind
+ * @property {JitterBufferStats} [jitterBuffer] - Streams opened with jitterBuffer only
+ * @property {RecordingStats} [recording] - While startRecording() is active
+ * @property {HistoryStats} [history] - Streams opened with historySeconds only
+ * @property {EncoderStats} [encoder] - Streams opened with an encoder only
+ * @property {number} poolBlocks - Preallocated input blocks
+ * @property {number} poolFree - Input blocks not currently queued for JS
+ * @property {number} poolExhausted - Input periods dropped because every block was in flight
+ * @property {number} oversizedPeriods - Input periods dropped because the host delivered more
+ *   frames than the stream was opened for (channel selection, aggregation or a block)
+ * @property {number} queueDepth - Input blocks waiting for the JS callback
+ * @property {number} queueCapacity - Maximum blocks the delivery queue holds
+ * @property {number} peakQueueDepth - Highest queue depth seen
+ * @property {number} droppedBlocks - Input blocks discarded by the backpressure policy
+ * @property {SubscriberStats[]} subscribers - One entry per subscribe() consumer
+ * @property {number} coalescedBlocks - Input blocks merged into an earlier delivery
+ * @property {number} framesPerDelivery - Frames accumulated per delivery (0 = every period)
+ * @property {number} deliveryCount - Process callback invocations so far
+ * @property {number} deliveryRate - Process callback invocations per second of captured audio
+ * @property {number} averageBlockFrames - Average frames per channel in each delivery
+ * @property {LatencySummary} deliveryLatency - Time from capture of the oldest frame in a
+ *   delivery to the process callback firing
+ * @property {LatencySummary} deliveryJitter - Deviation of each interval between deliveries
+ *   from the audio duration of the previous delivery
+ * @property {string} channelSelection - 'asio' (driver channel selectors), 'native' (gathered in
+ *   the audio callback) or 'none'
+ * @property {boolean} sharedRing - True while a SharedArrayBuffer ring is attached
+ * @property {number} deliverySampleRate - Sample rate of delivered input
+ * @property {string} deliveryFormat - Sample format handed to the process callback
+ * @property {boolean} zeroCopy - True while input is delivered as views over pooled memory
+ * @property {number} zeroCopyFallbacks - Times zero-copy delivery fell back to copying
+ */
+
+/**
+ * @typedef {Object} JitterBufferConfig
+ * @property {number} [minMs] - Lowest reserve the buffer keeps (default: two periods)
+ * @property {number} [maxMs=200] - Highest reserve, however late write() gets
+ * @property {number} [targetMs] - Reserve before any lateness has been seen (default: minMs)
+ */
+
+/**
+ * @typedef {Object} JitterBufferStats
+ * @property {number} fillMs - Audio queued by write() right now
+ * @property {number} targetMs - Reserve currently being held
+ * @property {number} latencyMs - Average queued audio over the last second: the latency added
+ * @property {number} producerJitterMs - Peak lateness of write() against its own average pace
+ * @property {number} correctionPpm - Playout rate correction holding the reserve on target
+ * @property {number} concealments - Times missing audio was concealed
+ * @property {number} concealedFrames - Frames of concealment played
+ * @property {number} partialPeriods - Periods only partly covered by queued audio
+ * @property {number} rebuffers - Times playback stopped to refill after a long gap
+ * @property {boolean} buffering - True while refilling before playback (re)starts
+ */
+
+/**
+ * @typedef {Object} SubscribeOptions
+ * @property {number} [queueDepth=8] - Blocks that may wait for this subscriber
+ * @property {string} [backpressure='drop-oldest'] - 'drop-oldest', 'drop-newest' or 'coalesce'
+ */
+
+/**
+ * @typedef {Object} SubscriberStats
+ * @property {number} id - Subscriber id
+ * @property {string} backpressure - Policy applied to this subscriber's queue
+ * @property {number} queueDepth - Blocks waiting for the subscriber
+ * @property {number} queueCapacity - Maximum blocks its queue holds
+ * @property {number} peakQueueDepth - Highest queue depth seen
+ * @property {number} droppedBlocks - Blocks this subscriber lost to backpressure
+ * @property {number} deliveries - Callbacks made
+ * @property {number} deliveredFrames - Frames delivered
+ */
+
+/**
+ * @typedef {Object} EncoderConfig
+ * @property {string} [codec='opus'] - Only 'opus'
+ * @property {number} [bitrate=64000] - Bits per second per channel (6000 - 256000)
+ * @property {number} [complexity=5] - 0 (fastest) to 10 (best)
+ * @property {number} [frameMs=20] - 2.5, 5, 10, 20, 40 or 60
+ * @property {string} [application='audio'] - 'audio', 'voip' or 'lowdelay'
+ * @property {string} [grouping='stereo'] - Encode channel pairs ('stereo') or each channel ('mono')
+ * @property {number} [threads=-1] - Encoder pool threads for wide streams; -1 = auto
+ * @property {number} [queueMs=500] - Encoded audio held for the callback before the oldest drops
+ */
+
+/**
+ * @typedef {Object} EncodedFrame
+ * @property {number} sequence - Frames since the stream was opened
+ * @property {number} timestamp - Sample position of the frame's first sample
+ * @property {number} captureTime - When that sample was captured, ms on the native monotonic clock
+ * @property {Uint8Array[]} packets - One Opus packet per channel group
+ */
+
+/**
+ * @typedef {Object} EncoderStats
+ * @property {string} codec - 'opus'
+ * @property {number} frameMs - Frame duration
+ * @property {number} bitrate - Configured bits per second per channel
+ * @property {number} complexity - Configured complexity
+ * @property {number} groups - Channel groups, each its own Opus stream
+ * @property {number} threads - Pool threads encoding groups in parallel (0 = encoder thread only)
+ * @property {number} lookaheadMs - Opus algorithmic delay
+ * @property {number} framesEncoded - Frames encoded so far
+ * @property {number} bytesEncoded - Packet bytes produced so far
+ * @property {number} averageBitrate - Bits per second actually produced, all groups
+ * @property {LatencySummary} encodeTime - Time to encode one frame of every group, ms
+ * @property {number} realtimeFactor - Audio time encoded per unit of wall time, at the median
+ * @property {number} droppedInput - Input frames dropped because the encoder fell behind
+ * @property {number} droppedFrames - Encoded frames dropped because the callback fell behind
+ * @property {number} encodeErrors - Group packets the encoder failed to produce
+ * @property {number} queueDepth - Encoded frames waiting for the callback
+ */
+
+/**
+ * @typedef {Object} RecordingOptions
+ * @property {string} [format='int24'] - 'int16', 'int24' or 'float32'
+ * @property {boolean} [dither=false] - TPDF dither for integer formats
+ * @property {boolean} [split=false] - One mono file per channel instead of one multichannel file
+ * @property {number} [ringSeconds=4] - Audio buffered against disk stalls
+ * @property {number} [writeBlockBytes=1048576] - Bytes per file write, 4 KiB to 16 MiB (rounded
+ *   down to 4 KiB)
+ * @property {number} [syncIntervalMs=2000] - Sync to disk and update headers this often (0 = at stop only)
+ * @property {number} [preallocateSeconds=60] - File space reserved ahead of the audio
+ */
+
+/**
+ * @typedef {Object} RecordingStats
+ * @property {string[]} files - Files being written
+ * @property {number} frames - Frames converted for writing so far
+ * @property {number} seconds - Same, in seconds
+ * @property {number} bytesWritten - Audio bytes written to disk
+ * @property {number} throughputMBps - Write throughput over the last second (MB/s)
+ * @property {number} maxWriteMs - Slowest single write
+ * @property {number} ringFillMs - Audio waiting for the writer thread
+ * @property {number} ringHighWaterMs - Highest ring fill seen
+ * @property {number} ringCapacityMs - Ring size
+ * @property {number} droppedFrames - Frames lost to a full ring (replaced by silence)
+ * @property {number} syncs - Disk syncs so far
+ * @property {string} [error] - Set once a write fails; recording stops writing
+ */
+
+/**
+ * @typedef {Object} RecordingSummary
+ * @property {string[]} files - Files written
+ * @property {number} frames - Frames recorded
+ * @property {number} seconds - Same, in seconds
+ * @property {number} bytes - Audio bytes written
+ * @property {number} droppedFrames - Frames lost to a full ring (replaced by silence)
+ * @property {string} [error] - Set if a write failed part way
+ */
+
+/**
+ * @typedef {Object} SnapshotOptions
+ * @property {string} [path] - Write the window to this WAV file
+ * @property {string} [format='int24'] - File format: 'int16', 'int24' or 'float32'
+ * @property {boolean} [dither=false] - TPDF dither for integer formats
+ */
+
+/**
+ * @typedef {Object} Snapshot
+ * @property {number} frames - Frames in the window (less than asked if the stream is younger)
+ * @property {number} seconds - Same, in seconds
+ * @property {number} sampleRate - Sample rate of the audio
+ * @property {number} channels - Channel count
+ * @property {Float32Array[]} [buffers] - One array per channel, unless a path was given
+ * @property {string} [path] - The file written, if a path was given
+ */
+
+/**
+ * @typedef {Object} HistoryStats
+ * @property {number} seconds - Configured history window
+ * @property {number} filledSeconds - Audio currently held, up to the window
+ * @property {number} memoryBytes - Memory allocated for the history
+ * @property {number} snapshots - snapshot() calls so far
+ */
+
+/**
+ * @typedef {Object} VirtualDeviceConfig
+ * @property {string} [signal='sine'] - Input: 'silence', 'sine', 'noise', 'impulse' or 'file'
+ * @property {number} [frequency=440] - Sine frequency in Hz
+ * @property {number} [amplitude=0.5] - Peak level of the generated signal
+ * @property {number} [impulseInterval] - Frames between impulses (default: one second)
+ * @property {string} [file] - WAV file looped as input (16/24/32-bit PCM or float32), resampled
+ *   to sampleRate when recorded at another rate
+ * @property {number} [jitterMs=0] - Random extra delay added to each wake-up
+ * @property {number} [clockPpm=0] - Clock error in parts per million (positive runs fast)
+ * @property {number} [missEvery=0] - Run every Nth callback a whole period late
+ * @property {number} [captureSeconds=0] - Output kept for readCapture()
+ */
+
+/**
+ * @typedef {Object} AggregateMemberConfig
+ * @property {number|string} device - Device index, or 'virtual'
+ * @property {VirtualDeviceConfig} [virtualDevice] - Virtual device options (implies device: 'virtual')
+ * @property {number} [inputChannels=2] - Leading input channels to capture
+ * @property {number} [sampleRate] - Member's own rate (default: the stream's)
+ * @property {number} [bufferSize] - Member's own buffer size (default: the stream's)
+ */
+
+/**
+ * @typedef {Object} AggregateMemberStats
+ * @property {number|string} device - Device index, or 'virtual'
+ * @property {number} channels - Input channels contributed
+ * @property {number} sampleRate - Member's nominal rate
+ * @property {boolean} locked - True once the member's buffer first reached its target fill
+ * @property {number} driftPpm - Member clock against the stream's, from frame counts since lock
+ * @property {number} correctionPpm - Current resampling correction applied by the controller
+ * @property {number} bufferFill - Member frames buffered
+ * @property {number} targetFill - Fill the controller steers towards
+ * @property {number} underruns - Periods filled with silence because the member fell behind
+ * @property {number} overflows - Member periods not fully buffered because the ring was full, plus
+ *   input overflows reported by the member's driver
+ */
+
+/**
+ * @typedef {Object} CallbackProfile
+ * @property {Object<string, LatencySummary>} stages - 'output', 'aggregate', 'graph', 'tap',
+ *   'input', 'enqueue' and 'total', in microseconds
+ * @property {number} periodMicros - Nominal buffer period
+ * @property {number} deadlineFraction - Deadline as a fraction of the period
+ * @property {number} deadlineMisses - Callbacks that used more than deadlineFraction of their period
+ * @property {number} overruns - Callbacks that took longer than their whole period
+ * @property {number} peakLoad - Highest callback time as a fraction of its period
+ */
+
+/**
+ * @typedef {Object} LatencySummary
+ * @property {number} count - Samples recorded since open or resetStats()
+ * @property {number} mean - Milliseconds
+ * @property {number} p50 - Milliseconds (log-bucketed, within 12.5%)
+ * @property {number} p95 - Milliseconds
+ * @property {number} p99 - Milliseconds
+ * @property {number} max - Milliseconds (exact)
  */
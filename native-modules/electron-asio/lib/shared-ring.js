@@ -0,0 +1,108 @@
+/**
+ * SharedArrayBuffer ring shared with the native capture thread
+ *
+ * The native module writes planar input straight into the ring from the
+ * audio callback; a reader in the same process (renderer with node
+ * integration, AudioWorklet, worker) drains it with Atomics and no per-block
+ * messaging. Layout must match src/shared_ring.h.
+ *
+ * This file has no imports so it can also be loaded with
+ * audioWorklet.addModule(); it then defines SharedRingReader globally.
+ */
+
+const WRITE_INDEX = 0;          // Uint32 slot of the producer index (byte 0)
+const READ_INDEX = 16;          // Uint32 slot of the consumer index (byte 64)
+const CAPACITY = 32;            // byte 128
+const CHANNELS = 33;            // byte 132
+const SAMPLE_RATE = 34;         // byte 136
+const DROPPED_FRAMES = 35;      // byte 140
+const HEADER_BYTES = 192;
+
+/**
+ * Allocate and initialize a ring
+ * @param {Object} options
+ * @param {number} options.channels - Must match the stream's input channel count
+ * @param {number} [options.frames=8192] - Capacity per channel, rounded up to a power of two
+ * @param {number} [options.sampleRate=0] - Informational, for the reader
+ * @returns {SharedArrayBuffer}
+ */
+function createSharedRing({ channels, frames = 8192, sampleRate = 0 }) {
+    let capacity = 1;
+    while (capacity < frames) capacity *= 2;
+
+    const sab = new SharedArrayBuffer(HEADER_BYTES + capacity * channels * 4);
+    const header = new Uint32Array(sab, 0, HEADER_BYTES / 4);
+    header[CAPACITY] = capacity;
+    header[CHANNELS] = channels;
+    header[SAMPLE_RATE] = sampleRate;
+    return sab;
+}
+
+class SharedRingReader {
+    /**
+     * @param {SharedArrayBuffer} sab - Ring created by createSharedRing
+     */
+    constructor(sab) {
+        this.header = new Uint32Array(sab, 0, HEADER_BYTES / 4);
+        this.capacity = this.header[CAPACITY];
+        this.channels = this.header[CHANNELS];
+        this.sampleRate = this.header[SAMPLE_RATE];
+        this.lanes = [];
+        for (let ch = 0; ch < this.channels; ch++) {
+            this.lanes.push(new Float32Array(sab, HEADER_BYTES + ch * this.capacity * 4, this.capacity));
+        }
+    }
+
+    /**
+     * Frames ready to read
+     * @returns {number}
+     */
+    available() {
+        return (Atomics.load(this.header, WRITE_INDEX) - Atomics.load(this.header, READ_INDEX)) >>> 0;
+    }
+
+    /**
+     * Frames the producer skipped because the ring was full
+     * @returns {number}
+     */
+    get droppedFrames() {
+        return Atomics.load(this.header, DROPPED_FRAMES);
+    }
+
+    /**
+     * Copy up to outputs[0].length frames into one Float32Array per channel
+     * @param {Float32Array[]} outputs
+     * @returns {number} Frames read
+     */
+    read(outputs) {
+        const r = Atomics.load(this.header, READ_INDEX);
+        const n = Math.min(this.available(), outputs[0] ? outputs[0].length : 0);
+        if (n === 0) return 0;
+
+        const offset = r & (this.capacity - 1);
+        const head = Math.min(n, this.capacity - offset);
+        for (let ch = 0; ch < this.channels && ch < outputs.length; ch++) {
+            const lane = this.lanes[ch];
+            outputs[ch].set(lane.subarray(offset, offset + head), 0);
+            if (n > head) {
+                outputs[ch].set(lane.subarray(0, n - head), head);
+            }
+        }
+
+        Atomics.store(this.header, READ_INDEX, (r + n) >>> 0);
+        return n;
+    }
+
+    /**
+     * Discard everything queued, e.g. after the reader fell behind
+     */
+    skip() {
+        Atomics.store(this.header, READ_INDEX, Atomics.load(this.header, WRITE_INDEX));
+    }
+}
+
+if (typeof module !== 'undefined' && module.exports) {
+    module.exports = { createSharedRing, SharedRingReader, HEADER_BYTES };
+} else {
+    globalThis.SharedRingReader = SharedRingReader;
+}
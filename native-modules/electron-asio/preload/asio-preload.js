@@ -12,6 +12,25 @@
 
 const { contextBridge, ipcRenderer } = require('electron');
 
+// Streams created with transport: 'port' carry audio over their own MessagePort
+const ports = new Map();
+// Port streams that joined a shared device and may not write output
+const readOnlyPorts = new Set();
+const audioDataListeners = new Set();
+
+ipcRenderer.on('asio:port', (event, { streamId, writable }) => {
+    const port = event.ports[0];
+    port.onmessage = ({ data }) => {
+        for (const callback of audioDataListeners) {
+            callback(streamId, data.buffers);
+        }
+    };
+    ports.set(streamId, port);
+    if (writable === false) {
+        readOnlyPorts.add(streamId);
+    }
+});
+
 // Expose ASIO API to renderer
 contextBridge.exposeInMainWorld('asio', {
     /**
@@ -65,7 +84,15 @@ contextBridge.exposeInMainWorld('asio', {
      * @param {string} streamId
      * @returns {Promise<void>}
      */
-    closeStream: (streamId) => ipcRenderer.invoke('asio:closeStream', streamId),
+    closeStream: (streamId) => {
+        const port = ports.get(streamId);
+        if (port) {
+            port.close();
+            ports.delete(streamId);
+            readOnlyPorts.delete(streamId);
+        }
+        return ipcRenderer.invoke('asio:closeStream', streamId);
+    },
 
     /**
      * Get stream stats
@@ -78,9 +105,21 @@ contextBridge.exposeInMainWorld('asio', {
      * Write audio data to a stream's output
      * @param {string} streamId
      * @param {Float32Array[]} buffers
-     * @returns {Promise<number>}
+     * @returns {Promise<number>} Frames queued; frames posted for port transport,
+     *   where write overruns show up in stats.outputOverruns instead
      */
     writeStream: (streamId, buffers) => {
+        const port = ports.get(streamId);
+        if (port) {
+            // Same error the invoke path raises in the main process
+            if (readOnlyPorts.has(streamId)) {
+                return Promise.reject(new Error(`Stream ${streamId} shares its device and cannot write output`));
+            }
+            // Binary, and the buffers are handed over rather than copied
+            port.postMessage({ buffers }, [...new Set(buffers.map(buf => buf.buffer))]);
+            return Promise.resolve(buffers.length > 0 ? buffers[0].length : 0);
+        }
+
         // Convert Float32Arrays to regular arrays for IPC
         const serialized = buffers.map(buf => Array.from(buf));
         return ipcRenderer.invoke('asio:writeStream', streamId, serialized);
@@ -93,12 +132,29 @@ contextBridge.exposeInMainWorld('asio', {
      */
     onAudioData: (callback) => {
         const handler = (event, { streamId, buffers }) => {
-            // Convert arrays back to Float32Arrays
-            const float32Buffers = buffers.map(arr => new Float32Array(arr));
+            // Convert arrays back to Float32Arrays; other delivery formats arrive typed
+            const float32Buffers = buffers.map(arr => ArrayBuffer.isView(arr) ? arr : new Float32Array(arr));
             callback(streamId, float32Buffers);
         };
         ipcRenderer.on('asio:audioData', handler);
-        return () => ipcRenderer.removeListener('asio:audioData', handler);
+        // Port streams already deliver Float32Arrays
+        audioDataListeners.add(callback);
+        return () => {
+            ipcRenderer.removeListener('asio:audioData', handler);
+            audioDataListeners.delete(callback);
+        };
+    },
+
+    /**
+     * Subscribe to meter levels from a stream created with `meter` enabled
+     * @param {Function} callback - (streamId, levels: Float32Array) => void,
+     *   levels holding [peak, rms, peakHold] per channel
+     * @returns {Function} Unsubscribe function
+     */
+    onLevels: (callback) => {
+        const handler = (event, { streamId, levels }) => callback(streamId, levels);
+        ipcRenderer.on('asio:levels', handler);
+        return () => ipcRenderer.removeListener('asio:levels', handler);
     },
 
     /**
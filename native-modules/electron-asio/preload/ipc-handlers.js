@@ -12,6 +12,15 @@ const asio = require('../lib/index.js');
 const streams = new Map();
 let streamIdCounter = 0;
 
+// Native streams by device. Windows that open a device already open with the
+// same settings subscribe to its capture instead of opening it again.
+const devices = new Map();
+
+// Subscriber queue per additional window, and how many windows the block
+// pool of a shareable stream is sized for
+const SUBSCRIBER_QUEUE_DEPTH = 8;
+const SHARED_WINDOWS = 4;
+
 /**
  * Generate unique stream ID
  */
@@ -19,6 +28,137 @@ function generateStreamId() {
     return `stream_${++streamIdCounter}_${Date.now()}`;
 }
 
+/**
+ * Key identifying the device a config opens
+ */
+function deviceKey(config) {
+    return String(config.device !== undefined ? config.device : (config.deviceIndex !== undefined ? config.deviceIndex : -1));
+}
+
+/**
+ * Settings that must match for two windows to share one native stream.
+ * Includes every delivery option, so a window never joins a stream that
+ * would hand it audio in a different shape than it asked for.
+ */
+function settingsKey(config) {
+    const {
+        sampleRate, bufferSize, inputChannels, outputChannels, channels, planar, aggregate, virtualDevice,
+        deliveryFormat, deliverySampleRate, zeroCopy, deliveryIntervalMs, framesPerDelivery, transport, meter
+    } = config;
+    return JSON.stringify({
+        sampleRate, bufferSize, inputChannels, outputChannels, channels, planar, aggregate, virtualDevice,
+        deliveryFormat, deliverySampleRate, zeroCopy, deliveryIntervalMs, framesPerDelivery, transport, meter
+    });
+}
+
+/**
+ * Subscribers receive float32 copies at the device rate, so a config that
+ * asks for any other delivery can only be served by its own stream
+ */
+function subscriberCompatible(config) {
+    return (config.deliveryFormat === undefined || config.deliveryFormat === 'float32') &&
+        (config.deliverySampleRate === undefined || config.deliverySampleRate === config.sampleRate) &&
+        !config.zeroCopy;
+}
+
+/**
+ * Build the input callback that forwards captured audio to one window
+ */
+function forwardInput(entry, streamId, sender) {
+    if (entry.port) {
+        const port = entry.port;
+        return (inputBuffers) => {
+            if (inputBuffers.length > 0) {
+                // Cloned once into the message as raw bytes; pooled
+                // zero-copy blocks can go straight back to the pool
+                port.postMessage({ buffers: inputBuffers });
+                entry.device.stream.release(inputBuffers);
+            }
+        };
+    }
+    return (inputBuffers) => {
+        // Only send input data to renderer (output should be handled via write)
+        if (inputBuffers.length > 0 && !sender.isDestroyed()) {
+            // Convert Float32Arrays to regular arrays for IPC; integer
+            // and half-float formats go as typed arrays so they keep their type
+            const serialized = inputBuffers[0] instanceof Float32Array
+                ? inputBuffers.map(buf => Array.from(buf))
+                : inputBuffers;
+            sender.send('asio:audioData', { streamId, buffers: serialized });
+        }
+    };
+}
+
+/**
+ * Open a native stream for a device, or join the one already open
+ */
+function acquireDevice(config) {
+    const key = deviceKey(config);
+    const settings = settingsKey(config);
+    const shareable = config.share !== false && subscriberCompatible(config);
+
+    const existing = shareable ? devices.get(key) : null;
+    if (existing && existing.settings === settings) {
+        return existing;
+    }
+
+    // Leave room in the block pool for other windows to subscribe
+    const streamConfig = shareable
+        ? { ...config, inputPoolBlocks: (config.inputPoolBlocks || 32) + SHARED_WINDOWS * SUBSCRIBER_QUEUE_DEPTH }
+        : config;
+    const device = {
+        key,
+        settings,
+        stream: asio.createStream(streamConfig),
+        entries: new Set(),
+        running: new Set(),
+        owner: null,
+        meter: false
+    };
+
+    device.stream.on('error', (error) => {
+        for (const streamId of device.entries) {
+            const entry = streams.get(streamId);
+            if (entry && !entry.sender.isDestroyed()) {
+                entry.sender.send('asio:error', { streamId, error: error.message });
+            }
+        }
+    });
+
+    // A device someone else already holds with other settings keeps its own stream
+    if (shareable && !existing) {
+        devices.set(key, device);
+    }
+    return device;
+}
+
+/**
+ * Detach one window from its device; the last one closes the native stream
+ */
+function releaseEntry(streamId, entry) {
+    const device = entry.device;
+    if (entry.port) entry.port.close();
+    if (entry.subscription !== null) {
+        device.stream.unsubscribe(entry.subscription);
+    } else if (device.owner === streamId) {
+        // The process callback stays installed; subscribers keep the capture alive
+        device.stream.setPcmEnabled(false);
+        device.owner = null;
+    }
+    device.entries.delete(streamId);
+    device.running.delete(streamId);
+    streams.delete(streamId);
+
+    if (device.entries.size === 0) {
+        device.stream.close();
+        if (devices.get(device.key) === device) {
+            devices.delete(device.key);
+        }
+    } else if (device.running.size === 0) {
+        device.stream.stop();
+    }
+}
+
 /**
  * Set up IPC handlers for ASIO
  * @param {Electron.IpcMain} ipcMain
@@ -43,32 +183,71 @@ function setupAsioIpc(ipcMain) {
 
     // Stream management
     ipcMain.handle('asio:createStream', (event, config) => {
-        const stream = asio.createStream(config);
+        const device = acquireDevice(config);
+        const stream = device.stream;
         const streamId = generateStreamId();
+        const shared = device.entries.size > 0;
 
-        streams.set(streamId, {
-            stream,
-            sender: event.sender
-        });
-
-        // Set up callback to forward audio data to renderer
-        stream.setProcessCallback((inputBuffers, outputBuffers) => {
-            // Only send input data to renderer (output should be handled via write)
-            if (inputBuffers.length > 0 && !event.sender.isDestroyed()) {
-                // Convert Float32Arrays to regular arrays for IPC
-                const serialized = inputBuffers.map(buf => Array.from(buf));
-                event.sender.send('asio:audioData', { streamId, buffers: serialized });
-            }
-        });
+        const entry = {
+            device,
+            sender: event.sender,
+            port: null,
+            subscription: null,
+            meter: !!config.meter
+        };
+        streams.set(streamId, entry);
+        device.entries.add(streamId);
 
-        stream.on('error', (error) => {
-            if (!event.sender.isDestroyed()) {
-                event.sender.send('asio:error', { streamId, error: error.message });
+        // transport: 'port' moves binary blocks over a dedicated MessagePortMain
+        if (config.transport === 'port') {
+            const { MessageChannelMain } = require('electron');
+            const { port1, port2 } = new MessageChannelMain();
+            entry.port = port1;
+
+            port1.on('message', ({ data }) => {
+                if (data && data.buffers && device.owner === streamId) {
+                    stream.write(data.buffers);
+                }
+            });
+            port1.start();
+
+            // Only the owner may write; the preload rejects writes on the
+            // port of a window that joined a shared device
+            event.sender.postMessage('asio:port', { streamId, writable: !shared }, [port2]);
+        }
+
+        // The window that opened the device owns it: it gets the
+        // full-featured process callback and is the only one that may write
+        // output. Later windows subscribe to the same captured blocks.
+        if (!shared) {
+            device.owner = streamId;
+        }
+        if (config.deliverPcm !== false) {
+            const forward = forwardInput(entry, streamId, event.sender);
+            if (!shared) {
+                stream.setProcessCallback(forward);
+            } else {
+                entry.subscription = stream.subscribe(forward, { queueDepth: SUBSCRIBER_QUEUE_DEPTH });
             }
-        });
+        }
+
+        // Meter levels are a few floats per channel, sent at the meter rate
+        // to every window that asked for them
+        if (config.meter && !device.meter) {
+            device.meter = true;
+            stream.setMeterCallback((levels) => {
+                for (const id of device.entries) {
+                    const target = streams.get(id);
+                    if (target && target.meter && !target.sender.isDestroyed()) {
+                        target.sender.send('asio:levels', { streamId: id, levels });
+                    }
+                }
+            });
+        }
 
         return {
             streamId,
+            shared,
             inputLatency: stream.inputLatency,
             outputLatency: stream.outputLatency,
             totalLatency: stream.totalLatency,
@@ -79,38 +258,46 @@ function setupAsioIpc(ipcMain) {
         };
     });
 
+    // A shared device runs while any of its windows has started it
     ipcMain.handle('asio:startStream', (event, streamId) => {
         const entry = streams.get(streamId);
         if (!entry) throw new Error(`Stream not found: ${streamId}`);
-        return entry.stream.start();
+        const device = entry.device;
+        device.running.add(streamId);
+        return device.stream.isRunning ? true : device.stream.start();
     });
 
     ipcMain.handle('asio:stopStream', (event, streamId) => {
         const entry = streams.get(streamId);
         if (!entry) throw new Error(`Stream not found: ${streamId}`);
-        return entry.stream.stop();
+        const device = entry.device;
+        device.running.delete(streamId);
+        return device.running.size > 0 ? true : device.stream.stop();
     });
 
     ipcMain.handle('asio:closeStream', (event, streamId) => {
         const entry = streams.get(streamId);
         if (!entry) return;
-        entry.stream.close();
-        streams.delete(streamId);
+        releaseEntry(streamId, entry);
     });
 
     ipcMain.handle('asio:getStreamStats', (event, streamId) => {
         const entry = streams.get(streamId);
         if (!entry) throw new Error(`Stream not found: ${streamId}`);
-        return entry.stream.stats;
+        return entry.device.stream.stats;
     });
 
     ipcMain.handle('asio:writeStream', (event, streamId, buffers) => {
         const entry = streams.get(streamId);
         if (!entry) throw new Error(`Stream not found: ${streamId}`);
+        // Blocks from two windows would interleave in one output ring
+        if (entry.device.owner !== streamId) {
+            throw new Error(`Stream ${streamId} shares its device and cannot write output`);
+        }
 
         // Convert arrays back to Float32Arrays
         const float32Buffers = buffers.map(arr => new Float32Array(arr));
-        return entry.stream.write(float32Buffers);
+        return entry.device.stream.write(float32Buffers);
     });
 }
 
@@ -120,12 +307,13 @@ function setupAsioIpc(ipcMain) {
 function cleanupAsio() {
     for (const [streamId, entry] of streams) {
         try {
-            entry.stream.close();
+            releaseEntry(streamId, entry);
         } catch (e) {
             console.error(`Error closing stream ${streamId}:`, e);
         }
     }
     streams.clear();
+    devices.clear();
     asio.terminate();
 }
 
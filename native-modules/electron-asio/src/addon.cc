@@ -5,43 +5,76 @@
  */
 
 #include <napi.h>
+#include <mutex>
+#include "addon_data.h"
 #include "asio_wrapper.h"
 
-static bool g_initialized = false;
+// PortAudio is process-wide; every environment (main thread or worker)
+// that initializes it holds one reference
+static std::mutex g_paMutex;
+static int g_paUsers = 0;
+
+static bool IsInitialized(Napi::Env env) {
+    return env.GetInstanceData<AddonData>()->paInitialized;
+}
+
+// Drop one environment's reference; the last one terminates PortAudio
+static void ReleasePortAudio() {
+    std::lock_guard<std::mutex> lock(g_paMutex);
+    if (--g_paUsers == 0) {
+        Pa_Terminate();
+    }
+}
+
+// An environment torn down without terminate() (a worker exiting, say)
+// still gives its reference back. Node finalizes the environment's wrapped
+// streams before its instance data, so none of them is left open here.
+AddonData::~AddonData() {
+    if (paInitialized) {
+        ReleasePortAudio();
+    }
+}
 
 /**
  * Initialize PortAudio/ASIO subsystem
  */
 Napi::Value Initialize(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
+    AddonData* data = env.GetInstanceData<AddonData>();
 
-    if (g_initialized) {
+    if (data->paInitialized) {
         return Napi::Boolean::New(env, true);
     }
 
-    PaError err = Pa_Initialize();
-    if (err != paNoError) {
-        Napi::Error::New(env, std::string("PortAudio init failed: ") + Pa_GetErrorText(err))
-            .ThrowAsJavaScriptException();
-        return Napi::Boolean::New(env, false);
+    std::lock_guard<std::mutex> lock(g_paMutex);
+    if (g_paUsers == 0) {
+        PaError err = Pa_Initialize();
+        if (err != paNoError) {
+            Napi::Error::New(env, std::string("PortAudio init failed: ") + Pa_GetErrorText(err))
+                .ThrowAsJavaScriptException();
+            return Napi::Boolean::New(env, false);
+        }
     }
+    g_paUsers++;
 
-    g_initialized = true;
+    data->paInitialized = true;
     return Napi::Boolean::New(env, true);
 }
 
 /**
- * Terminate PortAudio/ASIO subsystem
+ * Terminate PortAudio/ASIO subsystem. Only the last environment to let go
+ * actually terminates it.
  */
 Napi::Value Terminate(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
+    AddonData* data = env.GetInstanceData<AddonData>();
 
-    if (!g_initialized) {
+    if (!data->paInitialized) {
         return env.Undefined();
     }
 
-    Pa_Terminate();
-    g_initialized = false;
+    ReleasePortAudio();
+    data->paInitialized = false;
     return env.Undefined();
 }
 
@@ -51,7 +84,7 @@ Napi::Value Terminate(const Napi::CallbackInfo& info) {
 Napi::Value IsAvailable(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
-    if (!g_initialized) {
+    if (!IsInitialized(env)) {
         Initialize(info);
     }
 
@@ -79,7 +112,7 @@ Napi::Value GetVersionInfo(const Napi::CallbackInfo& info) {
 Napi::Value GetDevices(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
-    if (!g_initialized) {
+    if (!IsInitialized(env)) {
         Initialize(info);
     }
 
@@ -130,7 +163,7 @@ Napi::Value GetDeviceInfo(const Napi::CallbackInfo& info) {
         return env.Null();
     }
 
-    if (!g_initialized) {
+    if (!IsInitialized(env)) {
         Initialize(info);
     }
 
@@ -178,6 +211,10 @@ Napi::Value GetDeviceInfo(const Napi::CallbackInfo& info) {
  * Module initialization
  */
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
+    // Loaded once per environment; freed with it, which also releases its
+    // PortAudio reference
+    env.SetInstanceData(new AddonData());
+
     exports.Set("initialize", Napi::Function::New(env, Initialize));
     exports.Set("terminate", Napi::Function::New(env, Terminate));
     exports.Set("isAvailable", Napi::Function::New(env, IsAvailable));
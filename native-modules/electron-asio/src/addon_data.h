@@ -0,0 +1,22 @@
+/**
+ * AddonData - per-environment state of the addon
+ *
+ * The addon can be loaded by the main thread and by worker_threads at the
+ * same time, each with its own JavaScript environment. Anything tied to one
+ * environment lives here, as that environment's instance data, instead of
+ * in statics shared by all of them.
+ */
+
+#ifndef ADDON_DATA_H
+#define ADDON_DATA_H
+
+#include <napi.h>
+
+struct AddonData {
+    ~AddonData();   // Releases the PortAudio reference (addon.cc)
+
+    Napi::FunctionReference streamConstructor;
+    bool paInitialized = false;     // This environment holds a PortAudio reference
+};
+
+#endif // ADDON_DATA_H
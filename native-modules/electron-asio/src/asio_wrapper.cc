@@ -3,9 +3,339 @@
  */
 
 #include "asio_wrapper.h"
+#include "addon_data.h"
+#include "deinterleave.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <cstring>
+#include <thread>
+#include <unordered_map>
+
+#if defined(__has_include)
+#if __has_include(<pa_asio.h>)
+#include <pa_asio.h>
+#define ASIO_HAVE_PA_ASIO_H 1
+#endif
+#endif
+
+#ifndef ASIO_HAVE_PA_ASIO_H
+// Declarations from PortAudio's pa_asio.h, which deps/portaudio does not
+// ship; the ASIO host API in the bundled library reads this layout
+#define paAsioUseChannelSelectors (0x01)
+typedef struct PaAsioStreamInfo {
+    unsigned long size;
+    PaHostApiTypeId hostApiType;
+    unsigned long version;
+    unsigned long flags;
+    int* channelSelectors;
+} PaAsioStreamInfo;
+#endif
+
+// Every open AsioStream in the process, by id, so an environment other than
+// the one that created a stream (a worker_thread) can bind to it. The lock
+// also serializes swapping a stream's process callback.
+static std::mutex g_streamsMutex;
+static uint32_t g_nextStreamId = 0;
+static std::unordered_map<uint32_t, AsioStream*>& Streams() {
+    // Never destroyed: environments may be torn down in any order
+    static auto* streams = new std::unordered_map<uint32_t, AsioStream*>();
+    return *streams;
+}
+
+// The stream whose input this thread is delivering, if any
+static thread_local const AsioStream* t_delivering = nullptr;
+
+static bool IsFloat32Array(const Napi::Value& value) {
+    return value.IsTypedArray() &&
+           value.As<Napi::TypedArray>().TypedArrayType() == napi_float32_array;
+}
+
+// Device channel indices: non-negative integers, each listed once
+static bool ParseChannelList(const Napi::Array& list, std::vector<int>* channels) {
+    for (uint32_t i = 0; i < list.Length(); i++) {
+        Napi::Value entry = list.Get(i);
+        if (!entry.IsNumber()) {
+            return false;
+        }
+        int channel = entry.As<Napi::Number>().Int32Value();
+        if (channel < 0 || std::find(channels->begin(), channels->end(), channel) != channels->end()) {
+            return false;
+        }
+        channels->push_back(channel);
+    }
+    return true;
+}
+
+// True when the list is just 0..n-1, which needs no selection at all
+static bool IsLeadingRange(const std::vector<int>& channels) {
+    for (size_t i = 0; i < channels.size(); i++) {
+        if (channels[i] != static_cast<int>(i)) return false;
+    }
+    return true;
+}
+
+// File sample format for recordings and snapshots. Throws on anything else.
+static bool ParseFileFormat(Napi::Env env, const Napi::Value& value, SampleFormat* format) {
+    std::string name = value.ToString().Utf8Value();
+    if (name == "int16") {
+        *format = SampleFormat::Int16;
+    } else if (name == "int24") {
+        *format = SampleFormat::Int24;
+    } else if (name == "float32") {
+        *format = SampleFormat::Float32;
+    } else {
+        Napi::TypeError::New(env, "format must be 'int16', 'int24' or 'float32'").ThrowAsJavaScriptException();
+        return false;
+    }
+    return true;
+}
+
+// Delivery backpressure policy. Throws on anything else.
+static bool ParseBackpressure(Napi::Env env, const Napi::Value& value, BackpressurePolicy* backpressure) {
+    std::string policy = value.ToString().Utf8Value();
+    if (policy == "drop-oldest") {
+        *backpressure = BackpressurePolicy::DropOldest;
+    } else if (policy == "drop-newest") {
+        *backpressure = BackpressurePolicy::DropNewest;
+    } else if (policy == "coalesce") {
+        *backpressure = BackpressurePolicy::Coalesce;
+    } else {
+        Napi::TypeError::New(env, "backpressure must be 'drop-oldest', 'drop-newest' or 'coalesce'")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+    return true;
+}
+
+// Opus encoder options. Throws and returns false on a bad option.
+static bool ParseEncoderOptions(Napi::Env env, Napi::Object options, OpusPipelineConfig* config) {
+    if (options.Has("codec") && options.Get("codec").ToString().Utf8Value() != "opus") {
+        Napi::TypeError::New(env, "encoder.codec must be 'opus'").ThrowAsJavaScriptException();
+        return false;
+    }
+    if (options.Get("bitrate").IsNumber()) config->bitrate = options.Get("bitrate").As<Napi::Number>().Int32Value();
+    if (options.Get("complexity").IsNumber()) {
+        config->complexity = options.Get("complexity").As<Napi::Number>().Int32Value();
+    }
+    if (options.Get("frameMs").IsNumber()) config->frameMs = options.Get("frameMs").As<Napi::Number>().DoubleValue();
+    if (options.Get("threads").IsNumber()) config->threads = options.Get("threads").As<Napi::Number>().Int32Value();
+    if (options.Get("queueMs").IsNumber()) config->queueMs = options.Get("queueMs").As<Napi::Number>().DoubleValue();
+    if (options.Has("application")) {
+        std::string application = options.Get("application").ToString().Utf8Value();
+        if (application == "audio") {
+            config->application = OpusApplication::Audio;
+        } else if (application == "voip") {
+            config->application = OpusApplication::Voip;
+        } else if (application == "lowdelay") {
+            config->application = OpusApplication::LowDelay;
+        } else {
+            Napi::TypeError::New(env, "encoder.application must be 'audio', 'voip' or 'lowdelay'")
+                .ThrowAsJavaScriptException();
+            return false;
+        }
+    }
+    if (options.Has("grouping")) {
+        std::string grouping = options.Get("grouping").ToString().Utf8Value();
+        if (grouping != "stereo" && grouping != "mono") {
+            Napi::TypeError::New(env, "encoder.grouping must be 'stereo' or 'mono'").ThrowAsJavaScriptException();
+            return false;
+        }
+        config->stereoPairs = grouping == "stereo";
+    }
+    return true;
+}
+
+// Headroom kept beyond the history window, so a snapshot of the whole
+// window can be copied out while capture keeps overwriting the oldest audio
+static const double kHistoryGuardSeconds = 2.0;
+
+// Copies a window of input history to an ArrayBuffer or a WAV file on a
+// libuv worker thread and settles a promise with the result. Holds the
+// history so the stream may close while the copy is running.
+class SnapshotWorker : public Napi::AsyncWorker {
+public:
+    SnapshotWorker(Napi::Env env, std::shared_ptr<HistoryRing> history, uint64_t start, size_t frames,
+                   double sampleRate)
+        : Napi::AsyncWorker(env),
+          deferred_(Napi::Promise::Deferred::New(env)),
+          history_(std::move(history)),
+          start_(start),
+          frames_(frames),
+          sampleRate_(sampleRate),
+          format_(SampleFormat::Int24),
+          dither_(false),
+          data_(nullptr) {}
+
+    Napi::Promise Promise() const { return deferred_.Promise(); }
+
+    // Channel-major floats into memory allocated by JS, so the result is a
+    // plain ArrayBuffer wherever external buffers are not allowed
+    void ToBuffer(Napi::ArrayBuffer buffer) {
+        data_ = static_cast<float*>(buffer.Data());
+        buffer_ = Napi::Persistent(buffer);
+    }
+
+    void ToFile(const std::string& path, SampleFormat format, bool dither) {
+        path_ = path;
+        format_ = format;
+        dither_ = dither;
+    }
+
+protected:
+    void Execute() override {
+        int channels = history_->Channels();
+        std::vector<float*> planes(channels);
+        if (data_) {
+            for (int ch = 0; ch < channels; ch++) {
+                planes[ch] = data_ + ch * frames_;
+            }
+            if (!history_->Read(start_, frames_, planes.data())) {
+                SetError("Snapshot window was overwritten before it could be copied");
+            }
+            return;
+        }
+
+        // Oldest audio first, in chunks: the copy pulls away from the
+        // writer, which is overwriting the oldest end in real time
+        const size_t chunk = 65536;
+        std::vector<float> scratch(chunk * channels);
+        for (int ch = 0; ch < channels; ch++) {
+            planes[ch] = scratch.data() + ch * chunk;
+        }
+        WavWriter writer;
+        if (!writer.Open(path_, sampleRate_, channels, format_, dither_, 1 << 20, 0)) {
+            SetError("Cannot create " + path_);
+            return;
+        }
+        for (size_t done = 0; done < frames_;) {
+            size_t n = std::min(chunk, frames_ - done);
+            if (!history_->Read(start_ + done, n, planes.data())) {
+                writer.Close();
+                std::remove(path_.c_str());
+                SetError("Snapshot window was overwritten before it could be saved (disk too slow)");
+                return;
+            }
+            if (!writer.Append(planes.data(), n)) {
+                writer.Close();
+                SetError("Write failed (disk full?)");
+                return;
+            }
+            done += n;
+        }
+        if (!writer.Finish()) {
+            SetError("Write failed (disk full?)");
+        }
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("frames", Napi::Number::New(env, static_cast<double>(frames_)));
+        result.Set("seconds", Napi::Number::New(env, frames_ / sampleRate_));
+        result.Set("sampleRate", Napi::Number::New(env, sampleRate_));
+        result.Set("channels", Napi::Number::New(env, history_->Channels()));
+        if (data_) {
+            Napi::ArrayBuffer buffer = buffer_.Value();
+            Napi::Array buffers = Napi::Array::New(env, history_->Channels());
+            for (int ch = 0; ch < history_->Channels(); ch++) {
+                buffers.Set(static_cast<uint32_t>(ch),
+                            Napi::Float32Array::New(env, frames_, buffer, ch * frames_ * sizeof(float)));
+            }
+            result.Set("buffers", buffers);
+        } else {
+            result.Set("path", Napi::String::New(env, path_));
+        }
+        deferred_.Resolve(result);
+    }
 
-Napi::FunctionReference AsioStream::constructor;
+    void OnError(const Napi::Error& error) override {
+        deferred_.Reject(error.Value());
+    }
+
+private:
+    Napi::Promise::Deferred deferred_;
+    std::shared_ptr<HistoryRing> history_;
+    uint64_t start_;
+    size_t frames_;
+    double sampleRate_;
+    std::string path_;
+    SampleFormat format_;
+    bool dither_;
+    float* data_;
+    Napi::Reference<Napi::ArrayBuffer> buffer_;
+};
+
+// Finishes a recording detached from its stream on a libuv worker thread:
+// drains the ring, rewrites the headers and syncs every file, then settles
+// a promise with the summary. Owns the recorder, so the stream may start a
+// new recording or close meanwhile.
+class RecordingWorker : public Napi::AsyncWorker {
+public:
+    RecordingWorker(Napi::Env env, Recorder* recorder, double sampleRate)
+        : Napi::AsyncWorker(env),
+          deferred_(Napi::Promise::Deferred::New(env)),
+          recorder_(recorder),
+          sampleRate_(sampleRate) {}
+
+    Napi::Promise Promise() const { return deferred_.Promise(); }
+
+protected:
+    void Execute() override {
+        recorder_->Finish(&summary_);
+        recorder_.reset();
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::Object result = Napi::Object::New(env);
+        Napi::Array files = Napi::Array::New(env, summary_.files.size());
+        for (size_t i = 0; i < summary_.files.size(); i++) {
+            files.Set(static_cast<uint32_t>(i), Napi::String::New(env, summary_.files[i]));
+        }
+        result.Set("files", files);
+        result.Set("frames", Napi::Number::New(env, static_cast<double>(summary_.frames)));
+        result.Set("seconds", Napi::Number::New(env, summary_.frames / sampleRate_));
+        result.Set("bytes", Napi::Number::New(env, static_cast<double>(summary_.bytes)));
+        result.Set("droppedFrames", Napi::Number::New(env, static_cast<double>(summary_.droppedFrames)));
+        if (!summary_.error.empty()) {
+            result.Set("error", Napi::String::New(env, summary_.error));
+        }
+        deferred_.Resolve(result);
+    }
+
+    void OnError(const Napi::Error& error) override {
+        deferred_.Reject(error.Value());
+    }
+
+private:
+    Napi::Promise::Deferred deferred_;
+    std::unique_ptr<Recorder> recorder_;
+    double sampleRate_;
+    RecorderSummary summary_;
+};
+
+// Ties a pooled block to the external ArrayBuffer that exposes it to JS.
+// Holds the pool so a view collected after the stream is gone stays valid.
+struct BlockLease {
+    std::shared_ptr<BlockPool> pool;
+    AudioBlock* block;
+    bool returned;
+};
+
+static void ReturnLease(BlockLease* lease) {
+    if (!lease->returned) {
+        lease->returned = true;
+        lease->block->owner = nullptr;
+        lease->pool->Release(lease->block);
+    }
+}
+
+static void FinalizeLease(napi_env, void*, void* hint) {
+    BlockLease* lease = static_cast<BlockLease*>(hint);
+    ReturnLease(lease);
+    delete lease;
+}
 
 Napi::Object AsioStream::Init(Napi::Env env, Napi::Object exports) {
     Napi::HandleScope scope(env);
@@ -16,6 +346,24 @@ Napi::Object AsioStream::Init(Napi::Env env, Napi::Object exports) {
         InstanceMethod("close", &AsioStream::Close),
         InstanceMethod("setProcessCallback", &AsioStream::SetProcessCallback),
         InstanceMethod("write", &AsioStream::Write),
+        InstanceMethod("release", &AsioStream::Release),
+        InstanceMethod("setGraph", &AsioStream::SetGraph),
+        InstanceMethod("setBusGain", &AsioStream::SetBusGain),
+        InstanceMethod("setBusMute", &AsioStream::SetBusMute),
+        InstanceMethod("setInputGain", &AsioStream::SetInputGain),
+        InstanceMethod("setMeterCallback", &AsioStream::SetMeterCallback),
+        InstanceMethod("setPcmEnabled", &AsioStream::SetPcmEnabled),
+        InstanceMethod("resetStats", &AsioStream::ResetStats),
+        InstanceMethod("readCapture", &AsioStream::ReadCapture),
+        InstanceMethod("attachSharedRing", &AsioStream::AttachSharedRing),
+        InstanceMethod("detachSharedRing", &AsioStream::DetachSharedRing),
+        InstanceMethod("startRecording", &AsioStream::StartRecording),
+        InstanceMethod("stopRecording", &AsioStream::StopRecording),
+        InstanceMethod("snapshot", &AsioStream::Snapshot),
+        InstanceMethod("setPacketCallback", &AsioStream::SetPacketCallback),
+        InstanceMethod("subscribe", &AsioStream::Subscribe),
+        InstanceMethod("unsubscribe", &AsioStream::Unsubscribe),
+        InstanceAccessor("id", &AsioStream::GetId, nullptr),
         InstanceAccessor("isRunning", &AsioStream::GetIsRunning, nullptr),
         InstanceAccessor("inputLatency", &AsioStream::GetInputLatency, nullptr),
         InstanceAccessor("outputLatency", &AsioStream::GetOutputLatency, nullptr),
@@ -24,12 +372,14 @@ Napi::Object AsioStream::Init(Napi::Env env, Napi::Object exports) {
         InstanceAccessor("inputChannelCount", &AsioStream::GetInputChannelCount, nullptr),
         InstanceAccessor("outputChannelCount", &AsioStream::GetOutputChannelCount, nullptr),
         InstanceAccessor("stats", &AsioStream::GetStats, nullptr),
+        InstanceAccessor("profile", &AsioStream::GetProfile, nullptr),
+        InstanceAccessor("levels", &AsioStream::GetLevels, nullptr),
     });
 
-    constructor = Napi::Persistent(func);
-    constructor.SuppressDestruct();
+    env.GetInstanceData<AddonData>()->streamConstructor = Napi::Persistent(func);
 
     exports.Set("AsioStream", func);
+    exports.Set("bindProcessCallback", Napi::Function::New(env, &AsioStream::BindProcessCallback));
     return exports;
 }
 
@@ -41,16 +391,67 @@ AsioStream::AsioStream(const Napi::CallbackInfo& info)
       bufferSize_(256),
       inputChannels_(2),
       outputChannels_(0),
+      deviceInputChannels_(0),
+      deviceOutputChannels_(0),
+      selectFrames_(0),
+      oversizedInput_(0),
+      channelSelection_("none"),
+      masterInputChannels_(0),
       isRunning_(false),
       isClosed_(false),
+      planar_(false),
+      id_(0),
+      localCallback_(false),
+      remote_(nullptr),
       hasCallback_(false),
+      wakeCalls_(0),
+      delivering_(0),
+      inputPoolBlocks_(32),
+      wakePending_(false),
+      coalescedBlocks_(0),
+      framesPerDelivery_(0),
+      framesCaptured_(0),
+      deliveryCount_(0),
+      deliveredFrames_(0),
+      lastDeliveryTime_(0),
+      lastDeliveryMicros_(0),
+      deliveryFormat_(SampleFormat::Float32),
+      dither_(false),
+      resampling_(false),
+      deliverySampleRate_(0),
+      zeroCopy_(false),
+      externalBuffersAllowed_(true),
+      zeroCopyFallbacks_(0),
       callbackCount_(0),
       inputUnderflows_(0),
       outputUnderflows_(0),
-      writePos_(0) {
+      outputOverruns_(0),
+      outputStarved_(0),
+      jitterEnabled_(false),
+      latestGraph_(nullptr),
+      meterEnabled_(false),
+      hasMeterCallback_(false),
+      meterWakePending_(false),
+      meterWakeCalls_(0),
+      pcmEnabled_(true),
+      sharedRing_(nullptr),
+      sharedRingBusy_(false),
+      recorder_(nullptr),
+      recorderBusy_(false),
+      historySeconds_(0),
+      snapshots_(0),
+      hasPacketCallback_(false),
+      packetWakePending_(false),
+      packetWakeCalls_(0) {
 
     Napi::Env env = info.Env();
 
+    {
+        std::lock_guard<std::mutex> lock(g_streamsMutex);
+        id_ = ++g_nextStreamId;
+        Streams()[id_] = this;
+    }
+
     if (info.Length() < 1 || !info[0].IsObject()) {
         Napi::TypeError::New(env, "Config object expected").ThrowAsJavaScriptException();
         return;
@@ -76,28 +477,341 @@ AsioStream::AsioStream(const Napi::CallbackInfo& info)
     if (config.Has("framesPerBuffer")) {
         bufferSize_ = config.Get("framesPerBuffer").As<Napi::Number>().Uint32Value();
     }
+    if (config.Has("inputPoolBlocks")) {
+        inputPoolBlocks_ = config.Get("inputPoolBlocks").As<Napi::Number>().Uint32Value();
+        if (inputPoolBlocks_ < 2) inputPoolBlocks_ = 2;
+    }
+
+    if (config.Has("planar")) {
+        planar_ = config.Get("planar").ToBoolean();
+    }
+    if (config.Has("deliverPcm")) {
+        pcmEnabled_ = config.Get("deliverPcm").ToBoolean();
+    }
+
+    // Metering: true, or { rateHz, holdMs, decayDbPerSecond }
+    double meterRateHz = 30;
+    double meterHoldMs = 1000;
+    double meterDecayDb = 20;
+    if (config.Has("meter")) {
+        Napi::Value meter = config.Get("meter");
+        if (meter.IsObject()) {
+            Napi::Object opts = meter.As<Napi::Object>();
+            if (opts.Get("rateHz").IsNumber()) meterRateHz = opts.Get("rateHz").As<Napi::Number>().DoubleValue();
+            if (opts.Get("holdMs").IsNumber()) meterHoldMs = opts.Get("holdMs").As<Napi::Number>().DoubleValue();
+            if (opts.Get("decayDbPerSecond").IsNumber()) {
+                meterDecayDb = opts.Get("decayDbPerSecond").As<Napi::Number>().DoubleValue();
+            }
+            meterEnabled_ = true;
+        } else {
+            meterEnabled_ = meter.ToBoolean();
+        }
+    }
+
+    // Delivery coalescing: framesPerDelivery wins over deliveryIntervalMs
+    double deliveryIntervalMs = 0;
+    if (config.Has("deliveryIntervalMs")) {
+        deliveryIntervalMs = config.Get("deliveryIntervalMs").As<Napi::Number>().DoubleValue();
+    }
+    if (config.Has("framesPerDelivery")) {
+        framesPerDelivery_ = config.Get("framesPerDelivery").As<Napi::Number>().Uint32Value();
+    } else if (deliveryIntervalMs > 0) {
+        framesPerDelivery_ = static_cast<size_t>(deliveryIntervalMs * sampleRate_ / 1000.0 + 0.5);
+    }
+
+    // Callbacks using more than this fraction of their period count as
+    // deadline misses in the profile
+    double deadlineFraction = 0.75;
+    if (config.Has("deadlineFraction")) {
+        deadlineFraction = config.Get("deadlineFraction").As<Napi::Number>().DoubleValue();
+        if (!(deadlineFraction > 0.0 && deadlineFraction <= 1.0)) {
+            Napi::RangeError::New(env, "deadlineFraction must be in (0, 1]").ThrowAsJavaScriptException();
+            return;
+        }
+    }
+    profiler_.Configure(sampleRate_, deadlineFraction);
+
+    // Delivery format: float32 (default), int16, int24 (packed) or float16
+    if (config.Has("deliveryFormat")) {
+        // Anything but a string falls through to the TypeError below
+        Napi::Value value = config.Get("deliveryFormat");
+        std::string format = value.IsString() ? value.As<Napi::String>().Utf8Value() : std::string();
+        if (format == "float32") {
+            deliveryFormat_ = SampleFormat::Float32;
+        } else if (format == "int16") {
+            deliveryFormat_ = SampleFormat::Int16;
+        } else if (format == "int24") {
+            deliveryFormat_ = SampleFormat::Int24;
+        } else if (format == "float16") {
+            deliveryFormat_ = SampleFormat::Float16;
+        } else {
+            Napi::TypeError::New(env, "deliveryFormat must be 'float32', 'int16', 'int24' or 'float16'")
+                .ThrowAsJavaScriptException();
+            return;
+        }
+    }
+    if (config.Has("dither")) {
+        dither_ = config.Get("dither").ToBoolean();
+    }
+    ditherState_.Seed(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(this)));
+
+    // Delivery sample-rate conversion
+    ResampleQuality resampleQuality = ResampleQuality::Medium;
+    int resampleThreads = -1;   // Auto
+    if (config.Has("deliverySampleRate")) {
+        deliverySampleRate_ = config.Get("deliverySampleRate").As<Napi::Number>().DoubleValue();
+    }
+    if (config.Has("resampleQuality")) {
+        Napi::Value value = config.Get("resampleQuality");
+        std::string quality = value.IsString() ? value.As<Napi::String>().Utf8Value() : std::string();
+        if (quality == "low") {
+            resampleQuality = ResampleQuality::Low;
+        } else if (quality == "medium") {
+            resampleQuality = ResampleQuality::Medium;
+        } else if (quality == "high") {
+            resampleQuality = ResampleQuality::High;
+        } else {
+            Napi::TypeError::New(env, "resampleQuality must be 'low', 'medium' or 'high'")
+                .ThrowAsJavaScriptException();
+            return;
+        }
+    }
+    if (config.Has("resampleThreads")) {
+        resampleThreads = config.Get("resampleThreads").As<Napi::Number>().Int32Value();
+    }
+
+    if (config.Has("zeroCopy")) {
+        zeroCopy_ = config.Get("zeroCopy").ToBoolean();
+    }
+    if (config.Get("historySeconds").IsNumber()) {
+        historySeconds_ = config.Get("historySeconds").As<Napi::Number>().DoubleValue();
+        if (!(historySeconds_ >= 0)) {
+            Napi::RangeError::New(env, "historySeconds must not be negative").ThrowAsJavaScriptException();
+            return;
+        }
+    }
+
+    // Output jitter buffer: true, or { minMs, maxMs, targetMs }
+    JitterBufferConfig jitterConfig;
+    if (config.Has("jitterBuffer")) {
+        Napi::Value jitter = config.Get("jitterBuffer");
+        if (jitter.IsObject()) {
+            Napi::Object opts = jitter.As<Napi::Object>();
+            if (opts.Get("minMs").IsNumber()) jitterConfig.minMs = opts.Get("minMs").As<Napi::Number>().DoubleValue();
+            if (opts.Get("maxMs").IsNumber()) jitterConfig.maxMs = opts.Get("maxMs").As<Napi::Number>().DoubleValue();
+            if (opts.Get("targetMs").IsNumber()) {
+                jitterConfig.initialMs = opts.Get("targetMs").As<Napi::Number>().DoubleValue();
+            }
+            jitterEnabled_ = true;
+        } else {
+            jitterEnabled_ = jitter.ToBoolean();
+        }
+        if (jitterConfig.minMs < 0 || jitterConfig.maxMs <= 0 || jitterConfig.initialMs < 0) {
+            Napi::RangeError::New(env, "jitterBuffer times must be positive").ThrowAsJavaScriptException();
+            return;
+        }
+    }
+
+    // Delivery backpressure
+    BackpressurePolicy backpressure = BackpressurePolicy::DropOldest;
+    size_t queueDepth = 16;
+    if (config.Has("queueDepth")) {
+        queueDepth = config.Get("queueDepth").As<Napi::Number>().Uint32Value();
+        if (queueDepth < 1) queueDepth = 1;
+    }
+    if (config.Has("backpressure") && !ParseBackpressure(env, config.Get("backpressure"), &backpressure)) {
+        return;
+    }
+
+    // Every queued block plus the one being filled and the one being delivered
+    if (inputPoolBlocks_ < queueDepth + 2) {
+        inputPoolBlocks_ = queueDepth + 2;
+    }
+    coalesceScratch_.reserve(queueDepth);
 
-    // Parse input/output channels
+    // Parse input/output channels: an array selects device channels, a
+    // number takes the first N
+    std::vector<int> inputSelect;
+    std::vector<int> outputSelect;
     if (config.Has("inputChannels")) {
         Napi::Value val = config.Get("inputChannels");
         if (val.IsArray()) {
-            inputChannels_ = val.As<Napi::Array>().Length();
+            if (!ParseChannelList(val.As<Napi::Array>(), &inputSelect)) {
+                Napi::TypeError::New(env, "inputChannels must list distinct non-negative channel indices")
+                    .ThrowAsJavaScriptException();
+                return;
+            }
+            inputChannels_ = static_cast<int>(inputSelect.size());
         } else if (val.IsNumber()) {
             inputChannels_ = val.As<Napi::Number>().Int32Value();
         }
     }
     if (config.Has("channels")) {
         inputChannels_ = config.Get("channels").As<Napi::Number>().Int32Value();
+        inputSelect.clear();
     }
     if (config.Has("outputChannels")) {
         Napi::Value val = config.Get("outputChannels");
         if (val.IsArray()) {
-            outputChannels_ = val.As<Napi::Array>().Length();
+            if (!ParseChannelList(val.As<Napi::Array>(), &outputSelect)) {
+                Napi::TypeError::New(env, "outputChannels must list distinct non-negative channel indices")
+                    .ThrowAsJavaScriptException();
+                return;
+            }
+            outputChannels_ = static_cast<int>(outputSelect.size());
         } else if (val.IsNumber()) {
             outputChannels_ = val.As<Napi::Number>().Int32Value();
         }
     }
 
+    // Open the device: a virtual device (no hardware, same callback) or a
+    // PortAudio stream
+    bool isVirtual = config.Has("device") && config.Get("device").IsString() &&
+                     config.Get("device").As<Napi::String>().Utf8Value() == "virtual";
+    if (config.Has("virtualDevice") && config.Get("virtualDevice").IsObject()) {
+        isVirtual = true;
+    }
+    if (isVirtual) {
+        Napi::Object options = config.Has("virtualDevice") && config.Get("virtualDevice").IsObject()
+            ? config.Get("virtualDevice").As<Napi::Object>() : Napi::Object::New(env);
+        if (!OpenVirtualDevice(env, options, inputSelect, outputSelect)) {
+            return;
+        }
+    } else if (!OpenDevice(env, inputSelect, outputSelect)) {
+        return;
+    }
+
+    // Aggregate members: their input channels follow this device's
+    masterInputChannels_ = inputChannels_;
+    if (config.Has("aggregate")) {
+        if (!config.Get("aggregate").IsArray()) {
+            Napi::TypeError::New(env, "aggregate must be an array of device configs").ThrowAsJavaScriptException();
+            return;
+        }
+        if (!OpenAggregate(env, config.Get("aggregate").As<Napi::Array>())) {
+            return;
+        }
+    }
+
+    // Pre-allocate write ring (four periods of headroom), one lane per channel
+    // when planar. With coalesced delivery JS writes a whole interval at a
+    // time, so leave room for two of those on top of the device period.
+    size_t ringFrames = std::max<size_t>(bufferSize_ * 4, framesPerDelivery_ * 2 + bufferSize_);
+    if (jitterEnabled_) {
+        // Room for the largest reserve plus a burst of the same size
+        ringFrames = std::max(ringFrames, static_cast<size_t>(jitterConfig.maxMs * sampleRate_ / 1000.0) * 2);
+    }
+    if (planar_) {
+        outputRing_.Reset(ringFrames, outputChannels_);
+    } else {
+        outputRing_.Reset(ringFrames * outputChannels_);
+    }
+    writeSources_.resize(outputChannels_);
+    writeFrames_.resize(outputChannels_);
+
+    // Pre-allocate input blocks big enough for one delivery; an unspecified
+    // buffer size gets a generous upper bound per period
+    size_t maxFrames = bufferSize_ > 0 ? bufferSize_ : 4096;
+    if (jitterEnabled_ && outputChannels_ > 0) {
+        jitterConfig.sampleRate = sampleRate_;
+        jitterConfig.channels = outputChannels_;
+        jitterConfig.maxFrames = maxFrames;
+        jitterConfig.planar = planar_;
+        jitter_.Reset(jitterConfig);
+    } else {
+        jitterEnabled_ = false;
+    }
+    InputCaptureConfig capture;
+    capture.channels = inputChannels_;
+    capture.blockFrames = std::max(maxFrames, framesPerDelivery_);
+    capture.framesPerDelivery = framesPerDelivery_;
+    capture.poolBlocks = inputPoolBlocks_;
+    capture.queueDepth = queueDepth;
+    capture.policy = backpressure;
+    capture.planarInput = planar_;
+    capture.planarBlocks = zeroCopy_;
+    capture_.Reset(capture);
+    capture_.SetWake(WakeInput, this);
+    subscribers_.assign(InputCapture::kMaxSubscribers, nullptr);
+    channelPtrs_.reserve(inputChannels_);
+    stagePlanes_.reserve(inputChannels_);
+
+    // Resample on the delivery path when the device rate differs from the
+    // rate consumers want; wide streams split channels across a small pool
+    if (deliverySampleRate_ > 0 && std::lround(deliverySampleRate_) != std::lround(sampleRate_)) {
+        resampler_.Reset(sampleRate_, deliverySampleRate_, inputChannels_, resampleQuality);
+        resampling_ = true;
+        if (resampleThreads < 0) {
+            int cores = static_cast<int>(std::thread::hardware_concurrency());
+            resampleThreads = inputChannels_ >= 16 ? std::min({4, cores - 1, inputChannels_ / 8}) : 0;
+        }
+        if (resampleThreads > 0) {
+            resampleWorkers_.reset(new ChannelWorkers(resampleThreads));
+        }
+    } else {
+        deliverySampleRate_ = sampleRate_;
+    }
+    meter_.Reset(inputChannels_, sampleRate_, meterRateHz, meterHoldMs / 1000.0, meterDecayDb);
+
+    // Scratch for native channel selection, sized like the input blocks
+    selectFrames_ = maxFrames;
+    if (!inputMap_.empty()) {
+        gatherInput_.resize(planar_ ? 0 : selectFrames_ * inputChannels_);
+        inputPlanes_.resize(inputChannels_);
+    }
+    if (!outputMap_.empty()) {
+        scatterOutput_.resize(planar_ ? 0 : selectFrames_ * outputChannels_);
+        outputPlanes_.resize(outputChannels_);
+    }
+
+    // Aggregate scratch: members are pulled planar, then joined to this
+    // device's channels in the stream's layout
+    if (!aggregate_.empty()) {
+        int memberChannels = inputChannels_ - masterInputChannels_;
+        aggregatePlanar_.assign(selectFrames_ * memberChannels, 0.0f);
+        memberPlanes_.resize(memberChannels);
+        for (int ch = 0; ch < memberChannels; ch++) {
+            memberPlanes_[ch] = aggregatePlanar_.data() + ch * selectFrames_;
+        }
+        if (planar_) {
+            aggregatePlanes_.resize(inputChannels_);
+        } else {
+            aggregateInput_.resize(selectFrames_ * inputChannels_);
+        }
+        for (auto& member : aggregate_) {
+            member->compensator.Reset(member->channels, sampleRate_, member->sampleRate,
+                                      selectFrames_, member->bufferSize);
+        }
+    }
+
+    // Input history for snapshot(), allocated once up front
+    if (historySeconds_ > 0 && inputChannels_ > 0) {
+        history_ = std::make_shared<HistoryRing>();
+        history_->Reset(inputChannels_,
+                        static_cast<size_t>((historySeconds_ + kHistoryGuardSeconds) * sampleRate_));
+    }
+
+    // Opus encoder: true for the defaults, or { bitrate, complexity, frameMs, ... }
+    if (config.Has("encoder") && config.Get("encoder").ToBoolean() && inputChannels_ > 0) {
+        OpusPipelineConfig encoderConfig;
+        Napi::Value encoder = config.Get("encoder");
+        if (encoder.IsObject() && !ParseEncoderOptions(env, encoder.As<Napi::Object>(), &encoderConfig)) {
+            return;
+        }
+        encoderConfig.sampleRate = sampleRate_;
+        encoderConfig.channels = inputChannels_;
+        encoder_.reset(new OpusPipeline());
+        encoder_->SetWake(WakePackets, this);
+        std::string error;
+        if (!encoder_->Start(encoderConfig, &error)) {
+            encoder_.reset();
+            Napi::Error::New(env, error).ThrowAsJavaScriptException();
+            return;
+        }
+    }
+}
+
+bool AsioStream::OpenDevice(Napi::Env env, std::vector<int>& inputSelect, std::vector<int>& outputSelect) {
     // Use default ASIO device if not specified
     if (deviceIndex_ < 0) {
         PaHostApiIndex asioHostApi = Pa_HostApiTypeIdToHostApiIndex(paASIO);
@@ -113,16 +827,68 @@ AsioStream::AsioStream(const Napi::CallbackInfo& info)
     const PaDeviceInfo* devInfo = Pa_GetDeviceInfo(deviceIndex_);
     if (!devInfo) {
         Napi::Error::New(env, "Invalid ASIO device").ThrowAsJavaScriptException();
-        return;
+        return false;
     }
 
     // Clamp channels to device capabilities
+    for (int channel : inputSelect) {
+        if (channel >= devInfo->maxInputChannels) {
+            Napi::RangeError::New(env, "Input channel index out of range for this device").ThrowAsJavaScriptException();
+            return false;
+        }
+    }
+    for (int channel : outputSelect) {
+        if (channel >= devInfo->maxOutputChannels) {
+            Napi::RangeError::New(env, "Output channel index out of range for this device").ThrowAsJavaScriptException();
+            return false;
+        }
+    }
     if (inputChannels_ > devInfo->maxInputChannels) {
         inputChannels_ = devInfo->maxInputChannels;
     }
     if (outputChannels_ > devInfo->maxOutputChannels) {
         outputChannels_ = devInfo->maxOutputChannels;
     }
+    if (IsLeadingRange(inputSelect)) inputSelect.clear();
+    if (IsLeadingRange(outputSelect)) outputSelect.clear();
+
+    // Channel selection: the ASIO host API opens exactly the listed channels
+    // through channel selectors; other host APIs open the leading range that
+    // covers the selection and the callback gathers/scatters natively
+    const PaHostApiInfo* hostApiInfo = Pa_GetHostApiInfo(devInfo->hostApi);
+    bool asioSelectors = hostApiInfo && hostApiInfo->type == paASIO;
+    deviceInputChannels_ = inputChannels_;
+    deviceOutputChannels_ = outputChannels_;
+
+    PaAsioStreamInfo asioInputInfo = {};
+    PaAsioStreamInfo asioOutputInfo = {};
+    if (!inputSelect.empty()) {
+        if (asioSelectors) {
+            asioInputInfo.size = sizeof(PaAsioStreamInfo);
+            asioInputInfo.hostApiType = paASIO;
+            asioInputInfo.version = 1;
+            asioInputInfo.flags = paAsioUseChannelSelectors;
+            asioInputInfo.channelSelectors = inputSelect.data();
+        } else {
+            inputMap_ = inputSelect;
+            deviceInputChannels_ = *std::max_element(inputSelect.begin(), inputSelect.end()) + 1;
+        }
+    }
+    if (!outputSelect.empty()) {
+        if (asioSelectors) {
+            asioOutputInfo.size = sizeof(PaAsioStreamInfo);
+            asioOutputInfo.hostApiType = paASIO;
+            asioOutputInfo.version = 1;
+            asioOutputInfo.flags = paAsioUseChannelSelectors;
+            asioOutputInfo.channelSelectors = outputSelect.data();
+        } else {
+            outputMap_ = outputSelect;
+            deviceOutputChannels_ = *std::max_element(outputSelect.begin(), outputSelect.end()) + 1;
+        }
+    }
+    if (!inputSelect.empty() || !outputSelect.empty()) {
+        channelSelection_ = asioSelectors ? "asio" : "native";
+    }
 
     // Open stream
     PaStreamParameters inputParams = {};
@@ -132,19 +898,19 @@ AsioStream::AsioStream(const Napi::CallbackInfo& info)
 
     if (inputChannels_ > 0) {
         inputParams.device = deviceIndex_;
-        inputParams.channelCount = inputChannels_;
-        inputParams.sampleFormat = paFloat32;
+        inputParams.channelCount = deviceInputChannels_;
+        inputParams.sampleFormat = planar_ ? (paFloat32 | paNonInterleaved) : paFloat32;
         inputParams.suggestedLatency = devInfo->defaultLowInputLatency;
-        inputParams.hostApiSpecificStreamInfo = nullptr;
+        inputParams.hostApiSpecificStreamInfo = asioInputInfo.size ? &asioInputInfo : nullptr;
         pInput = &inputParams;
     }
 
     if (outputChannels_ > 0) {
         outputParams.device = deviceIndex_;
-        outputParams.channelCount = outputChannels_;
-        outputParams.sampleFormat = paFloat32;
+        outputParams.channelCount = deviceOutputChannels_;
+        outputParams.sampleFormat = planar_ ? (paFloat32 | paNonInterleaved) : paFloat32;
         outputParams.suggestedLatency = devInfo->defaultLowOutputLatency;
-        outputParams.hostApiSpecificStreamInfo = nullptr;
+        outputParams.hostApiSpecificStreamInfo = asioOutputInfo.size ? &asioOutputInfo : nullptr;
         pOutput = &outputParams;
     }
 
@@ -163,14 +929,235 @@ AsioStream::AsioStream(const Napi::CallbackInfo& info)
         std::string errMsg = "Failed to open ASIO stream: ";
         errMsg += Pa_GetErrorText(err);
         Napi::Error::New(env, errMsg).ThrowAsJavaScriptException();
-        return;
+        return false;
+    }
+    return true;
+}
+
+// Signal and timing options shared by the stream's own virtual device and
+// virtual aggregate members. Throws and returns false on a bad option.
+static bool ParseVirtualOptions(Napi::Env env, Napi::Object options, VirtualDeviceConfig* config) {
+    VirtualDeviceConfig& device = *config;
+
+    if (options.Has("signal")) {
+        Napi::Value value = options.Get("signal");
+        std::string signal = value.IsString() ? value.As<Napi::String>().Utf8Value() : std::string();
+        if (signal == "silence") {
+            device.signal = VirtualSignal::Silence;
+        } else if (signal == "sine") {
+            device.signal = VirtualSignal::Sine;
+        } else if (signal == "noise") {
+            device.signal = VirtualSignal::Noise;
+        } else if (signal == "impulse") {
+            device.signal = VirtualSignal::Impulse;
+        } else if (signal == "file") {
+            device.signal = VirtualSignal::File;
+        } else {
+            Napi::TypeError::New(env, "virtualDevice.signal must be 'silence', 'sine', 'noise', 'impulse' or 'file'")
+                .ThrowAsJavaScriptException();
+            return false;
+        }
+    }
+    if (options.Has("file")) {
+        if (!options.Get("file").IsString()) {
+            Napi::TypeError::New(env, "virtualDevice.file must be a path").ThrowAsJavaScriptException();
+            return false;
+        }
+        device.file = options.Get("file").As<Napi::String>().Utf8Value();
+        if (!options.Has("signal")) {
+            device.signal = VirtualSignal::File;
+        }
+    }
+    if (options.Get("frequency").IsNumber()) device.frequency = options.Get("frequency").As<Napi::Number>().DoubleValue();
+    if (options.Get("amplitude").IsNumber()) device.amplitude = options.Get("amplitude").As<Napi::Number>().DoubleValue();
+    if (options.Get("impulseInterval").IsNumber()) {
+        device.impulseInterval = options.Get("impulseInterval").As<Napi::Number>().Uint32Value();
+    }
+    if (options.Get("jitterMs").IsNumber()) device.jitterMs = options.Get("jitterMs").As<Napi::Number>().DoubleValue();
+    if (options.Get("clockPpm").IsNumber()) device.clockPpm = options.Get("clockPpm").As<Napi::Number>().DoubleValue();
+    if (options.Get("missEvery").IsNumber()) device.missEvery = options.Get("missEvery").As<Napi::Number>().Uint32Value();
+    if (options.Get("captureSeconds").IsNumber()) {
+        device.captureSeconds = options.Get("captureSeconds").As<Napi::Number>().DoubleValue();
+    }
+    return true;
+}
+
+bool AsioStream::OpenVirtualDevice(Napi::Env env, Napi::Object options,
+                                   std::vector<int>& inputSelect, std::vector<int>& outputSelect) {
+    VirtualDeviceConfig device;
+    device.sampleRate = sampleRate_;
+    device.framesPerBuffer = bufferSize_ > 0 ? bufferSize_ : 256;
+    device.planar = planar_;
+    if (!ParseVirtualOptions(env, options, &device)) {
+        return false;
+    }
+
+    // Any channel count is available; selections are gathered natively as
+    // on host APIs without channel selectors
+    if (IsLeadingRange(inputSelect)) inputSelect.clear();
+    if (IsLeadingRange(outputSelect)) outputSelect.clear();
+    deviceInputChannels_ = inputChannels_;
+    deviceOutputChannels_ = outputChannels_;
+    if (!inputSelect.empty()) {
+        inputMap_ = inputSelect;
+        deviceInputChannels_ = *std::max_element(inputSelect.begin(), inputSelect.end()) + 1;
+    }
+    if (!outputSelect.empty()) {
+        outputMap_ = outputSelect;
+        deviceOutputChannels_ = *std::max_element(outputSelect.begin(), outputSelect.end()) + 1;
+    }
+    if (!inputSelect.empty() || !outputSelect.empty()) {
+        channelSelection_ = "native";
+    }
+    device.inputChannels = deviceInputChannels_;
+    device.outputChannels = deviceOutputChannels_;
+
+    virtualDevice_.reset(new VirtualDevice());
+    std::string error;
+    if (!virtualDevice_->Open(device, PaCallback, this, &error)) {
+        virtualDevice_.reset();
+        Napi::Error::New(env, "Failed to open virtual device: " + error).ThrowAsJavaScriptException();
+        return false;
+    }
+    bufferSize_ = virtualDevice_->Config().framesPerBuffer;
+    return true;
+}
+
+bool AsioStream::OpenAggregate(Napi::Env env, Napi::Array members) {
+    // PortAudio's ASIO host API can only load one driver at a time
+    const PaDeviceInfo* ownInfo = stream_ ? Pa_GetDeviceInfo(deviceIndex_) : nullptr;
+    const PaHostApiInfo* ownHost = ownInfo ? Pa_GetHostApiInfo(ownInfo->hostApi) : nullptr;
+    bool ownAsio = ownHost && ownHost->type == paASIO;
+
+    for (uint32_t i = 0; i < members.Length(); i++) {
+        if (!members.Get(i).IsObject()) {
+            Napi::TypeError::New(env, "aggregate entries must be device config objects").ThrowAsJavaScriptException();
+            return false;
+        }
+        Napi::Object options = members.Get(i).As<Napi::Object>();
+
+        std::unique_ptr<AggregateMember> member(new AggregateMember());
+        member->channels = 2;
+        if (options.Get("inputChannels").IsNumber()) {
+            member->channels = options.Get("inputChannels").As<Napi::Number>().Int32Value();
+        }
+        if (member->channels < 1) {
+            Napi::RangeError::New(env, "aggregate inputChannels must be at least 1").ThrowAsJavaScriptException();
+            return false;
+        }
+        member->sampleRate = options.Get("sampleRate").IsNumber()
+            ? options.Get("sampleRate").As<Napi::Number>().DoubleValue() : sampleRate_;
+        member->bufferSize = options.Get("bufferSize").IsNumber()
+            ? options.Get("bufferSize").As<Napi::Number>().Uint32Value() : (bufferSize_ > 0 ? bufferSize_ : 256);
+        if (member->sampleRate <= 0 || member->bufferSize == 0) {
+            Napi::RangeError::New(env, "aggregate sampleRate and bufferSize must be positive").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        Napi::Value device = options.Get("device");
+        bool isVirtual = (device.IsString() && device.As<Napi::String>().Utf8Value() == "virtual") ||
+                         options.Get("virtualDevice").IsObject();
+        if (isVirtual) {
+            VirtualDeviceConfig virtualConfig;
+            virtualConfig.sampleRate = member->sampleRate;
+            virtualConfig.framesPerBuffer = member->bufferSize;
+            virtualConfig.inputChannels = member->channels;
+            virtualConfig.outputChannels = 0;
+            Napi::Object virtualOptions = options.Get("virtualDevice").IsObject()
+                ? options.Get("virtualDevice").As<Napi::Object>() : Napi::Object::New(env);
+            if (!ParseVirtualOptions(env, virtualOptions, &virtualConfig)) {
+                return false;
+            }
+            member->virtualDevice.reset(new VirtualDevice());
+            std::string error;
+            if (!member->virtualDevice->Open(virtualConfig, AggregateCallback, member.get(), &error)) {
+                Napi::Error::New(env, "Failed to open virtual aggregate device: " + error).ThrowAsJavaScriptException();
+                return false;
+            }
+        } else {
+            member->deviceIndex = device.IsNumber() ? device.As<Napi::Number>().Int32Value() : -1;
+            const PaDeviceInfo* devInfo = Pa_GetDeviceInfo(member->deviceIndex);
+            if (!devInfo) {
+                Napi::Error::New(env, "Invalid aggregate device").ThrowAsJavaScriptException();
+                return false;
+            }
+            if (stream_ && member->deviceIndex == deviceIndex_) {
+                Napi::Error::New(env, "An aggregate member cannot be the stream's own device").ThrowAsJavaScriptException();
+                return false;
+            }
+            const PaHostApiInfo* hostInfo = Pa_GetHostApiInfo(devInfo->hostApi);
+            if (ownAsio && hostInfo && hostInfo->type == paASIO) {
+                Napi::Error::New(env, "Only one ASIO driver can be open at a time; open aggregate members "
+                                      "through another host API").ThrowAsJavaScriptException();
+                return false;
+            }
+            if (member->channels > devInfo->maxInputChannels) {
+                Napi::RangeError::New(env, "aggregate inputChannels exceeds the device's input channels")
+                    .ThrowAsJavaScriptException();
+                return false;
+            }
+
+            PaStreamParameters inputParams = {};
+            inputParams.device = member->deviceIndex;
+            inputParams.channelCount = member->channels;
+            inputParams.sampleFormat = paFloat32;
+            inputParams.suggestedLatency = devInfo->defaultLowInputLatency;
+            PaError err = Pa_OpenStream(&member->stream, &inputParams, nullptr, member->sampleRate,
+                                        member->bufferSize, paClipOff, AggregateCallback, member.get());
+            if (err != paNoError) {
+                std::string errMsg = "Failed to open aggregate device: ";
+                errMsg += Pa_GetErrorText(err);
+                Napi::Error::New(env, errMsg).ThrowAsJavaScriptException();
+                return false;
+            }
+        }
+
+        inputChannels_ += member->channels;
+        aggregate_.push_back(std::move(member));
+    }
+    return true;
+}
+
+bool AsioStream::StartAggregate() {
+    for (auto& member : aggregate_) {
+        // Relock from scratch: the gap across a stop/start is not drift
+        member->compensator.Reset(member->channels, sampleRate_, member->sampleRate,
+                                  selectFrames_, member->bufferSize);
+        bool started = member->virtualDevice ? member->virtualDevice->Start()
+                                             : Pa_StartStream(member->stream) == paNoError;
+        if (!started) {
+            StopAggregate();
+            return false;
+        }
+    }
+    return true;
+}
+
+void AsioStream::StopAggregate() {
+    for (auto& member : aggregate_) {
+        if (member->virtualDevice) {
+            member->virtualDevice->Stop();
+        } else if (member->stream && Pa_IsStreamStopped(member->stream) == 0) {
+            Pa_StopStream(member->stream);
+        }
     }
+}
 
-    // Pre-allocate write buffer
-    writeBuffer_.resize(bufferSize_ * outputChannels_ * 4);
+void AsioStream::CloseAggregate() {
+    StopAggregate();
+    // Members stay listed so their final stats remain readable
+    for (auto& member : aggregate_) {
+        if (member->stream) {
+            Pa_CloseStream(member->stream);
+            member->stream = nullptr;
+        }
+    }
 }
 
 AsioStream::~AsioStream() {
+    if (virtualDevice_) {
+        virtualDevice_->Stop();
+    }
     if (!isClosed_) {
         if (stream_) {
             if (isRunning_) {
@@ -178,7 +1165,24 @@ AsioStream::~AsioStream() {
             }
             Pa_CloseStream(stream_);
         }
+        CloseAggregate();
+    }
+    // No other thread can find the stream from here on; wait out one that
+    // is still delivering to a worker
+    {
+        std::lock_guard<std::mutex> lock(g_streamsMutex);
+        Streams().erase(id_);
     }
+    // A local TSFN is already finalized: it holds a Ref until then
+    localCallback_ = false;
+    UnbindProcessCallback();
+    AwaitDelivery();
+
+    // No callback can be running once the stream is closed
+    delete sharedRing_.load();
+    delete recorder_.load();
+    // Join the encoder thread before the members its wake hook touches go
+    encoder_.reset();
 }
 
 int AsioStream::PaCallback(
@@ -190,6 +1194,8 @@ int AsioStream::PaCallback(
     void* userData
 ) {
     AsioStream* self = static_cast<AsioStream*>(userData);
+    CallbackProfiler& profiler = self->profiler_;
+    uint64_t start = MonotonicNanos();
 
     self->callbackCount_++;
 
@@ -200,158 +1206,1425 @@ int AsioStream::PaCallback(
         self->outputUnderflows_++;
     }
 
-    // Handle output from write buffer
-    if (outputBuffer && self->outputChannels_ > 0) {
-        float* out = static_cast<float*>(outputBuffer);
-        size_t samplesToWrite = framesPerBuffer * self->outputChannels_;
+    // Native channel selection: from here on the buffers hold only the
+    // selected channels, in the order they were requested
+    void* deviceOutput = outputBuffer;
+    if (inputBuffer && !self->inputMap_.empty()) {
+        inputBuffer = self->SelectInput(inputBuffer, framesPerBuffer);
+    }
+    if (outputBuffer && !self->outputMap_.empty()) {
+        outputBuffer = self->SelectOutput(outputBuffer, framesPerBuffer);
+    }
+
+    // Aggregate members' channels follow this device's, resampled onto its clock
+    uint64_t aggregateNanos = 0;
+    if (!self->aggregate_.empty()) {
+        uint64_t begin = MonotonicNanos();
+        inputBuffer = self->AggregateInput(inputBuffer, framesPerBuffer);
+        aggregateNanos = MonotonicNanos() - begin;
+        profiler.Record(ProfileStage::Aggregate, aggregateNanos);
+    }
 
-        std::lock_guard<std::mutex> lock(self->writeMutex_);
-        size_t available = self->writePos_;
+    // Handle output from write ring
+    if (outputBuffer && self->outputChannels_ > 0 && self->jitterEnabled_) {
+        // Partial periods play what is queued and conceal the rest
+        if (self->jitter_.Play(self->outputRing_, outputBuffer, framesPerBuffer) < framesPerBuffer) {
+            self->outputStarved_++;
+        }
+    } else if (outputBuffer && self->outputChannels_ > 0 && self->planar_) {
+        float* const* out = static_cast<float* const*>(outputBuffer);
 
-        if (available >= samplesToWrite) {
-            std::memcpy(out, self->writeBuffer_.data(), samplesToWrite * sizeof(float));
-            // Shift remaining data
-            if (available > samplesToWrite) {
-                std::memmove(self->writeBuffer_.data(),
-                            self->writeBuffer_.data() + samplesToWrite,
-                            (available - samplesToWrite) * sizeof(float));
+        if (self->outputRing_.ReadAvailable() >= framesPerBuffer) {
+            self->outputRing_.ReadLanes(out, framesPerBuffer);
+        } else {
+            // Not enough data, output silence
+            for (int ch = 0; ch < self->outputChannels_; ch++) {
+                std::memset(out[ch], 0, framesPerBuffer * sizeof(float));
             }
-            self->writePos_ -= samplesToWrite;
+            self->outputStarved_++;
+        }
+    } else if (outputBuffer && self->outputChannels_ > 0) {
+        float* out = static_cast<float*>(outputBuffer);
+        size_t samplesToWrite = framesPerBuffer * self->outputChannels_;
+
+        if (self->outputRing_.ReadAvailable() >= samplesToWrite) {
+            self->outputRing_.Read(out, samplesToWrite);
         } else {
             // Not enough data, output silence
             std::memset(out, 0, samplesToWrite * sizeof(float));
+            self->outputStarved_++;
         }
     }
+    uint64_t mark = MonotonicNanos();
+    profiler.Record(ProfileStage::Output, mark - start - aggregateNanos);
 
-    // Send input to JavaScript callback
-    if (inputBuffer && self->hasCallback_ && self->tsfn_) {
-        const float* in = static_cast<const float*>(inputBuffer);
-        size_t sampleCount = framesPerBuffer * self->inputChannels_;
-
-        // Copy input data
-        float* dataCopy = new float[sampleCount];
-        std::memcpy(dataCopy, in, sampleCount * sizeof(float));
-
-        // Create callback data
-        struct CallbackData {
-            float* data;
-            size_t size;
-            int channels;
-        };
-
-        CallbackData* cbData = new CallbackData{dataCopy, sampleCount, self->inputChannels_};
-
-        self->tsfn_.NonBlockingCall(cbData, [](Napi::Env env, Napi::Function jsCallback, CallbackData* data) {
-            // Create input buffer arrays
-            Napi::Array inputBuffers = Napi::Array::New(env, data->channels);
-            size_t framesPerChannel = data->size / data->channels;
-
-            for (int ch = 0; ch < data->channels; ch++) {
-                Napi::Float32Array channelData = Napi::Float32Array::New(env, framesPerChannel);
-                for (size_t i = 0; i < framesPerChannel; i++) {
-                    channelData[i] = data->data[i * data->channels + ch];
+    // Native monitoring graph, layered on top of write() playback
+    if (outputBuffer && self->outputChannels_ > 0) {
+        if (MixGraph* graph = self->graph_.Acquire()) {
+            graph->Process(inputBuffer, outputBuffer, framesPerBuffer, self->planar_);
+            uint64_t now = MonotonicNanos();
+            profiler.Record(ProfileStage::Graph, now - mark);
+            mark = now;
+        }
+    }
+
+    // Meter input; wake the meter callback when a snapshot is published
+    if (inputBuffer && self->meterEnabled_) {
+        if (self->meter_.Process(inputBuffer, framesPerBuffer, self->planar_)) {
+            // ReleaseMeterCallback waits for meterWakeCalls_ to reach zero
+            // after clearing the flag, so the handle stays valid meanwhile
+            self->meterWakeCalls_.fetch_add(1);
+            if (self->hasMeterCallback_ && !self->meterWakePending_.exchange(true)) {
+                if (self->meterTsfn_.NonBlockingCall() != napi_ok) {
+                    self->meterWakePending_ = false;
                 }
-                inputBuffers.Set(ch, channelData);
             }
+            self->meterWakeCalls_.fetch_sub(1);
+        }
+    }
 
-            // Output buffers (empty for now)
-            Napi::Array outputBuffers = Napi::Array::New(env, 0);
+    // Shared ring for same-process readers; the busy flag lets a detach on
+    // the JS thread wait until this callback is done with the ring
+    if (inputBuffer && self->sharedRing_.load(std::memory_order_relaxed)) {
+        self->sharedRingBusy_.store(true);
+        if (SharedRingWriter* ring = self->sharedRing_.load()) {
+            ring->Write(inputBuffer, framesPerBuffer, self->planar_);
+        }
+        self->sharedRingBusy_.store(false);
+    }
+    // Native recorder: deinterleave into its ring; the writer thread does the rest
+    if (inputBuffer && self->recorder_.load(std::memory_order_relaxed)) {
+        self->recorderBusy_.store(true);
+        if (Recorder* recorder = self->recorder_.load()) {
+            recorder->Push(inputBuffer, framesPerBuffer, self->planar_);
+        }
+        self->recorderBusy_.store(false);
+    }
+    if (inputBuffer && self->history_) {
+        self->history_->Write(inputBuffer, framesPerBuffer, self->planar_);
+    }
+    if (inputBuffer && self->encoder_) {
+        self->encoder_->Push(inputBuffer, framesPerBuffer, self->planar_, start);
+    }
+    uint64_t now = MonotonicNanos();
+    profiler.Record(ProfileStage::Tap, now - mark);
+    mark = now;
 
-            jsCallback.Call({inputBuffers, outputBuffers});
+    // Send input to JavaScript callback
+    if (inputBuffer) {
+        self->framesCaptured_.fetch_add(framesPerBuffer, std::memory_order_relaxed);
+    }
+    // Captured once into the block pool, whoever the blocks are shared with
+    bool primary = self->hasCallback_ && self->pcmEnabled_;
+    if (inputBuffer && (primary || self->capture_.Subscribers() > 0)) {
+        uint64_t enqueue = self->capture_.Append(inputBuffer, framesPerBuffer, primary);
+        now = MonotonicNanos();
+        uint64_t copy = now - mark;
+        profiler.Record(ProfileStage::Input, copy > enqueue ? copy - enqueue : 0);
+        if (enqueue > 0) {
+            profiler.Record(ProfileStage::Enqueue, enqueue);
+        }
+    } else {
+        // Delivery was switched off part way through a block
+        self->capture_.Flush(false);
+    }
 
-            delete[] data->data;
-            delete data;
-        });
+    if (outputBuffer && outputBuffer != deviceOutput && !self->planar_) {
+        self->ScatterOutput(static_cast<const float*>(outputBuffer), deviceOutput, framesPerBuffer);
     }
 
+    profiler.EndCallback(MonotonicNanos() - start, framesPerBuffer);
     return paContinue;
 }
 
-Napi::Value AsioStream::Start(const Napi::CallbackInfo& info) {
-    Napi::Env env = info.Env();
-
-    if (!stream_ || isClosed_) {
-        return Napi::Boolean::New(env, false);
+const void* AsioStream::SelectInput(const void* inputBuffer, size_t frames) {
+    int selected = masterInputChannels_;
+    if (planar_) {
+        // Planar selection is just a different set of channel pointers
+        const float* const* in = static_cast<const float* const*>(inputBuffer);
+        for (int ch = 0; ch < selected; ch++) {
+            inputPlanes_[ch] = in[inputMap_[ch]];
+        }
+        return inputPlanes_.data();
     }
 
-    if (isRunning_) {
-        return Napi::Boolean::New(env, true);
+    if (frames > selectFrames_) {
+        oversizedInput_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;     // Larger than any period the stream was opened for
     }
-
-    PaError err = Pa_StartStream(stream_);
-    if (err != paNoError) {
-        return Napi::Boolean::New(env, false);
+    const float* in = static_cast<const float*>(inputBuffer);
+    float* out = gatherInput_.data();
+    int stride = deviceInputChannels_;
+    const int* map = inputMap_.data();
+    for (size_t i = 0; i < frames; i++) {
+        const float* frame = in + i * stride;
+        for (int ch = 0; ch < selected; ch++) {
+            *out++ = frame[map[ch]];
+        }
     }
-
-    isRunning_ = true;
-    return Napi::Boolean::New(env, true);
+    return gatherInput_.data();
 }
 
-Napi::Value AsioStream::Stop(const Napi::CallbackInfo& info) {
-    Napi::Env env = info.Env();
+const void* AsioStream::AggregateInput(const void* inputBuffer, size_t frames) {
+    if (frames > selectFrames_) {
+        // Counted once, even when SelectInput already dropped the period
+        if (inputBuffer) {
+            oversizedInput_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return nullptr;     // Larger than any period the stream was opened for
+    }
 
-    if (!stream_ || isClosed_ || !isRunning_) {
-        return Napi::Boolean::New(env, true);
+    // Every member produces exactly this period, on this device's clock
+    uint64_t now = MonotonicNanos();
+    float* const* planes = memberPlanes_.data();
+    for (auto& member : aggregate_) {
+        member->compensator.Pull(planes, frames, now);
+        planes += member->channels;
     }
 
-    PaError err = Pa_StopStream(stream_);
-    isRunning_ = false;
+    // This device's own input went missing (e.g. an oversized period)
+    if (!inputBuffer && masterInputChannels_ > 0) {
+        return nullptr;
+    }
+
+    int own = masterInputChannels_;
+    int memberChannels = static_cast<int>(memberPlanes_.size());
+    if (planar_) {
+        const float* const* in = static_cast<const float* const*>(inputBuffer);
+        for (int ch = 0; ch < own; ch++) {
+            aggregatePlanes_[ch] = in[ch];
+        }
+        for (int ch = 0; ch < memberChannels; ch++) {
+            aggregatePlanes_[own + ch] = memberPlanes_[ch];
+        }
+        return aggregatePlanes_.data();
+    }
+
+    const float* in = static_cast<const float*>(inputBuffer);
+    float* out = aggregateInput_.data();
+    for (size_t i = 0; i < frames; i++) {
+        if (own > 0) {
+            std::memcpy(out, in + i * own, own * sizeof(float));
+            out += own;
+        }
+        for (int ch = 0; ch < memberChannels; ch++) {
+            *out++ = memberPlanes_[ch][i];
+        }
+    }
+    return aggregateInput_.data();
+}
+
+int AsioStream::AggregateCallback(
+    const void* inputBuffer,
+    void* outputBuffer,
+    unsigned long framesPerBuffer,
+    const PaStreamCallbackTimeInfo* timeInfo,
+    PaStreamCallbackFlags statusFlags,
+    void* userData
+) {
+    (void)outputBuffer;
+    (void)timeInfo;
+    AggregateMember* member = static_cast<AggregateMember*>(userData);
+    // Input the member's driver lost before it reached us
+    if (statusFlags & paInputOverflow) {
+        member->compensator.CountOverflow();
+    }
+    member->compensator.Push(inputBuffer, framesPerBuffer, false, MonotonicNanos());
+    return paContinue;
+}
+
+void* AsioStream::SelectOutput(void* outputBuffer, size_t frames) {
+    int selected = outputChannels_;
+    if (planar_) {
+        // Silence every device channel, then hand out the selected ones
+        float* const* out = static_cast<float* const*>(outputBuffer);
+        for (int ch = 0; ch < deviceOutputChannels_; ch++) {
+            std::memset(out[ch], 0, frames * sizeof(float));
+        }
+        for (int ch = 0; ch < selected; ch++) {
+            outputPlanes_[ch] = out[outputMap_[ch]];
+        }
+        return outputPlanes_.data();
+    }
+
+    if (frames > selectFrames_) {
+        std::memset(outputBuffer, 0, frames * deviceOutputChannels_ * sizeof(float));
+        return nullptr;
+    }
+    return scatterOutput_.data();
+}
+
+void AsioStream::ScatterOutput(const float* compact, void* deviceOutput, size_t frames) {
+    float* out = static_cast<float*>(deviceOutput);
+    int stride = deviceOutputChannels_;
+    int selected = outputChannels_;
+    const int* map = outputMap_.data();
+    std::memset(out, 0, frames * stride * sizeof(float));
+    for (size_t i = 0; i < frames; i++) {
+        float* frame = out + i * stride;
+        for (int ch = 0; ch < selected; ch++) {
+            frame[map[ch]] = *compact++;
+        }
+    }
+}
+
+void AsioStream::WakeInput(void* context) {
+    // Wake the owning thread unless a drain is already pending
+    AsioStream* self = static_cast<AsioStream*>(context);
+    if (!self->wakePending_.exchange(true)) {
+        if (!self->ScheduleDrain()) {
+            self->wakePending_ = false;
+        }
+    }
+}
+
+bool AsioStream::ScheduleDrain() {
+    // BindProcessCallback waits for wakeCalls_ to reach zero after swapping
+    // remote_, so a callback loaded here stays valid until the decrement
+    wakeCalls_.fetch_add(1, std::memory_order_acq_rel);
+    bool queued;
+    RemoteCallback* remote = remote_.load(std::memory_order_acquire);
+    if (remote) {
+        // The finalizer waits for calls to drain before the TSFN goes away
+        remote->calls.fetch_add(1, std::memory_order_acq_rel);
+        queued = !remote->closed.load(std::memory_order_acquire) &&
+                 remote->tsfn.NonBlockingCall() == napi_ok;
+        remote->calls.fetch_sub(1, std::memory_order_acq_rel);
+    } else {
+        queued = localCallback_.load(std::memory_order_acquire) && tsfn_.NonBlockingCall() == napi_ok;
+    }
+    wakeCalls_.fetch_sub(1, std::memory_order_acq_rel);
+    return queued;
+}
+
+bool AsioStream::BeginDelivery(RemoteCallback* remote) {
+    // A drain queued by a callback that has since been replaced is stale;
+    // so is one that would overlap a delivery already in progress
+    if (remote_.load(std::memory_order_acquire) != remote) {
+        return false;
+    }
+    if (delivering_.load(std::memory_order_acquire) > 0) {
+        wakePending_ = false;
+        return false;
+    }
+    delivering_.fetch_add(1, std::memory_order_acq_rel);
+    t_delivering = this;
+    return true;
+}
+
+void AsioStream::EndDelivery() {
+    t_delivering = nullptr;
+    delivering_.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void AsioStream::AwaitDelivery() {
+    // A delivery on this thread (the JS callback closing the stream) does
+    // not count against itself
+    int own = t_delivering == this ? 1 : 0;
+    while (delivering_.load(std::memory_order_acquire) > own) {
+        std::this_thread::yield();
+    }
+}
+
+void AsioStream::DrainInput(Napi::Env env, Napi::Function jsCallback, AsioStream* self, void*) {
+    {
+        std::lock_guard<std::mutex> lock(g_streamsMutex);
+        if (!self->BeginDelivery(nullptr)) {
+            return;
+        }
+    }
+    self->DeliverInput(env, jsCallback);
+    self->EndDelivery();
+}
+
+void AsioStream::DrainRemote(Napi::Env env, Napi::Function jsCallback, RemoteCallback* remote, void*) {
+    // The stream may have been closed or collected in its own environment
+    // since this drain was queued; the registry decides
+    AsioStream* self = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_streamsMutex);
+        auto it = Streams().find(remote->streamId);
+        if (it == Streams().end() || !it->second->BeginDelivery(remote)) {
+            return;
+        }
+        self = it->second;
+    }
+    self->DeliverInput(env, jsCallback);
+    self->EndDelivery();
+}
+
+void AsioStream::DeliverInput(Napi::Env env, Napi::Function jsCallback) {
+    // Clear before draining so a block queued mid-drain schedules another wakeup
+    wakePending_ = false;
+
+    // env is null when the TSFN is tearing down; blocks still go back to the pool
+    if (env == nullptr || jsCallback == nullptr) {
+        capture_.Discard();
+        return;
+    }
+
+    // Bound the work per wakeup so a fast producer cannot starve the event loop
+    size_t budget = capture_.QueueDepth();
+    while (budget > 0) {
+        AudioBlock* block = capture_.Next();
+        if (!block) {
+            break;
+        }
+
+        std::vector<AudioBlock*>& batch = coalesceScratch_;
+        batch.clear();
+        batch.push_back(block);
+        budget--;
+
+        if (capture_.Config().policy == BackpressurePolicy::Coalesce) {
+            while (budget > 0 && batch.size() < batch.capacity()) {
+                AudioBlock* next = capture_.Next();
+                if (!next) break;
+                batch.push_back(next);
+                budget--;
+            }
+            coalescedBlocks_ += batch.size() - 1;
+        }
+
+        // A lone block can be lent to JS; a coalesced batch needs one contiguous copy
+        if (zeroCopy_ && batch.size() == 1 && DeliverZeroCopy(env, jsCallback, block)) {
+            continue;
+        }
+
+        DeliverBlocks(env, jsCallback, batch.data(), batch.size());
+        for (AudioBlock* delivered : batch) {
+            capture_.Release(delivered);
+        }
+    }
+
+    // Anything left over gets its own wakeup
+    if (capture_.QueueSize() > 0 && !wakePending_.exchange(true)) {
+        if (!ScheduleDrain()) {
+            wakePending_ = false;
+        }
+    }
+}
+
+void AsioStream::ReleaseRemote(RemoteCallback* remote) {
+    if (!remote) {
+        return;
+    }
+    {
+        // Once its environment has finalized the TSFN there is nothing to release
+        std::lock_guard<std::mutex> lock(remote->mutex);
+        if (!remote->closed.load(std::memory_order_acquire)) {
+            remote->tsfn.Release();
+        }
+    }
+    DropRemote(remote);
+}
+
+void AsioStream::DropRemote(RemoteCallback* remote) {
+    if (remote->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete remote;
+    }
+}
+
+void AsioStream::UnbindProcessCallback() {
+    RemoteCallback* previous;
+    {
+        std::lock_guard<std::mutex> lock(g_streamsMutex);
+        previous = remote_.exchange(nullptr, std::memory_order_acq_rel);
+        bool local = localCallback_.exchange(false, std::memory_order_acq_rel);
+        hasCallback_ = false;
+        while (wakeCalls_.load(std::memory_order_acquire) > 0) {
+            std::this_thread::yield();
+        }
+        if (local) {
+            tsfn_.Release();
+        }
+    }
+    ReleaseRemote(previous);
+}
+
+void AsioStream::DeliverBlocks(Napi::Env env, Napi::Function jsCallback, AudioBlock* const* blocks, size_t count) {
+    int channels = blocks[0]->channels;
+    size_t framesPerChannel = 0;
+    for (size_t b = 0; b < count; b++) {
+        framesPerChannel += blocks[b]->frames;
+    }
+
+    deliveryCount_.fetch_add(1, std::memory_order_relaxed);
+    deliveredFrames_.fetch_add(framesPerChannel, std::memory_order_relaxed);
+
+    if (resampling_ || deliveryFormat_ != SampleFormat::Float32) {
+        // Stage as planar float, resample, then copy or convert out
+        float* const* planes = StageBlocks(blocks, count, framesPerChannel);
+        size_t frames = framesPerChannel;
+        if (resampling_) {
+            planes = Resample(planes, channels, framesPerChannel, &frames);
+            if (frames == 0) {
+                return;     // Still filling the filter history
+            }
+        }
+        Napi::Array inputBuffers = ExportPlanes(env, planes, channels, frames);
+        RecordDelivery(blocks[0], framesPerChannel);
+        jsCallback.Call({inputBuffers, Napi::Array::New(env, 0)});
+        return;
+    }
+
+    Napi::Array inputBuffers = CopyBlocks(env, blocks, count, framesPerChannel, channelPtrs_);
+
+    // Output buffers (empty for now)
+    Napi::Array outputBuffers = Napi::Array::New(env, 0);
+
+    RecordDelivery(blocks[0], framesPerChannel);
+    jsCallback.Call({inputBuffers, outputBuffers});
+}
+
+Napi::Array AsioStream::CopyBlocks(Napi::Env env, AudioBlock* const* blocks, size_t count, size_t framesPerChannel,
+                                   std::vector<float*>& dst) {
+    int channels = blocks[0]->channels;
+    Napi::Array inputBuffers = Napi::Array::New(env, channels);
+    dst.resize(channels);
+
+    for (int ch = 0; ch < channels; ch++) {
+        Napi::Float32Array channelData = Napi::Float32Array::New(env, framesPerChannel);
+        dst[ch] = channelData.Data();
+        inputBuffers.Set(ch, channelData);
+    }
+
+    // Deinterleave straight into the typed array backing stores; coalesced
+    // blocks are concatenated in capture order
+    for (size_t b = 0; b < count; b++) {
+        const AudioBlock* block = blocks[b];
+        if (block->planar) {
+            for (int ch = 0; ch < channels; ch++) {
+                std::memcpy(dst[ch], block->data + ch * block->stride, block->frames * sizeof(float));
+            }
+        } else {
+            kernels::Deinterleave(block->data, dst.data(), block->frames, channels);
+        }
+        for (int ch = 0; ch < channels; ch++) {
+            dst[ch] += block->frames;
+        }
+    }
+    return inputBuffers;
+}
+
+void AsioStream::RecordDelivery(const AudioBlock* oldest, size_t frames) {
+    uint64_t now = MonotonicMicros();
+    deliveryLatency_.Record(now > oldest->captureTime ? now - oldest->captureTime : 0);
+
+    uint64_t lastTime = lastDeliveryTime_.load(std::memory_order_relaxed);
+    if (lastTime != 0) {
+        uint64_t interval = now - lastTime;
+        uint64_t expected = lastDeliveryMicros_.load(std::memory_order_relaxed);
+        deliveryJitter_.Record(interval > expected ? interval - expected : expected - interval);
+    }
+    lastDeliveryTime_.store(now, std::memory_order_relaxed);
+    lastDeliveryMicros_.store(static_cast<uint64_t>(static_cast<double>(frames) * 1e6 / sampleRate_),
+                              std::memory_order_relaxed);
+}
+
+float* const* AsioStream::StageBlocks(AudioBlock* const* blocks, size_t count, size_t framesPerChannel) {
+    int channels = blocks[0]->channels;
+    std::vector<float*>& planes = stagePlanes_;
+    planes.resize(channels);
+
+    // A lone planar block is already in the right shape
+    if (count == 1 && blocks[0]->planar) {
+        for (int ch = 0; ch < channels; ch++) {
+            planes[ch] = blocks[0]->data + ch * blocks[0]->stride;
+        }
+        return planes.data();
+    }
+
+    if (stageIn_.size() < framesPerChannel * channels) {
+        stageIn_.resize(framesPerChannel * channels);
+    }
+    for (int ch = 0; ch < channels; ch++) {
+        planes[ch] = stageIn_.data() + ch * framesPerChannel;
+    }
+
+    std::vector<float*>& dst = channelPtrs_;
+    dst.assign(planes.begin(), planes.end());
+    for (size_t b = 0; b < count; b++) {
+        const AudioBlock* block = blocks[b];
+        if (block->planar) {
+            for (int ch = 0; ch < channels; ch++) {
+                std::memcpy(dst[ch], block->data + ch * block->stride, block->frames * sizeof(float));
+            }
+        } else {
+            kernels::Deinterleave(block->data, dst.data(), block->frames, channels);
+        }
+        for (int ch = 0; ch < channels; ch++) {
+            dst[ch] += block->frames;
+        }
+    }
+    return planes.data();
+}
+
+float* const* AsioStream::Resample(float* const* planes, int channels, size_t frames, size_t* outFrames) {
+    size_t produced = resampler_.OutputFrames(frames);
+    if (stageOut_.size() < produced * channels) {
+        stageOut_.resize(produced * channels);
+    }
+    resampledPlanes_.resize(channels);
+    for (int ch = 0; ch < channels; ch++) {
+        resampledPlanes_[ch] = stageOut_.data() + ch * produced;
+    }
+
+    // Channels are independent, so wide streams fan out across the pool
+    std::function<void(int)> work = [&](int ch) {
+        resampler_.Process(ch, planes[ch], frames, resampledPlanes_[ch]);
+    };
+    if (resampleWorkers_) {
+        resampleWorkers_->Run(channels, work);
+    } else {
+        for (int ch = 0; ch < channels; ch++) {
+            work(ch);
+        }
+    }
+
+    *outFrames = produced;
+    return resampledPlanes_.data();
+}
+
+Napi::Array AsioStream::ExportPlanes(Napi::Env env, float* const* planes, int channels, size_t frames) {
+    // Float32Array, Int16Array, packed 24-bit bytes in a Uint8Array, or
+    // half-float bits in a Uint16Array
+    Napi::Array inputBuffers = Napi::Array::New(env, channels);
+    DitherState* dither = dither_ ? &ditherState_ : nullptr;
+
+    for (int ch = 0; ch < channels; ch++) {
+        switch (deliveryFormat_) {
+            case SampleFormat::Int16: {
+                Napi::Int16Array channelData = Napi::Int16Array::New(env, frames);
+                kernels::FloatToInt16(planes[ch], channelData.Data(), frames, dither);
+                inputBuffers.Set(ch, channelData);
+                break;
+            }
+            case SampleFormat::Int24: {
+                Napi::Uint8Array channelData = Napi::Uint8Array::New(env, frames * 3);
+                kernels::FloatToInt24(planes[ch], channelData.Data(), frames, dither);
+                inputBuffers.Set(ch, channelData);
+                break;
+            }
+            case SampleFormat::Float16: {
+                Napi::Uint16Array channelData = Napi::Uint16Array::New(env, frames);
+                kernels::FloatToHalf(planes[ch], channelData.Data(), frames);
+                inputBuffers.Set(ch, channelData);
+                break;
+            }
+            default: {
+                Napi::Float32Array channelData = Napi::Float32Array::New(env, frames);
+                std::memcpy(channelData.Data(), planes[ch], frames * sizeof(float));
+                inputBuffers.Set(ch, channelData);
+                break;
+            }
+        }
+    }
+
+    return inputBuffers;
+}
+
+bool AsioStream::DeliverZeroCopy(Napi::Env env, Napi::Function jsCallback, AudioBlock* block) {
+    // Views can only alias the pool when JS wants the samples as stored
+    if (!externalBuffersAllowed_ || !block->planar || deliveryFormat_ != SampleFormat::Float32 || resampling_) {
+        return false;
+    }
+    // Subscribers read the same block; a writable view would let the
+    // process callback change their audio
+    if (capture_.Subscribers() > 0) {
+        return false;
+    }
+
+    size_t frames = block->frames;
+    size_t stride = block->stride;
+    int channels = block->channels;
+    BlockLease* lease = new BlockLease{capture_.Pool(), block, false};
+
+    napi_value arrayBuffer;
+    napi_status status = napi_create_external_arraybuffer(
+        env, block->data, stride * channels * sizeof(float), FinalizeLease, lease, &arrayBuffer);
+    if (status != napi_ok) {
+        // Runtimes with a V8 memory cage (Electron 21+) refuse external
+        // buffers; stop trying and use the copying path from now on
+        delete lease;
+        externalBuffersAllowed_ = false;
+        zeroCopyFallbacks_++;
+        return false;
+    }
+    block->owner = lease;
+
+    // One view per channel over the planar block
+    Napi::ArrayBuffer buffer(env, arrayBuffer);
+    Napi::Array inputBuffers = Napi::Array::New(env, channels);
+    for (int ch = 0; ch < channels; ch++) {
+        inputBuffers.Set(ch, Napi::Float32Array::New(env, frames, buffer, ch * stride * sizeof(float)));
+    }
+
+    deliveryCount_.fetch_add(1, std::memory_order_relaxed);
+    deliveredFrames_.fetch_add(frames, std::memory_order_relaxed);
+
+    // Output buffers (empty for now)
+    Napi::Array outputBuffers = Napi::Array::New(env, 0);
+
+    RecordDelivery(block, frames);
+    jsCallback.Call({inputBuffers, outputBuffers});
+    return true;
+}
+
+Napi::Value AsioStream::Start(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if ((!stream_ && !virtualDevice_) || isClosed_) {
+        return Napi::Boolean::New(env, false);
+    }
+
+    if (isRunning_) {
+        return Napi::Boolean::New(env, true);
+    }
+
+    if (jitterEnabled_) {
+        jitter_.Restart();
+    }
+
+    // Members first, so their rings are filling by the first callback
+    if (!StartAggregate()) {
+        return Napi::Boolean::New(env, false);
+    }
+    if (virtualDevice_) {
+        virtualDevice_->Start();
+    } else {
+        PaError err = Pa_StartStream(stream_);
+        if (err != paNoError) {
+            StopAggregate();
+            return Napi::Boolean::New(env, false);
+        }
+    }
+
+    // The gap across a stop/start is not delivery jitter
+    lastDeliveryTime_.store(0, std::memory_order_relaxed);
+    isRunning_ = true;
+    return Napi::Boolean::New(env, true);
+}
+
+Napi::Value AsioStream::Stop(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if ((!stream_ && !virtualDevice_) || isClosed_ || !isRunning_) {
+        return Napi::Boolean::New(env, true);
+    }
+
+    PaError err = paNoError;
+    if (virtualDevice_) {
+        virtualDevice_->Stop();
+    } else {
+        err = Pa_StopStream(stream_);
+    }
+    StopAggregate();
+    isRunning_ = false;
+
+    // The audio thread has finished; hand over any partially filled block
+    capture_.Flush(hasCallback_ || capture_.Subscribers() > 0);
+
+    return Napi::Boolean::New(env, err == paNoError);
+}
+
+Napi::Value AsioStream::Close(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (isClosed_) {
+        return env.Undefined();
+    }
+
+    if (virtualDevice_) {
+        virtualDevice_->Stop();
+    } else if (isRunning_) {
+        Pa_StopStream(stream_);
+    }
+    isRunning_ = false;
+
+    if (stream_) {
+        Pa_CloseStream(stream_);
+        stream_ = nullptr;
+    }
+    CloseAggregate();
+
+    capture_.Flush(false);
+
+    {
+        // No other environment can bind once the stream is marked closed
+        std::lock_guard<std::mutex> lock(g_streamsMutex);
+        isClosed_ = true;
+    }
+    UnbindProcessCallback();
+    AwaitDelivery();
+    for (int id = 1; id < InputCapture::kMaxSubscribers; id++) {
+        RemoveSubscriber(id);
+    }
+
+    ReleaseMeterCallback();
+    ReleasePacketCallback();
+    encoder_.reset();
+
+    DetachRing();
+    // The files are finalized in the background; nobody waits on the summary
+    if (Recorder* recorder = DetachRecorder()) {
+        (new RecordingWorker(env, recorder, sampleRate_))->Queue();
+    }
+
+    // Deliveries still queued fall back to resampling on the JS thread
+    resampleWorkers_.reset();
+
+    return env.Undefined();
+}
+
+Napi::Value AsioStream::SetProcessCallback(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsFunction()) {
+        Napi::TypeError::New(env, "Callback function expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (isClosed_) {
+        Napi::Error::New(env, "Stream is closed").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // Release the existing callback, local or bound from a worker
+    UnbindProcessCallback();
+
+    Napi::Function callback = info[0].As<Napi::Function>();
+    std::lock_guard<std::mutex> lock(g_streamsMutex);
+    tsfn_ = InputTsfn::New(
+        env,
+        callback,
+        "AsioCallback",
+        2,      // Max queue size; wakePending_ keeps at most one call in flight
+        1,      // Initial thread count
+        this,   // Context handed to DrainInput
+        [](Napi::Env, void*, AsioStream* self) {
+            // Pending blocks have all been delivered or released by now
+            self->wakePending_ = false;
+            self->Unref();
+        }
+    );
+
+    // Keep this object alive until the TSFN has drained its queue
+    Ref();
+    localCallback_ = true;
+    hasCallback_ = true;
+    return env.Undefined();
+}
+
+Napi::Value AsioStream::BindProcessCallback(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber() ||
+        !(info[1].IsFunction() || info[1].IsNull() || info[1].IsUndefined())) {
+        Napi::TypeError::New(env, "Expected (streamId, callback)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    uint32_t streamId = info[0].As<Napi::Number>().Uint32Value();
+
+    RemoteCallback* remote = nullptr;
+    if (info[1].IsFunction()) {
+        remote = new RemoteCallback();
+        remote->streamId = streamId;
+        remote->closed = false;
+        remote->calls = 0;
+        remote->refs = 2;
+        remote->tsfn = RemoteTsfn::New(
+            env,
+            info[1].As<Napi::Function>(),
+            "AsioRemoteCallback",
+            2,      // Max queue size; wakePending_ keeps at most one call in flight
+            1,      // Initial thread count
+            remote, // Context handed to DrainRemote
+            [](Napi::Env, void*, RemoteCallback* remote) {
+                // This environment is done with the TSFN; let a concurrent
+                // ScheduleDrain finish before it goes away
+                {
+                    std::lock_guard<std::mutex> lock(remote->mutex);
+                    remote->closed = true;
+                }
+                while (remote->calls.load(std::memory_order_acquire) > 0) {
+                    std::this_thread::yield();
+                }
+                DropRemote(remote);
+            }
+        );
+    }
+
+    RemoteCallback* previous = nullptr;
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lock(g_streamsMutex);
+        auto it = Streams().find(streamId);
+        if (it != Streams().end() && !it->second->isClosed_) {
+            AsioStream* stream = it->second;
+            found = true;
+            previous = stream->remote_.exchange(remote, std::memory_order_acq_rel);
+            bool local = stream->localCallback_.exchange(false, std::memory_order_acq_rel);
+            stream->hasCallback_ = remote != nullptr;
+            while (stream->wakeCalls_.load(std::memory_order_acquire) > 0) {
+                std::this_thread::yield();
+            }
+            // The owning environment's finalizer drops its Ref later
+            if (local) {
+                stream->tsfn_.Release();
+            }
+        }
+    }
+    ReleaseRemote(previous);
+
+    if (!found) {
+        ReleaseRemote(remote);
+        Napi::Error::New(env, "No open stream with id " + std::to_string(streamId)).ThrowAsJavaScriptException();
+    }
+    return env.Undefined();
+}
+
+Napi::Value AsioStream::Subscribe(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsFunction()) {
+        Napi::TypeError::New(env, "Callback function expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (isClosed_) {
+        Napi::Error::New(env, "Stream is closed").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // Options: { queueDepth, backpressure }
+    size_t queueDepth = 8;
+    BackpressurePolicy backpressure = BackpressurePolicy::DropOldest;
+    if (info.Length() > 1 && info[1].IsObject()) {
+        Napi::Object opts = info[1].As<Napi::Object>();
+        if (opts.Get("queueDepth").IsNumber()) {
+            queueDepth = std::max<size_t>(1, opts.Get("queueDepth").As<Napi::Number>().Uint32Value());
+        }
+        if (opts.Has("backpressure") && !ParseBackpressure(env, opts.Get("backpressure"), &backpressure)) {
+            return env.Undefined();
+        }
+    }
+
+    InputSubscriber* subscriber = new InputSubscriber();
+    subscriber->stream = this;
+    subscriber->id = -1;
+    subscriber->active = false;
+    subscriber->wakePending = false;
+    subscriber->batch.reserve(queueDepth);
+    subscriber->deliveries = 0;
+    subscriber->deliveredFrames = 0;
+    subscriber->tsfn = SubscriberTsfn::New(
+        env,
+        info[0].As<Napi::Function>(),
+        "AsioSubscriberCallback",
+        2,          // Max queue size; wakePending keeps at most one call in flight
+        1,          // Initial thread count
+        subscriber, // Context handed to DrainSubscriber
+        [](Napi::Env, void*, InputSubscriber* subscriber) {
+            subscriber->stream->Unref();
+            delete subscriber;
+        }
+    );
+    Ref();
+
+    // The wake hook may fire as soon as the queue is live
+    int id = capture_.Subscribe(queueDepth, backpressure, WakeSubscriber, subscriber);
+    if (id < 0) {
+        subscriber->tsfn.Release();
+        if (capture_.Subscribers() >= InputCapture::kMaxSubscribers - 1) {
+            Napi::RangeError::New(env, "Too many subscribers").ThrowAsJavaScriptException();
+        } else {
+            Napi::RangeError::New(env, "inputPoolBlocks has no room left for a queue of " +
+                                  std::to_string(queueDepth) + " blocks (" +
+                                  std::to_string(capture_.UnreservedBlocks()) + " unreserved)")
+                .ThrowAsJavaScriptException();
+        }
+        return env.Undefined();
+    }
+    subscriber->id = id;
+    subscriber->active = true;
+    subscribers_[id] = subscriber;
+    return Napi::Number::New(env, id);
+}
+
+Napi::Value AsioStream::Unsubscribe(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "Subscriber id expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    int id = info[0].As<Napi::Number>().Int32Value();
+    bool found = id > 0 && id < InputCapture::kMaxSubscribers && subscribers_[id];
+    RemoveSubscriber(id);
+    return Napi::Boolean::New(env, found);
+}
+
+void AsioStream::RemoveSubscriber(int id) {
+    if (id <= 0 || id >= InputCapture::kMaxSubscribers || !subscribers_[id]) {
+        return;
+    }
+    InputSubscriber* subscriber = subscribers_[id];
+    subscribers_[id] = nullptr;
+    // After this the audio thread no longer queues to it or wakes it
+    capture_.Unsubscribe(id);
+    subscriber->active = false;
+    subscriber->tsfn.Release();
+}
+
+void AsioStream::WakeSubscriber(void* context) {
+    InputSubscriber* subscriber = static_cast<InputSubscriber*>(context);
+    if (!subscriber->wakePending.exchange(true)) {
+        if (subscriber->tsfn.NonBlockingCall() != napi_ok) {
+            subscriber->wakePending = false;
+        }
+    }
+}
+
+void AsioStream::DrainSubscriber(Napi::Env env, Napi::Function jsCallback, InputSubscriber* subscriber, void*) {
+    subscriber->wakePending = false;
+    // Unsubscribe has already returned the subscriber's blocks to the pool
+    if (!subscriber->active) {
+        return;
+    }
+    AsioStream* self = subscriber->stream;
+    InputCapture& capture = self->capture_;
+    int id = subscriber->id;
+    if (env == nullptr || jsCallback == nullptr) {
+        capture.Discard(id);
+        return;
+    }
+
+    // Same delivery loop as DrainInput, at the device rate in float32: the
+    // blocks are shared, so nothing is converted in place
+    size_t budget = capture.QueueDepth(id);
+    while (budget > 0) {
+        AudioBlock* block = capture.Next(id);
+        if (!block) {
+            break;
+        }
+        std::vector<AudioBlock*>& batch = subscriber->batch;
+        batch.clear();
+        batch.push_back(block);
+        budget--;
+        if (capture.Policy(id) == BackpressurePolicy::Coalesce) {
+            while (budget > 0 && batch.size() < batch.capacity()) {
+                AudioBlock* next = capture.Next(id);
+                if (!next) break;
+                batch.push_back(next);
+                budget--;
+            }
+        }
+
+        size_t frames = 0;
+        for (AudioBlock* queued : batch) {
+            frames += queued->frames;
+        }
+        Napi::Array inputBuffers = self->CopyBlocks(env, batch.data(), batch.size(), frames, subscriber->planes);
+        for (AudioBlock* delivered : batch) {
+            capture.Release(delivered);
+        }
+        subscriber->deliveries++;
+        subscriber->deliveredFrames += frames;
+        jsCallback.Call({inputBuffers});
+        // The callback may have unsubscribed
+        if (!subscriber->active) {
+            return;
+        }
+    }
 
-    return Napi::Boolean::New(env, err == paNoError);
+    if (capture.QueueSize(id) > 0 && !subscriber->wakePending.exchange(true)) {
+        if (subscriber->tsfn.NonBlockingCall() != napi_ok) {
+            subscriber->wakePending = false;
+        }
+    }
 }
 
-Napi::Value AsioStream::Close(const Napi::CallbackInfo& info) {
+Napi::Value AsioStream::SetMeterCallback(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
+    if (info.Length() < 1 || !info[0].IsFunction()) {
+        Napi::TypeError::New(env, "Callback function expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
     if (isClosed_) {
+        Napi::Error::New(env, "Stream is closed").ThrowAsJavaScriptException();
         return env.Undefined();
     }
 
-    if (isRunning_) {
-        Pa_StopStream(stream_);
-        isRunning_ = false;
-    }
+    ReleaseMeterCallback();
 
-    if (stream_) {
-        Pa_CloseStream(stream_);
-        stream_ = nullptr;
+    meterTsfn_ = MeterTsfn::New(
+        env,
+        info[0].As<Napi::Function>(),
+        "AsioMeterCallback",
+        2,      // Max queue size; meterWakePending_ keeps at most one call in flight
+        1,      // Initial thread count
+        this,   // Context handed to DeliverLevels
+        [](Napi::Env, void*, AsioStream* self) {
+            self->meterWakePending_ = false;
+            self->Unref();
+        }
+    );
+
+    Ref();
+    meterEnabled_ = true;
+    hasMeterCallback_ = true;
+    return env.Undefined();
+}
+
+void AsioStream::ReleaseMeterCallback() {
+    if (!hasMeterCallback_.exchange(false)) {
+        return;
     }
+    // The audio thread is inside the wake for at most a few instructions
+    while (meterWakeCalls_.load() > 0) {
+        std::this_thread::yield();
+    }
+    meterTsfn_.Release();
+}
 
-    if (hasCallback_ && tsfn_) {
-        tsfn_.Release();
-        hasCallback_ = false;
+void AsioStream::DeliverLevels(Napi::Env env, Napi::Function jsCallback, AsioStream* self, void*) {
+    self->meterWakePending_ = false;
+    if (env == nullptr || jsCallback == nullptr) {
+        return;
     }
 
-    isClosed_ = true;
-    return env.Undefined();
+    // [peak, rms, peakHold] per channel
+    Napi::Float32Array levels = Napi::Float32Array::New(env, self->meter_.Channels() * 3);
+    self->meter_.Read(levels.Data());
+    jsCallback.Call({levels});
 }
 
-Napi::Value AsioStream::SetProcessCallback(const Napi::CallbackInfo& info) {
+Napi::Value AsioStream::SetPacketCallback(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
     if (info.Length() < 1 || !info[0].IsFunction()) {
         Napi::TypeError::New(env, "Callback function expected").ThrowAsJavaScriptException();
         return env.Undefined();
     }
-
-    // Release existing callback
-    if (hasCallback_ && tsfn_) {
-        tsfn_.Release();
+    if (!encoder_) {
+        Napi::Error::New(env, "Stream was opened without an encoder").ThrowAsJavaScriptException();
+        return env.Undefined();
     }
 
-    Napi::Function callback = info[0].As<Napi::Function>();
-    tsfn_ = Napi::ThreadSafeFunction::New(
+    ReleasePacketCallback();
+
+    packetTsfn_ = PacketTsfn::New(
         env,
-        callback,
-        "AsioCallback",
-        0,  // Max queue size (0 = unlimited)
-        1   // Initial thread count
+        info[0].As<Napi::Function>(),
+        "AsioPacketCallback",
+        2,      // Max queue size; packetWakePending_ keeps at most one call in flight
+        1,      // Initial thread count
+        this,   // Context handed to DeliverPackets
+        [](Napi::Env, void*, AsioStream* self) {
+            self->packetWakePending_ = false;
+            self->Unref();
+        }
     );
 
-    hasCallback_ = true;
+    Ref();
+    hasPacketCallback_ = true;
+    return env.Undefined();
+}
+
+void AsioStream::WakePackets(void* context) {
+    // ReleasePacketCallback waits for packetWakeCalls_ to reach zero after
+    // clearing the flag, so the handle stays valid until the decrement
+    AsioStream* self = static_cast<AsioStream*>(context);
+    self->packetWakeCalls_.fetch_add(1);
+    if (self->hasPacketCallback_ && !self->packetWakePending_.exchange(true)) {
+        if (self->packetTsfn_.NonBlockingCall() != napi_ok) {
+            self->packetWakePending_ = false;
+        }
+    }
+    self->packetWakeCalls_.fetch_sub(1);
+}
+
+void AsioStream::ReleasePacketCallback() {
+    if (!hasPacketCallback_.exchange(false)) {
+        return;
+    }
+    while (packetWakeCalls_.load() > 0) {
+        std::this_thread::yield();
+    }
+    packetTsfn_.Release();
+}
+
+void AsioStream::DeliverPackets(Napi::Env env, Napi::Function jsCallback, AsioStream* self, void*) {
+    // Clear before draining so a frame queued mid-drain schedules another wakeup
+    self->packetWakePending_ = false;
+    if (env == nullptr || jsCallback == nullptr || !self->encoder_) {
+        return;
+    }
+
+    // Every queued frame in one call: [{ sequence, timestamp, captureTime, packets }]
+    std::deque<EncodedFrame>& frames = self->packets_;
+    self->encoder_->Drain(&frames);
+    if (frames.empty()) {
+        return;
+    }
+    Napi::Array out = Napi::Array::New(env, frames.size());
+    for (size_t i = 0; i < frames.size(); i++) {
+        const EncodedFrame& frame = frames[i];
+        // One ArrayBuffer per frame; each group's packet is a view into it
+        Napi::ArrayBuffer data = Napi::ArrayBuffer::New(env, frame.data.size());
+        if (!frame.data.empty()) {
+            std::memcpy(data.Data(), frame.data.data(), frame.data.size());
+        }
+        Napi::Array packets = Napi::Array::New(env, frame.sizes.size());
+        size_t offset = 0;
+        for (size_t g = 0; g < frame.sizes.size(); g++) {
+            packets.Set(static_cast<uint32_t>(g), Napi::Uint8Array::New(env, frame.sizes[g], data, offset));
+            offset += frame.sizes[g];
+        }
+        Napi::Object item = Napi::Object::New(env);
+        item.Set("sequence", Napi::Number::New(env, static_cast<double>(frame.sequence)));
+        item.Set("timestamp", Napi::Number::New(env, static_cast<double>(frame.timestamp)));
+        item.Set("captureTime", Napi::Number::New(env, frame.captureTime / 1000.0));
+        item.Set("packets", packets);
+        out.Set(static_cast<uint32_t>(i), item);
+    }
+    frames.clear();
+    jsCallback.Call({out});
+}
+
+Napi::Value AsioStream::GetLevels(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Float32Array levels = Napi::Float32Array::New(env, meter_.Channels() * 3);
+    meter_.Read(levels.Data());
+    return levels;
+}
+
+Napi::Value AsioStream::SetPcmEnabled(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    pcmEnabled_ = info.Length() > 0 && info[0].ToBoolean();
     return env.Undefined();
 }
 
+Napi::Value AsioStream::ReadCapture(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // Captured output of a virtual device, one Float32Array per channel
+    if (!virtualDevice_) {
+        return Napi::Array::New(env, 0);
+    }
+    size_t frames = virtualDevice_->CaptureAvailable();
+    if (info.Length() > 0 && info[0].IsNumber()) {
+        frames = std::min<size_t>(frames, info[0].As<Napi::Number>().Uint32Value());
+    }
+
+    int channels = virtualDevice_->Config().outputChannels;
+    Napi::Array buffers = Napi::Array::New(env, channels);
+    std::vector<float*> dst(channels);
+    for (int ch = 0; ch < channels; ch++) {
+        Napi::Float32Array channelData = Napi::Float32Array::New(env, frames);
+        dst[ch] = channelData.Data();
+        buffers.Set(ch, channelData);
+    }
+    virtualDevice_->ReadCapture(dst.data(), frames);
+    return buffers;
+}
+
+Napi::Value AsioStream::ResetStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    deliveryLatency_.Reset();
+    deliveryJitter_.Reset();
+    profiler_.Reset();
+    lastDeliveryTime_.store(0, std::memory_order_relaxed);
+    capture_.ResetPeakQueueDepth();
+    return env.Undefined();
+}
+
+Napi::Value AsioStream::AttachSharedRing(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // A Uint8Array view over the whole SharedArrayBuffer; typed array info
+    // yields the backing store pointer for shared and plain buffers alike
+    if (info.Length() < 1 || !info[0].IsTypedArray() ||
+        info[0].As<Napi::TypedArray>().TypedArrayType() != napi_uint8_array) {
+        Napi::TypeError::New(env, "Uint8Array over the ring's SharedArrayBuffer expected")
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    napi_typedarray_type type;
+    size_t length, byteOffset;
+    void* data;
+    napi_value arrayBuffer;
+    napi_status status = napi_get_typedarray_info(env, info[0], &type, &length, &data, &arrayBuffer, &byteOffset);
+    if (status != napi_ok) {
+        Napi::Error::New(env, "Unable to access shared ring memory").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    const char* error = nullptr;
+    SharedRingWriter* ring = SharedRingWriter::Attach(data, length, inputChannels_, &error);
+    if (!ring) {
+        Napi::RangeError::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    DetachRing();
+    sharedRingRef_ = Napi::Persistent(info[0].As<Napi::Object>());
+    sharedRing_.store(ring);
+    return env.Undefined();
+}
+
+Napi::Value AsioStream::DetachSharedRing(const Napi::CallbackInfo& info) {
+    DetachRing();
+    return info.Env().Undefined();
+}
+
+void AsioStream::DetachRing() {
+    SharedRingWriter* ring = sharedRing_.exchange(nullptr);
+    if (!ring) {
+        return;
+    }
+    // A callback that loaded the old pointer finishes within one period
+    while (sharedRingBusy_.load()) {
+        std::this_thread::yield();
+    }
+    delete ring;
+    sharedRingRef_.Reset();
+}
+
+Napi::Value AsioStream::StartRecording(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "File path expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (inputChannels_ <= 0) {
+        Napi::Error::New(env, "Stream has no input channels to record").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (recorder_.load()) {
+        Napi::Error::New(env, "Already recording; call stopRecording() first").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    RecorderConfig config;
+    config.sampleRate = sampleRate_;
+    config.channels = inputChannels_;
+    if (info.Length() > 1 && info[1].IsObject()) {
+        Napi::Object opts = info[1].As<Napi::Object>();
+        if (opts.Has("format") && !ParseFileFormat(env, opts.Get("format"), &config.format)) {
+            return env.Undefined();
+        }
+        if (opts.Has("dither")) config.dither = opts.Get("dither").ToBoolean();
+        if (opts.Has("split")) config.split = opts.Get("split").ToBoolean();
+        if (opts.Get("ringSeconds").IsNumber()) {
+            config.ringSeconds = opts.Get("ringSeconds").As<Napi::Number>().DoubleValue();
+        }
+        if (opts.Get("writeBlockBytes").IsNumber()) {
+            // Every file stages a block of this size, so a split recording
+            // holds one per channel
+            double bytes = opts.Get("writeBlockBytes").As<Napi::Number>().DoubleValue();
+            if (!(bytes >= 4096 && bytes <= 16 * 1024 * 1024)) {
+                Napi::RangeError::New(env, "writeBlockBytes must be between 4096 and 16777216")
+                    .ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            config.writeBlockBytes = static_cast<size_t>(bytes);
+        }
+        if (opts.Get("syncIntervalMs").IsNumber()) {
+            config.syncIntervalMs = opts.Get("syncIntervalMs").As<Napi::Number>().DoubleValue();
+        }
+        if (opts.Get("preallocateSeconds").IsNumber()) {
+            config.preallocateSeconds = opts.Get("preallocateSeconds").As<Napi::Number>().DoubleValue();
+        }
+    }
+    if (!(config.ringSeconds > 0) || config.syncIntervalMs < 0 || config.preallocateSeconds < 0) {
+        Napi::RangeError::New(env, "ringSeconds must be positive; syncIntervalMs and preallocateSeconds non-negative")
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::unique_ptr<Recorder> recorder(new Recorder());
+    std::string error;
+    if (!recorder->Start(info[0].As<Napi::String>().Utf8Value(), config, &error)) {
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Array files = Napi::Array::New(env, recorder->Files().size());
+    for (size_t i = 0; i < recorder->Files().size(); i++) {
+        files.Set(static_cast<uint32_t>(i), Napi::String::New(env, recorder->Files()[i]));
+    }
+    recorder_.store(recorder.release());
+    return files;
+}
+
+Napi::Value AsioStream::StopRecording(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    Recorder* recorder = DetachRecorder();
+    if (!recorder) {
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        deferred.Resolve(env.Null());
+        return deferred.Promise();
+    }
+
+    // Draining the ring and syncing every file can take seconds; keep it
+    // off the JS thread
+    RecordingWorker* worker = new RecordingWorker(env, recorder, sampleRate_);
+    Napi::Promise promise = worker->Promise();
+    worker->Queue();
+    return promise;
+}
+
+Napi::Value AsioStream::Snapshot(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (!history_) {
+        Napi::Error::New(env, "Stream was opened without historySeconds").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (info.Length() < 1 || !info[0].IsNumber() || !(info[0].As<Napi::Number>().DoubleValue() >= 0)) {
+        Napi::TypeError::New(env, "Seconds expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // The window ends now, and reaches back no further than what is held
+    uint64_t end = history_->Written();
+    double seconds = std::min(info[0].As<Napi::Number>().DoubleValue(), historySeconds_);
+    size_t frames = static_cast<size_t>(std::min<double>(seconds * sampleRate_, static_cast<double>(end)));
+
+    SnapshotWorker* worker = new SnapshotWorker(env, history_, end - frames, frames, sampleRate_);
+    Napi::Object opts = info.Length() > 1 && info[1].IsObject() ? info[1].As<Napi::Object>() : Napi::Object::New(env);
+    if (opts.Get("path").IsString()) {
+        SampleFormat format = SampleFormat::Int24;
+        if (opts.Has("format") && !ParseFileFormat(env, opts.Get("format"), &format)) {
+            delete worker;
+            return env.Undefined();
+        }
+        worker->ToFile(opts.Get("path").As<Napi::String>().Utf8Value(), format, opts.Get("dither").ToBoolean());
+    } else {
+        worker->ToBuffer(Napi::ArrayBuffer::New(env, frames * history_->Channels() * sizeof(float)));
+    }
+    Napi::Promise promise = worker->Promise();
+    worker->Queue();
+    snapshots_++;
+    return promise;
+}
+
+Recorder* AsioStream::DetachRecorder() {
+    Recorder* recorder = recorder_.exchange(nullptr);
+    if (!recorder) {
+        return nullptr;
+    }
+    // A callback that loaded the old pointer finishes within one period
+    while (recorderBusy_.load()) {
+        std::this_thread::yield();
+    }
+    return recorder;
+}
+
 Napi::Value AsioStream::Write(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
@@ -364,31 +2637,268 @@ Napi::Value AsioStream::Write(const Napi::CallbackInfo& info) {
         return Napi::Number::New(env, 0);
     }
 
+    if (outputChannels_ <= 0) {
+        return Napi::Number::New(env, 0);
+    }
+
     // Get first channel to determine frame count
-    Napi::Float32Array firstChannel = buffers.Get(0u).As<Napi::Float32Array>();
-    size_t frameCount = firstChannel.ElementLength();
-    size_t channelCount = buffers.Length();
+    Napi::Value first = buffers.Get(0u);
+    if (!IsFloat32Array(first)) {
+        return Napi::Number::New(env, 0);
+    }
+    size_t frameCount = first.As<Napi::Float32Array>().ElementLength();
+
+    size_t framesWritten = 0;
+    if (planar_) {
+        framesWritten = WritePlanar(buffers, frameCount);
+    } else {
+        framesWritten = WriteInterleaved(buffers, frameCount);
+    }
+    if (jitterEnabled_ && framesWritten > 0) {
+        jitter_.NoteWrite(framesWritten, MonotonicNanos());
+    }
+    return Napi::Number::New(env, static_cast<double>(framesWritten));
+}
+
+size_t AsioStream::WriteInterleaved(const Napi::Array& buffers, size_t frameCount) {
+    size_t channels = static_cast<size_t>(outputChannels_);
+
+    // Interleave straight into the ring's free space; only whole frames are queued
+    for (size_t ch = 0; ch < channels; ch++) {
+        writeSources_[ch] = nullptr;
+        writeFrames_[ch] = 0;
+        if (ch < buffers.Length()) {
+            Napi::Value val = buffers.Get(static_cast<uint32_t>(ch));
+            if (IsFloat32Array(val)) {
+                Napi::Float32Array channelData = val.As<Napi::Float32Array>();
+                writeSources_[ch] = channelData.Data();
+                writeFrames_[ch] = channelData.ElementLength();
+            }
+        }
+    }
+
+    size_t framesWritten = outputRing_.WriteInterleaved(writeSources_.data(), writeFrames_.data(), channels, frameCount);
+    if (framesWritten < frameCount) {
+        outputOverruns_++;
+    }
+    return framesWritten;
+}
+
+Napi::Value AsioStream::Release(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+        return Napi::Boolean::New(env, false);
+    }
+
+    // Accept the inputBuffers array or any one of its channel views
+    Napi::Value view = info[0];
+    if (view.IsArray()) {
+        Napi::Array views = view.As<Napi::Array>();
+        if (views.Length() == 0) {
+            return Napi::Boolean::New(env, false);
+        }
+        view = views.Get(0u);
+    }
+    if (!view.IsTypedArray()) {
+        return Napi::Boolean::New(env, false);
+    }
+
+    Napi::ArrayBuffer buffer = view.As<Napi::TypedArray>().ArrayBuffer();
+    AudioBlock* block = capture_.Pool()->BlockFor(buffer.Data());
+    if (!block || !block->owner) {
+        return Napi::Boolean::New(env, false);
+    }
+
+    // Detach first so no view can observe the block once it is reused
+    buffer.Detach();
+    ReturnLease(static_cast<BlockLease*>(block->owner));
+    return Napi::Boolean::New(env, true);
+}
+
+Napi::Value AsioStream::SetGraph(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // null/undefined removes the graph
+    if (info.Length() < 1 || info[0].IsNull() || info[0].IsUndefined()) {
+        graph_.Publish(nullptr);
+        latestGraph_ = nullptr;
+        return env.Undefined();
+    }
+    if (!info[0].IsObject()) {
+        Napi::TypeError::New(env, "Graph config object expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (outputChannels_ <= 0) {
+        Napi::Error::New(env, "Stream has no output channels").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object config = info[0].As<Napi::Object>();
+    Napi::Array buses = config.Has("buses") && config.Get("buses").IsArray()
+        ? config.Get("buses").As<Napi::Array>() : Napi::Array::New(env);
+
+    std::vector<MixTap> taps;
+    std::vector<MixRoute> routes;
+    std::vector<float> busGains;
+    std::vector<bool> busMutes;
+
+    for (uint32_t b = 0; b < buses.Length(); b++) {
+        if (!buses.Get(b).IsObject()) {
+            Napi::TypeError::New(env, "Bus config object expected").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        Napi::Object bus = buses.Get(b).As<Napi::Object>();
+
+        // inputs: [channel] or [{ channel, gain }]
+        Napi::Array inputs = bus.Has("inputs") && bus.Get("inputs").IsArray()
+            ? bus.Get("inputs").As<Napi::Array>() : Napi::Array::New(env);
+        for (uint32_t i = 0; i < inputs.Length(); i++) {
+            Napi::Value entry = inputs.Get(i);
+            int channel = -1;
+            float gain = 1.0f;
+            if (entry.IsNumber()) {
+                channel = entry.As<Napi::Number>().Int32Value();
+            } else if (entry.IsObject()) {
+                Napi::Object tap = entry.As<Napi::Object>();
+                if (tap.Get("channel").IsNumber()) channel = tap.Get("channel").As<Napi::Number>().Int32Value();
+                if (tap.Get("gain").IsNumber()) gain = tap.Get("gain").As<Napi::Number>().FloatValue();
+            }
+            if (channel < 0 || channel >= inputChannels_) {
+                Napi::RangeError::New(env, "Bus input channel out of range").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            taps.push_back({static_cast<int>(b), channel, gain});
+        }
+
+        Napi::Array outputs = bus.Has("outputs") && bus.Get("outputs").IsArray()
+            ? bus.Get("outputs").As<Napi::Array>() : Napi::Array::New(env);
+        for (uint32_t i = 0; i < outputs.Length(); i++) {
+            int channel = outputs.Get(i).IsNumber() ? outputs.Get(i).As<Napi::Number>().Int32Value() : -1;
+            if (channel < 0 || channel >= outputChannels_) {
+                Napi::RangeError::New(env, "Bus output channel out of range").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            routes.push_back({static_cast<int>(b), channel});
+        }
+
+        busGains.push_back(bus.Get("gain").IsNumber() ? bus.Get("gain").As<Napi::Number>().FloatValue() : 1.0f);
+        busMutes.push_back(bus.Get("mute").IsBoolean() ? bus.Get("mute").ToBoolean() : false);
+    }
+
+    size_t maxFrames = bufferSize_ > 0 ? bufferSize_ : 4096;
+    MixGraph* graph = new MixGraph(inputChannels_, outputChannels_, static_cast<int>(buses.Length()),
+                                   maxFrames, std::move(taps), std::move(routes));
+    for (size_t b = 0; b < busGains.size(); b++) {
+        graph->SetBusGain(static_cast<int>(b), busGains[b]);
+        graph->SetBusMute(static_cast<int>(b), busMutes[b]);
+    }
 
-    // Interleave data
-    std::vector<float> interleaved(frameCount * channelCount);
-    for (size_t ch = 0; ch < channelCount; ch++) {
-        Napi::Float32Array channelData = buffers.Get(ch).As<Napi::Float32Array>();
-        for (size_t i = 0; i < frameCount && i < channelData.ElementLength(); i++) {
-            interleaved[i * channelCount + ch] = channelData[i];
+    // Optional per-input-channel trims
+    if (config.Has("inputGains") && config.Get("inputGains").IsArray()) {
+        Napi::Array gains = config.Get("inputGains").As<Napi::Array>();
+        for (uint32_t ch = 0; ch < gains.Length() && ch < static_cast<uint32_t>(inputChannels_); ch++) {
+            if (gains.Get(ch).IsNumber()) {
+                graph->SetInputGain(static_cast<int>(ch), gains.Get(ch).As<Napi::Number>().FloatValue());
+            }
         }
     }
 
-    // Add to write buffer
-    std::lock_guard<std::mutex> lock(writeMutex_);
-    size_t spaceAvailable = writeBuffer_.size() - writePos_;
-    size_t samplesToWrite = std::min(interleaved.size(), spaceAvailable);
+    graph_.Publish(graph);
+    latestGraph_ = graph;
+    return env.Undefined();
+}
+
+Napi::Value AsioStream::SetBusGain(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+        Napi::TypeError::New(env, "setBusGain(bus, gain) expects two numbers").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    int bus = info[0].As<Napi::Number>().Int32Value();
+    if (!latestGraph_ || bus < 0 || bus >= latestGraph_->BusCount()) {
+        Napi::RangeError::New(env, "Bus index out of range").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    latestGraph_->SetBusGain(bus, info[1].As<Napi::Number>().FloatValue());
+    return env.Undefined();
+}
+
+Napi::Value AsioStream::SetBusMute(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "setBusMute(bus, mute) expects a bus index").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    int bus = info[0].As<Napi::Number>().Int32Value();
+    if (!latestGraph_ || bus < 0 || bus >= latestGraph_->BusCount()) {
+        Napi::RangeError::New(env, "Bus index out of range").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    latestGraph_->SetBusMute(bus, info[1].ToBoolean());
+    return env.Undefined();
+}
+
+Napi::Value AsioStream::SetInputGain(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+        Napi::TypeError::New(env, "setInputGain(channel, gain) expects two numbers").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    int channel = info[0].As<Napi::Number>().Int32Value();
+    if (!latestGraph_ || channel < 0 || channel >= latestGraph_->InputChannels()) {
+        Napi::RangeError::New(env, "Input channel out of range").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    latestGraph_->SetInputGain(channel, info[1].As<Napi::Number>().FloatValue());
+    return env.Undefined();
+}
+
+size_t AsioStream::WritePlanar(const Napi::Array& buffers, size_t frameCount) {
+    // One memcpy per channel into its lane of the ring
+    size_t offset, firstLen;
+    size_t freeFrames = outputRing_.PrepareWriteLanes(&offset, &firstLen);
+    size_t framesToWrite = std::min(frameCount, freeFrames);
+
+    if (framesToWrite < frameCount) {
+        outputOverruns_++;
+    }
+    if (framesToWrite == 0) {
+        return 0;
+    }
+
+    size_t head = std::min(framesToWrite, firstLen);
+    size_t tail = framesToWrite - head;
+
+    for (size_t ch = 0; ch < static_cast<size_t>(outputChannels_); ch++) {
+        const float* src = nullptr;
+        size_t srcFrames = 0;
+        if (ch < buffers.Length()) {
+            Napi::Value val = buffers.Get(static_cast<uint32_t>(ch));
+            if (IsFloat32Array(val)) {
+                Napi::Float32Array channelData = val.As<Napi::Float32Array>();
+                src = channelData.Data();
+                srcFrames = std::min(channelData.ElementLength(), framesToWrite);
+            }
+        }
 
-    if (samplesToWrite > 0) {
-        std::memcpy(writeBuffer_.data() + writePos_, interleaved.data(), samplesToWrite * sizeof(float));
-        writePos_ += samplesToWrite;
+        // Up to the wrap point, then from the start of the lane; short or
+        // missing channels are padded with silence
+        float* lane = outputRing_.Lane(ch);
+        size_t n1 = std::min(srcFrames, head);
+        size_t n2 = srcFrames - n1;
+        if (n1 > 0) std::memcpy(lane + offset, src, n1 * sizeof(float));
+        std::fill(lane + offset + n1, lane + offset + head, 0.0f);
+        if (n2 > 0) std::memcpy(lane, src + head, n2 * sizeof(float));
+        std::fill(lane + n2, lane + tail, 0.0f);
     }
 
-    return Napi::Number::New(env, static_cast<double>(samplesToWrite / channelCount));
+    outputRing_.CommitWrite(framesToWrite);
+    return framesToWrite;
+}
+
+Napi::Value AsioStream::GetId(const Napi::CallbackInfo& info) {
+    return Napi::Number::New(info.Env(), id_);
 }
 
 Napi::Value AsioStream::GetIsRunning(const Napi::CallbackInfo& info) {
@@ -397,6 +2907,7 @@ Napi::Value AsioStream::GetIsRunning(const Napi::CallbackInfo& info) {
 
 Napi::Value AsioStream::GetInputLatency(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
+    if (virtualDevice_) return Napi::Number::New(env, bufferSize_ * 1000.0 / sampleRate_);
     if (!stream_) return Napi::Number::New(env, 0);
 
     const PaStreamInfo* streamInfo = Pa_GetStreamInfo(stream_);
@@ -405,6 +2916,7 @@ Napi::Value AsioStream::GetInputLatency(const Napi::CallbackInfo& info) {
 
 Napi::Value AsioStream::GetOutputLatency(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
+    if (virtualDevice_) return Napi::Number::New(env, bufferSize_ * 1000.0 / sampleRate_);
     if (!stream_) return Napi::Number::New(env, 0);
 
     const PaStreamInfo* streamInfo = Pa_GetStreamInfo(stream_);
@@ -427,6 +2939,35 @@ Napi::Value AsioStream::GetOutputChannelCount(const Napi::CallbackInfo& info) {
     return Napi::Number::New(info.Env(), outputChannels_);
 }
 
+Napi::Value AsioStream::GetProfile(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Object profile = Napi::Object::New(env);
+
+    // Stage histograms are recorded in nanoseconds and reported in microseconds
+    static const char* const stageNames[] = {"output", "aggregate", "graph", "tap", "input", "enqueue", "total"};
+    Napi::Object stages = Napi::Object::New(env);
+    for (int i = 0; i < CallbackProfiler::kStageCount; i++) {
+        LatencyHistogram::Summary s = profiler_.Stage(static_cast<ProfileStage>(i)).Summarize();
+        Napi::Object stage = Napi::Object::New(env);
+        stage.Set("count", Napi::Number::New(env, static_cast<double>(s.count)));
+        stage.Set("mean", Napi::Number::New(env, s.mean / 1000.0));
+        stage.Set("p50", Napi::Number::New(env, s.p50 / 1000.0));
+        stage.Set("p95", Napi::Number::New(env, s.p95 / 1000.0));
+        stage.Set("p99", Napi::Number::New(env, s.p99 / 1000.0));
+        stage.Set("max", Napi::Number::New(env, s.max / 1000.0));
+        stages.Set(stageNames[i], stage);
+    }
+    profile.Set("stages", stages);
+
+    profile.Set("periodMicros", Napi::Number::New(env, bufferSize_ * 1e6 / sampleRate_));
+    profile.Set("deadlineFraction", Napi::Number::New(env, profiler_.DeadlineFraction()));
+    profile.Set("deadlineMisses", Napi::Number::New(env, static_cast<double>(profiler_.DeadlineMisses())));
+    profile.Set("overruns", Napi::Number::New(env, static_cast<double>(profiler_.Overruns())));
+    profile.Set("peakLoad", Napi::Number::New(env, profiler_.PeakLoad()));
+
+    return profile;
+}
+
 Napi::Value AsioStream::GetStats(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
     Napi::Object stats = Napi::Object::New(env);
@@ -435,12 +2976,198 @@ Napi::Value AsioStream::GetStats(const Napi::CallbackInfo& info) {
     stats.Set("inputUnderflows", Napi::Number::New(env, inputUnderflows_.load()));
     stats.Set("outputUnderflows", Napi::Number::New(env, outputUnderflows_.load()));
 
+    // Output write ring
+    size_t outChannels = outputChannels_ > 0 && !planar_ ? static_cast<size_t>(outputChannels_) : 1;
+    stats.Set("outputBufferFill", Napi::Number::New(env, static_cast<double>(outputRing_.ReadAvailable() / outChannels)));
+    stats.Set("outputBufferCapacity", Napi::Number::New(env, static_cast<double>(outputRing_.Capacity() / outChannels)));
+    stats.Set("outputOverruns", Napi::Number::New(env, static_cast<double>(outputOverruns_.load())));
+    stats.Set("outputStarved", Napi::Number::New(env, static_cast<double>(outputStarved_.load())));
+    if (jitterEnabled_) {
+        double framesPerMs = sampleRate_ / 1000.0;
+        Napi::Object jitter = Napi::Object::New(env);
+        jitter.Set("fillMs", Napi::Number::New(env, outputRing_.ReadAvailable() / outChannels / framesPerMs));
+        jitter.Set("targetMs", Napi::Number::New(env, jitter_.TargetFrames() / framesPerMs));
+        jitter.Set("latencyMs", Napi::Number::New(env, jitter_.AverageFill() / framesPerMs));
+        jitter.Set("producerJitterMs", Napi::Number::New(env, jitter_.ProducerJitter()));
+        jitter.Set("correctionPpm", Napi::Number::New(env, jitter_.CorrectionPpm()));
+        jitter.Set("concealments", Napi::Number::New(env, static_cast<double>(jitter_.Concealments())));
+        jitter.Set("concealedFrames", Napi::Number::New(env, static_cast<double>(jitter_.ConcealedFrames())));
+        jitter.Set("partialPeriods", Napi::Number::New(env, static_cast<double>(jitter_.PartialPeriods())));
+        jitter.Set("rebuffers", Napi::Number::New(env, static_cast<double>(jitter_.Rebuffers())));
+        jitter.Set("buffering", Napi::Boolean::New(env, jitter_.Buffering()));
+        stats.Set("jitterBuffer", jitter);
+    }
+
+    // Input block pool
+    stats.Set("poolBlocks", Napi::Number::New(env, static_cast<double>(capture_.Pool()->BlockCount())));
+    stats.Set("poolFree", Napi::Number::New(env, static_cast<double>(capture_.Pool()->FreeCount())));
+    stats.Set("poolExhausted", Napi::Number::New(env, static_cast<double>(capture_.PoolExhausted())));
+    stats.Set("oversizedPeriods", Napi::Number::New(env,
+        static_cast<double>(capture_.OversizedPeriods() + oversizedInput_.load(std::memory_order_relaxed))));
+
+    // Delivery queue
+    stats.Set("queueDepth", Napi::Number::New(env, static_cast<double>(capture_.QueueSize())));
+    stats.Set("queueCapacity", Napi::Number::New(env, static_cast<double>(capture_.QueueDepth())));
+    stats.Set("peakQueueDepth", Napi::Number::New(env, static_cast<double>(capture_.PeakQueueDepth())));
+    stats.Set("droppedBlocks", Napi::Number::New(env, static_cast<double>(capture_.DroppedBlocks())));
+    stats.Set("coalescedBlocks", Napi::Number::New(env, static_cast<double>(coalescedBlocks_.load())));
+    static const char* const policyNames[] = {"drop-oldest", "drop-newest", "coalesce"};
+    Napi::Array subscribers = Napi::Array::New(env);
+    for (int id = 1; id < InputCapture::kMaxSubscribers; id++) {
+        const InputSubscriber* subscriber = subscribers_[id];
+        if (!subscriber) {
+            continue;
+        }
+        Napi::Object entry = Napi::Object::New(env);
+        entry.Set("id", Napi::Number::New(env, id));
+        entry.Set("backpressure", Napi::String::New(env, policyNames[static_cast<int>(capture_.Policy(id))]));
+        entry.Set("queueDepth", Napi::Number::New(env, static_cast<double>(capture_.QueueSize(id))));
+        entry.Set("queueCapacity", Napi::Number::New(env, static_cast<double>(capture_.QueueDepth(id))));
+        entry.Set("peakQueueDepth", Napi::Number::New(env, static_cast<double>(capture_.PeakQueueDepth(id))));
+        entry.Set("droppedBlocks", Napi::Number::New(env, static_cast<double>(capture_.DroppedBlocks(id))));
+        entry.Set("deliveries", Napi::Number::New(env, static_cast<double>(subscriber->deliveries)));
+        entry.Set("deliveredFrames", Napi::Number::New(env, static_cast<double>(subscriber->deliveredFrames)));
+        subscribers.Set(subscribers.Length(), entry);
+    }
+    stats.Set("subscribers", subscribers);
+
+    // Delivery rate in JS calls per second of captured audio
+    double capturedSeconds = static_cast<double>(framesCaptured_.load()) / sampleRate_;
+    stats.Set("framesPerDelivery", Napi::Number::New(env, static_cast<double>(framesPerDelivery_)));
+    uint64_t deliveryCount = deliveryCount_.load(std::memory_order_relaxed);
+    uint64_t deliveredFrames = deliveredFrames_.load(std::memory_order_relaxed);
+    stats.Set("deliveryCount", Napi::Number::New(env, static_cast<double>(deliveryCount)));
+    stats.Set("deliveryRate", Napi::Number::New(env,
+        capturedSeconds > 0 ? static_cast<double>(deliveryCount) / capturedSeconds : 0));
+    stats.Set("averageBlockFrames", Napi::Number::New(env,
+        deliveryCount > 0 ? static_cast<double>(deliveredFrames) / static_cast<double>(deliveryCount) : 0));
+
+    // Histograms, reported in milliseconds
+    auto summarize = [&env](const LatencyHistogram& histogram) {
+        LatencyHistogram::Summary s = histogram.Summarize();
+        Napi::Object out = Napi::Object::New(env);
+        out.Set("count", Napi::Number::New(env, static_cast<double>(s.count)));
+        out.Set("mean", Napi::Number::New(env, s.mean / 1000.0));
+        out.Set("p50", Napi::Number::New(env, s.p50 / 1000.0));
+        out.Set("p95", Napi::Number::New(env, s.p95 / 1000.0));
+        out.Set("p99", Napi::Number::New(env, s.p99 / 1000.0));
+        out.Set("max", Napi::Number::New(env, s.max / 1000.0));
+        return out;
+    };
+    stats.Set("deliveryLatency", summarize(deliveryLatency_));
+    stats.Set("deliveryJitter", summarize(deliveryJitter_));
+
+    stats.Set("sharedRing", Napi::Boolean::New(env, sharedRing_.load() != nullptr));
+    if (history_) {
+        double held = std::min<double>(static_cast<double>(history_->Written()), historySeconds_ * sampleRate_);
+        Napi::Object history = Napi::Object::New(env);
+        history.Set("seconds", Napi::Number::New(env, historySeconds_));
+        history.Set("filledSeconds", Napi::Number::New(env, held / sampleRate_));
+        history.Set("memoryBytes", Napi::Number::New(env, static_cast<double>(history_->Bytes())));
+        history.Set("snapshots", Napi::Number::New(env, static_cast<double>(snapshots_)));
+        stats.Set("history", history);
+    }
+    if (encoder_) {
+        const OpusPipelineConfig& config = encoder_->Config();
+        double seconds = encoder_->FramesEncoded() * config.frameMs / 1000.0;
+        double encodeMs = encoder_->EncodeTime().Summarize().p50 / 1000.0;
+        Napi::Object encoder = Napi::Object::New(env);
+        encoder.Set("codec", Napi::String::New(env, "opus"));
+        encoder.Set("frameMs", Napi::Number::New(env, config.frameMs));
+        encoder.Set("bitrate", Napi::Number::New(env, config.bitrate));
+        encoder.Set("complexity", Napi::Number::New(env, config.complexity));
+        encoder.Set("groups", Napi::Number::New(env, encoder_->Groups()));
+        encoder.Set("threads", Napi::Number::New(env, encoder_->Threads()));
+        encoder.Set("lookaheadMs", Napi::Number::New(env, encoder_->Lookahead() * 1000.0 / sampleRate_));
+        encoder.Set("framesEncoded", Napi::Number::New(env, static_cast<double>(encoder_->FramesEncoded())));
+        encoder.Set("bytesEncoded", Napi::Number::New(env, static_cast<double>(encoder_->BytesEncoded())));
+        encoder.Set("averageBitrate", Napi::Number::New(env,
+            seconds > 0 ? encoder_->BytesEncoded() * 8 / seconds : 0));
+        encoder.Set("encodeTime", summarize(encoder_->EncodeTime()));
+        // Frames of audio encoded per frame of wall time at the median
+        encoder.Set("realtimeFactor", Napi::Number::New(env, encodeMs > 0 ? config.frameMs / encodeMs : 0));
+        encoder.Set("droppedInput", Napi::Number::New(env, static_cast<double>(encoder_->DroppedInput())));
+        encoder.Set("droppedFrames", Napi::Number::New(env, static_cast<double>(encoder_->DroppedFrames())));
+        encoder.Set("encodeErrors", Napi::Number::New(env, static_cast<double>(encoder_->EncodeErrors())));
+        encoder.Set("queueDepth", Napi::Number::New(env, static_cast<double>(encoder_->QueueDepth())));
+        stats.Set("encoder", encoder);
+    }
+    // Only the JS thread swaps the recorder, so it stays valid here
+    if (Recorder* recorder = recorder_.load()) {
+        double framesPerMs = sampleRate_ / 1000.0;
+        Napi::Object recording = Napi::Object::New(env);
+        Napi::Array files = Napi::Array::New(env, recorder->Files().size());
+        for (size_t i = 0; i < recorder->Files().size(); i++) {
+            files.Set(static_cast<uint32_t>(i), Napi::String::New(env, recorder->Files()[i]));
+        }
+        recording.Set("files", files);
+        recording.Set("frames", Napi::Number::New(env, static_cast<double>(recorder->FramesWritten())));
+        recording.Set("seconds", Napi::Number::New(env, recorder->FramesWritten() / sampleRate_));
+        recording.Set("bytesWritten", Napi::Number::New(env, static_cast<double>(recorder->BytesWritten())));
+        recording.Set("throughputMBps", Napi::Number::New(env, recorder->Throughput() / 1e6));
+        recording.Set("maxWriteMs", Napi::Number::New(env, recorder->MaxWriteMs()));
+        recording.Set("ringFillMs", Napi::Number::New(env, recorder->RingFill() / framesPerMs));
+        recording.Set("ringHighWaterMs", Napi::Number::New(env, recorder->RingHighWater() / framesPerMs));
+        recording.Set("ringCapacityMs", Napi::Number::New(env, recorder->RingFrames() / framesPerMs));
+        recording.Set("droppedFrames", Napi::Number::New(env, static_cast<double>(recorder->DroppedFrames())));
+        recording.Set("syncs", Napi::Number::New(env, static_cast<double>(recorder->Syncs())));
+        if (recorder->Failed()) {
+            recording.Set("error", Napi::String::New(env, recorder->Error()));
+        }
+        stats.Set("recording", recording);
+    }
+    stats.Set("channelSelection", Napi::String::New(env, channelSelection_));
+    stats.Set("deliverySampleRate", Napi::Number::New(env, deliverySampleRate_));
+    static const char* const formatNames[] = {"float32", "int16", "int24", "float16"};
+    stats.Set("deliveryFormat", Napi::String::New(env, formatNames[static_cast<int>(deliveryFormat_)]));
+    stats.Set("zeroCopy", Napi::Boolean::New(env,
+        zeroCopy_ && externalBuffersAllowed_ && deliveryFormat_ == SampleFormat::Float32 && !resampling_ &&
+        capture_.Subscribers() == 0));
+    stats.Set("zeroCopyFallbacks", Napi::Number::New(env, static_cast<double>(zeroCopyFallbacks_.load())));
+
     // CPU load
     double cpuLoad = 0;
-    if (stream_) {
+    if (virtualDevice_) {
+        cpuLoad = virtualDevice_->CpuLoad();
+    } else if (stream_) {
         cpuLoad = Pa_GetStreamCpuLoad(stream_);
     }
     stats.Set("cpuLoad", Napi::Number::New(env, cpuLoad));
 
+    if (virtualDevice_) {
+        Napi::Object device = Napi::Object::New(env);
+        device.Set("callbacks", Napi::Number::New(env, static_cast<double>(virtualDevice_->Callbacks())));
+        device.Set("missedDeadlines", Napi::Number::New(env, static_cast<double>(virtualDevice_->MissedDeadlines())));
+        device.Set("captureFrames", Napi::Number::New(env, static_cast<double>(virtualDevice_->CaptureAvailable())));
+        device.Set("captureOverruns", Napi::Number::New(env, static_cast<double>(virtualDevice_->CaptureOverruns())));
+        stats.Set("virtualDevice", device);
+    }
+
+    // Aggregate members, in channel order after this device's own
+    if (!aggregate_.empty()) {
+        Napi::Array members = Napi::Array::New(env, aggregate_.size());
+        for (size_t i = 0; i < aggregate_.size(); i++) {
+            const AggregateMember& member = *aggregate_[i];
+            const DriftCompensator& drift = member.compensator;
+            Napi::Object entry = Napi::Object::New(env);
+            if (member.virtualDevice) {
+                entry.Set("device", Napi::String::New(env, "virtual"));
+            } else {
+                entry.Set("device", Napi::Number::New(env, member.deviceIndex));
+            }
+            entry.Set("channels", Napi::Number::New(env, member.channels));
+            entry.Set("sampleRate", Napi::Number::New(env, member.sampleRate));
+            entry.Set("locked", Napi::Boolean::New(env, drift.Locked()));
+            entry.Set("driftPpm", Napi::Number::New(env, drift.MeasuredDriftPpm()));
+            entry.Set("correctionPpm", Napi::Number::New(env, drift.CorrectionPpm()));
+            entry.Set("bufferFill", Napi::Number::New(env, static_cast<double>(drift.Fill())));
+            entry.Set("targetFill", Napi::Number::New(env, static_cast<double>(drift.TargetFill())));
+            entry.Set("underruns", Napi::Number::New(env, static_cast<double>(drift.Underruns())));
+            entry.Set("overflows", Napi::Number::New(env, static_cast<double>(drift.Overflows())));
+            members.Set(static_cast<uint32_t>(i), entry);
+        }
+        stats.Set("aggregate", members);
+    }
+
     return stats;
 }
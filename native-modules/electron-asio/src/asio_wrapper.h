@@ -9,7 +9,27 @@
 #include <portaudio.h>
 #include <vector>
 #include <atomic>
+#include <memory>
+#include <deque>
 #include <mutex>
+#include "spsc_ring.h"
+#include "block_pool.h"
+#include "delivery_queue.h"
+#include "input_capture.h"
+#include "mix_graph.h"
+#include "level_meter.h"
+#include "shared_ring.h"
+#include "sample_format.h"
+#include "resampler.h"
+#include "channel_workers.h"
+#include "latency_histogram.h"
+#include "callback_profiler.h"
+#include "virtual_device.h"
+#include "drift_compensator.h"
+#include "jitter_buffer.h"
+#include "recorder.h"
+#include "history_ring.h"
+#include "opus_pipeline.h"
 
 class AsioStream : public Napi::ObjectWrap<AsioStream> {
 public:
@@ -18,8 +38,6 @@ public:
     ~AsioStream();
 
 private:
-    static Napi::FunctionReference constructor;
-
     // Stream control
     Napi::Value Start(const Napi::CallbackInfo& info);
     Napi::Value Stop(const Napi::CallbackInfo& info);
@@ -27,9 +45,50 @@ private:
 
     // Callback
     Napi::Value SetProcessCallback(const Napi::CallbackInfo& info);
+    // Module function: bind a stream's process callback from another
+    // environment, such as a worker_thread
+    static Napi::Value BindProcessCallback(const Napi::CallbackInfo& info);
     Napi::Value Write(const Napi::CallbackInfo& info);
+    Napi::Value Release(const Napi::CallbackInfo& info);
+    size_t WritePlanar(const Napi::Array& buffers, size_t frameCount);
+    size_t WriteInterleaved(const Napi::Array& buffers, size_t frameCount);
+
+    // Native monitoring graph
+    Napi::Value SetGraph(const Napi::CallbackInfo& info);
+    Napi::Value SetBusGain(const Napi::CallbackInfo& info);
+    Napi::Value SetBusMute(const Napi::CallbackInfo& info);
+    Napi::Value SetInputGain(const Napi::CallbackInfo& info);
+
+    // Metering
+    Napi::Value SetMeterCallback(const Napi::CallbackInfo& info);
+    Napi::Value SetPcmEnabled(const Napi::CallbackInfo& info);
+    Napi::Value ResetStats(const Napi::CallbackInfo& info);
+    Napi::Value ReadCapture(const Napi::CallbackInfo& info);
+    Napi::Value GetLevels(const Napi::CallbackInfo& info);
+
+    // SharedArrayBuffer ring transport
+    Napi::Value AttachSharedRing(const Napi::CallbackInfo& info);
+    Napi::Value DetachSharedRing(const Napi::CallbackInfo& info);
+    void DetachRing();
+
+    // Native recording to WAV/RF64 on a writer thread
+    Napi::Value StartRecording(const Napi::CallbackInfo& info);
+    Napi::Value StopRecording(const Napi::CallbackInfo& info);
+    // Take the recorder away from the audio thread, or nullptr if not recording
+    Recorder* DetachRecorder();
+
+    // Export the last seconds of input history, off the JS thread
+    Napi::Value Snapshot(const Napi::CallbackInfo& info);
+
+    // Fan-out: further consumers of the same captured blocks
+    Napi::Value Subscribe(const Napi::CallbackInfo& info);
+    Napi::Value Unsubscribe(const Napi::CallbackInfo& info);
+
+    // Opus packets from the native encoder pipeline
+    Napi::Value SetPacketCallback(const Napi::CallbackInfo& info);
 
     // Properties
+    Napi::Value GetId(const Napi::CallbackInfo& info);
     Napi::Value GetIsRunning(const Napi::CallbackInfo& info);
     Napi::Value GetInputLatency(const Napi::CallbackInfo& info);
     Napi::Value GetOutputLatency(const Napi::CallbackInfo& info);
@@ -38,8 +97,21 @@ private:
     Napi::Value GetInputChannelCount(const Napi::CallbackInfo& info);
     Napi::Value GetOutputChannelCount(const Napi::CallbackInfo& info);
     Napi::Value GetStats(const Napi::CallbackInfo& info);
+    Napi::Value GetProfile(const Napi::CallbackInfo& info);
+
+    // Constructor helpers: open a PortAudio stream or a virtual device.
+    // Both throw and return false on failure.
+    bool OpenDevice(Napi::Env env, std::vector<int>& inputSelect, std::vector<int>& outputSelect);
+    bool OpenVirtualDevice(Napi::Env env, Napi::Object options,
+                           std::vector<int>& inputSelect, std::vector<int>& outputSelect);
+    bool OpenAggregate(Napi::Env env, Napi::Array members);
 
-    // PortAudio callback
+    // Aggregate members start before and stop after the stream itself
+    bool StartAggregate();
+    void StopAggregate();
+    void CloseAggregate();
+
+    // PortAudio callback; the virtual device drives it too
     static int PaCallback(
         const void* inputBuffer,
         void* outputBuffer,
@@ -49,29 +121,254 @@ private:
         void* userData
     );
 
+    // Runs on the JS thread when PaCallback has queued blocks
+    static void DrainInput(Napi::Env env, Napi::Function jsCallback, AsioStream* self, void* unused);
+    using InputTsfn = Napi::TypedThreadSafeFunction<AsioStream, void, &AsioStream::DrainInput>;
+
+    // Process callback bound from another environment. The TSFN belongs to
+    // that environment, so it refers to the stream by id through the
+    // process-wide registry rather than holding it. Freed once both the
+    // stream and the TSFN have let go.
+    struct RemoteCallback;
+    static void DrainRemote(Napi::Env env, Napi::Function jsCallback, RemoteCallback* remote, void* unused);
+    using RemoteTsfn = Napi::TypedThreadSafeFunction<RemoteCallback, void, &AsioStream::DrainRemote>;
+    struct RemoteCallback {
+        uint32_t streamId;
+        RemoteTsfn tsfn;
+        std::mutex mutex;               // Orders Release against the finalizer
+        std::atomic<bool> closed;       // Finalized along with its environment
+        std::atomic<int> calls;         // Threads inside tsfn.NonBlockingCall
+        std::atomic<int> refs;          // Held by the stream and by the TSFN
+    };
+    static void ReleaseRemote(RemoteCallback* remote);
+    static void DropRemote(RemoteCallback* remote);
+
+    // Any thread: queue a drain on whichever environment owns the callback
+    bool ScheduleDrain();
+    // Release the local or remote process callback
+    void UnbindProcessCallback();
+    // Registry lock held: claim delivery for the callback that is current
+    bool BeginDelivery(RemoteCallback* remote);
+    void EndDelivery();
+    // Wait until no other thread is delivering
+    void AwaitDelivery();
+    void DeliverInput(Napi::Env env, Napi::Function jsCallback);
+
+    // Aggregate member callback: feeds the member's drift compensator
+    static int AggregateCallback(
+        const void* inputBuffer,
+        void* outputBuffer,
+        unsigned long framesPerBuffer,
+        const PaStreamCallbackTimeInfo* timeInfo,
+        PaStreamCallbackFlags statusFlags,
+        void* userData
+    );
+
+    // Audio thread: append every member's channels, locked to this stream's clock
+    const void* AggregateInput(const void* inputBuffer, size_t frames);
+
+    // Audio thread: native channel selection for host APIs without selectors
+    const void* SelectInput(const void* inputBuffer, size_t frames);
+    void* SelectOutput(void* outputBuffer, size_t frames);
+    void ScatterOutput(const float* compact, void* deviceOutput, size_t frames);
+
+    // Audio thread: InputCapture wake hook; schedules DrainInput
+    static void WakeInput(void* context);
+
+    // Runs on the JS thread when the meter publishes a snapshot
+    static void DeliverLevels(Napi::Env env, Napi::Function jsCallback, AsioStream* self, void* unused);
+    using MeterTsfn = Napi::TypedThreadSafeFunction<AsioStream, void, &AsioStream::DeliverLevels>;
+    // JS thread: stop waking the meter callback, then release it
+    void ReleaseMeterCallback();
+
+    // Encoder thread: OpusPipeline wake hook; schedules DeliverPackets
+    static void WakePackets(void* context);
+    static void DeliverPackets(Napi::Env env, Napi::Function jsCallback, AsioStream* self, void* unused);
+    using PacketTsfn = Napi::TypedThreadSafeFunction<AsioStream, void, &AsioStream::DeliverPackets>;
+    // JS thread: stop waking the packet callback, then release it
+    void ReleasePacketCallback();
+
+    // One fan-out subscriber; deleted by its TSFN finalizer
+    struct InputSubscriber;
+    static void WakeSubscriber(void* context);
+    static void DrainSubscriber(Napi::Env env, Napi::Function jsCallback, InputSubscriber* subscriber, void* unused);
+    using SubscriberTsfn = Napi::TypedThreadSafeFunction<InputSubscriber, void, &AsioStream::DrainSubscriber>;
+    struct InputSubscriber {
+        AsioStream* stream;
+        int id;
+        bool active;                        // JS thread: cleared by Unsubscribe
+        SubscriberTsfn tsfn;
+        std::atomic<bool> wakePending;
+        std::vector<AudioBlock*> batch;     // JS thread scratch for coalescing
+        std::vector<float*> planes;
+        uint64_t deliveries;
+        uint64_t deliveredFrames;
+    };
+    void RemoveSubscriber(int id);
+
+    void DeliverBlocks(Napi::Env env, Napi::Function jsCallback, AudioBlock* const* blocks, size_t count);
+    Napi::Array CopyBlocks(Napi::Env env, AudioBlock* const* blocks, size_t count, size_t framesPerChannel,
+                           std::vector<float*>& planes);
+    bool DeliverZeroCopy(Napi::Env env, Napi::Function jsCallback, AudioBlock* block);
+    void RecordDelivery(const AudioBlock* oldest, size_t frames);
+    float* const* StageBlocks(AudioBlock* const* blocks, size_t count, size_t framesPerChannel);
+    float* const* Resample(float* const* planes, int channels, size_t frames, size_t* outFrames);
+    Napi::Array ExportPlanes(Napi::Env env, float* const* planes, int channels, size_t frames);
+
     // Stream state
     PaStream* stream_;
+    std::unique_ptr<VirtualDevice> virtualDevice_;  // Set instead of stream_ for device: 'virtual'
     PaDeviceIndex deviceIndex_;
     double sampleRate_;
     unsigned long bufferSize_;
     int inputChannels_;
     int outputChannels_;
+    int deviceInputChannels_;   // Channels PortAudio opened; more than the
+    int deviceOutputChannels_;  // selection when selecting natively
+
+    // Channel selection done here rather than by the driver: device channel
+    // for each selected channel, plus scratch sized for one period
+    std::vector<int> inputMap_;
+    std::vector<int> outputMap_;
+    size_t selectFrames_;
+    std::atomic<uint64_t> oversizedInput_;  // Periods the scratch could not hold
+    std::vector<float> gatherInput_;
+    std::vector<float> scatterOutput_;
+    std::vector<const float*> inputPlanes_;
+    std::vector<float*> outputPlanes_;
+    const char* channelSelection_;  // "none", "asio" or "native"
+
+    // Aggregate input: further devices, each on its own clock, whose input
+    // is resampled onto this stream's clock and appended after its channels
+    struct AggregateMember {
+        PaStream* stream = nullptr;
+        std::unique_ptr<VirtualDevice> virtualDevice;
+        PaDeviceIndex deviceIndex = -1;
+        int channels = 0;
+        double sampleRate = 0;
+        unsigned long bufferSize = 0;
+        DriftCompensator compensator;
+    };
+    std::vector<std::unique_ptr<AggregateMember>> aggregate_;
+    int masterInputChannels_;   // This device's own (selected) input channels
+    std::vector<float> aggregateInput_;         // One period, all channels interleaved
+    std::vector<float> aggregatePlanar_;        // Member channels, one period each
+    std::vector<float*> memberPlanes_;
+    std::vector<const float*> aggregatePlanes_;
     std::atomic<bool> isRunning_;
     std::atomic<bool> isClosed_;
+    bool planar_;   // paNonInterleaved: per-channel buffers end to end
+
+    // Callback handling. The process callback is either local (tsfn_, this
+    // environment) or remote (bound from a worker); swaps happen under the
+    // registry lock.
+    uint32_t id_;                       // Key in the process-wide registry
+    InputTsfn tsfn_;
+    std::atomic<bool> localCallback_;   // tsfn_ is live
+    std::atomic<RemoteCallback*> remote_;
+    std::atomic<bool> hasCallback_;
+    std::atomic<int> wakeCalls_;        // Threads inside ScheduleDrain
+    std::atomic<int> delivering_;       // DrainInput/DrainRemote in progress
+
+    // Preallocated input blocks, accumulated to one delivery each and handed
+    // to the JS thread over a bounded queue; at most one TSFN call is ever
+    // pending
+    InputCapture capture_;
+    size_t inputPoolBlocks_;
+    std::atomic<bool> wakePending_;
+    std::vector<AudioBlock*> coalesceScratch_;
+    std::vector<InputSubscriber*> subscribers_;     // JS thread, by subscriber id
+    std::vector<const float*> writeSources_;    // JS thread scratch for write()
+    std::vector<size_t> writeFrames_;
+    std::vector<float*> channelPtrs_;   // Delivering thread scratch for deinterleaving
+    std::atomic<uint64_t> coalescedBlocks_;
+
+    size_t framesPerDelivery_;      // 0 = one delivery per period
+    std::atomic<uint64_t> framesCaptured_;
+    // Written by the delivering thread (JS or a bound worker), read by stats
+    std::atomic<uint64_t> deliveryCount_;
+    std::atomic<uint64_t> deliveredFrames_;
+
+    CallbackProfiler profiler_;     // Stage timings of PaCallback
 
-    // Callback handling
-    Napi::ThreadSafeFunction tsfn_;
-    bool hasCallback_;
+    // Capture-to-callback latency of the oldest audio in each delivery, and
+    // how far each delivery strays from the audio duration of the previous one
+    LatencyHistogram deliveryLatency_;
+    LatencyHistogram deliveryJitter_;
+    std::atomic<uint64_t> lastDeliveryTime_;    // 0 until the first delivery; reset by JS
+    std::atomic<uint64_t> lastDeliveryMicros_;  // Audio duration of that delivery
+
+    // Delivery sample format; conversion runs on the JS thread at delivery
+    SampleFormat deliveryFormat_;
+    bool dither_;
+    DitherState ditherState_;           // JS thread only
+
+    // Delivery sample-rate conversion, run on the JS thread
+    bool resampling_;
+    double deliverySampleRate_;
+    PolyphaseResampler resampler_;
+    std::unique_ptr<ChannelWorkers> resampleWorkers_;
+
+    // JS thread staging for the convert/resample path
+    std::vector<float> stageIn_;
+    std::vector<float> stageOut_;
+    std::vector<float*> stagePlanes_;
+    std::vector<float*> resampledPlanes_;
+
+    // Zero-copy delivery: JS receives views over pooled blocks
+    bool zeroCopy_;
+    bool externalBuffersAllowed_;
+    std::atomic<uint64_t> zeroCopyFallbacks_;
 
     // Stats
     std::atomic<uint64_t> callbackCount_;
     std::atomic<uint32_t> inputUnderflows_;
     std::atomic<uint32_t> outputUnderflows_;
 
-    // Write buffer for async output
-    std::mutex writeMutex_;
-    std::vector<float> writeBuffer_;
-    size_t writePos_;
+    // Write buffer for async output (JS thread produces, audio thread consumes)
+    SpscRing<float> outputRing_;
+    std::atomic<uint64_t> outputOverruns_;
+    std::atomic<uint64_t> outputStarved_;
+
+    // Optional adaptive playout of the write ring for uneven producers
+    bool jitterEnabled_;
+    JitterBuffer jitter_;
+
+    // Monitoring graph run inside PaCallback
+    GraphSlot graph_;
+    MixGraph* latestGraph_;     // JS thread: most recently published graph
+
+    // Native metering, published at a fixed rate instead of shipping PCM
+    LevelMeter meter_;
+    std::atomic<bool> meterEnabled_;
+    MeterTsfn meterTsfn_;
+    std::atomic<bool> hasMeterCallback_;
+    std::atomic<bool> meterWakePending_;
+    std::atomic<int> meterWakeCalls_;       // Audio thread is waking the meter callback
+    std::atomic<bool> pcmEnabled_;
+
+    // SharedArrayBuffer ring written straight from the audio thread
+    std::atomic<SharedRingWriter*> sharedRing_;
+    std::atomic<bool> sharedRingBusy_;      // Audio thread is inside Write
+    Napi::ObjectReference sharedRingRef_;   // Keeps the SharedArrayBuffer alive
+
+    // Recorder fed from the audio thread, with the same busy handshake
+    std::atomic<Recorder*> recorder_;
+    std::atomic<bool> recorderBusy_;
+
+    // Retrospective capture: the last historySeconds of input, always on.
+    // Shared with snapshot workers that may outlive the stream.
+    std::shared_ptr<HistoryRing> history_;
+    double historySeconds_;
+    uint64_t snapshots_;        // JS thread only
+
+    // Opus encoder, configured when the stream is opened
+    std::unique_ptr<OpusPipeline> encoder_;
+    PacketTsfn packetTsfn_;
+    std::atomic<bool> hasPacketCallback_;
+    std::atomic<bool> packetWakePending_;
+    std::atomic<int> packetWakeCalls_;      // Encoder thread inside WakePackets
+    std::deque<EncodedFrame> packets_;      // JS thread scratch
 };
 
 #endif // ASIO_WRAPPER_H
@@ -0,0 +1,153 @@
+/**
+ * BlockPool - fixed-size pool of audio blocks recycled without locks
+ *
+ * All blocks are carved out of one allocation made when the stream opens.
+ * Acquire/Release use a tagged Treiber stack, so the realtime thread can take
+ * a block and any other thread can hand it back without touching the heap.
+ * Blocks are reference counted so several consumers can share one captured
+ * block; it returns to the pool with the last Release.
+ */
+
+#ifndef BLOCK_POOL_H
+#define BLOCK_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct AudioBlock {
+    float* data;        // Sample storage owned by the pool
+    size_t capacity;    // Samples available in data
+    size_t frames;      // Frames currently held
+    size_t stride;      // Samples between channel starts when planar
+    int channels;       // Channels per frame
+    uint64_t sequence;  // Capture order, assigned by the producer
+    uint64_t captureTime; // MonotonicMicros() when the first period landed
+    bool planar;        // Channels stored back to back instead of interleaved
+    void* owner;        // JS-thread bookkeeping for blocks lent to JavaScript
+    uint32_t index;     // Slot in the owning pool
+};
+
+class BlockPool {
+public:
+    BlockPool() : base_(nullptr), stride_(0), head_(kEmptyHead), available_(0) {}
+
+    // Allocate blockCount blocks of samplesPerBlock floats each. Not thread
+    // safe: call only while no block is outstanding.
+    void Reset(size_t blockCount, size_t samplesPerBlock) {
+        // Round each block up to a 64-byte multiple and start the first one
+        // on a 64-byte boundary, so blocks never share a cache line
+        size_t stride = (samplesPerBlock + 15) & ~static_cast<size_t>(15);
+        stride_ = stride;
+
+        storage_.assign(blockCount * stride + 15, 0.0f);
+        base_ = storage_.data();
+        base_ += (64 - reinterpret_cast<uintptr_t>(base_) % 64) % 64 / sizeof(float);
+        blocks_.resize(blockCount);
+        next_.reset(blockCount > 0 ? new std::atomic<uint32_t>[blockCount] : nullptr);
+        refs_.reset(blockCount > 0 ? new std::atomic<uint32_t>[blockCount] : nullptr);
+
+        for (size_t i = 0; i < blockCount; i++) {
+            blocks_[i].data = base_ + i * stride;
+            blocks_[i].capacity = samplesPerBlock;
+            blocks_[i].frames = 0;
+            blocks_[i].stride = 0;
+            blocks_[i].channels = 0;
+            blocks_[i].sequence = 0;
+            blocks_[i].captureTime = 0;
+            blocks_[i].planar = false;
+            blocks_[i].owner = nullptr;
+            blocks_[i].index = static_cast<uint32_t>(i);
+            next_[i].store(i + 1 < blockCount ? static_cast<uint32_t>(i + 1) : kNone, std::memory_order_relaxed);
+            refs_[i].store(0, std::memory_order_relaxed);
+        }
+
+        head_.store(blockCount > 0 ? Pack(0, 0) : kEmptyHead, std::memory_order_release);
+        available_.store(static_cast<int64_t>(blockCount), std::memory_order_relaxed);
+    }
+
+    // Take a free block holding one reference, or nullptr when the pool is exhausted
+    AudioBlock* Acquire() {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        for (;;) {
+            uint32_t index = IndexOf(head);
+            if (index == kNone) {
+                return nullptr;
+            }
+            uint32_t next = next_[index].load(std::memory_order_relaxed);
+            if (head_.compare_exchange_weak(head, Pack(next, TagOf(head) + 1),
+                                            std::memory_order_acq_rel, std::memory_order_acquire)) {
+                available_.fetch_sub(1, std::memory_order_relaxed);
+                refs_[index].store(1, std::memory_order_relaxed);
+                return &blocks_[index];
+            }
+        }
+    }
+
+    // Add count references for further consumers of a held block
+    void Retain(AudioBlock* block, uint32_t count) {
+        refs_[block->index].fetch_add(count, std::memory_order_relaxed);
+    }
+
+    // Drop one reference; the last one returns the block to the pool
+    void Release(AudioBlock* block) {
+        if (!block) return;
+        uint32_t index = block->index;
+        if (refs_[index].fetch_sub(1, std::memory_order_acq_rel) > 1) {
+            return;
+        }
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            next_[index].store(IndexOf(head), std::memory_order_relaxed);
+            if (head_.compare_exchange_weak(head, Pack(index, TagOf(head) + 1),
+                                            std::memory_order_release, std::memory_order_relaxed)) {
+                available_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    // Map a pointer to a block's sample storage back to the block
+    AudioBlock* BlockFor(const void* data) {
+        const float* p = static_cast<const float*>(data);
+        if (stride_ == 0 || p < base_ || p >= base_ + blocks_.size() * stride_) {
+            return nullptr;
+        }
+        size_t offset = static_cast<size_t>(p - base_);
+        if (offset % stride_ != 0) {
+            return nullptr;
+        }
+        return &blocks_[offset / stride_];
+    }
+
+    size_t BlockCount() const { return blocks_.size(); }
+    size_t FreeCount() const {
+        int64_t n = available_.load(std::memory_order_relaxed);
+        return n > 0 ? static_cast<size_t>(n) : 0;
+    }
+
+private:
+    static constexpr uint32_t kNone = 0xFFFFFFFFu;
+    static constexpr uint64_t kEmptyHead = kNone;
+
+    // The tag in the upper half changes on every successful swap, which keeps
+    // a stale compare-exchange from succeeding after an A-B-A reuse
+    static uint64_t Pack(uint32_t index, uint32_t tag) {
+        return (static_cast<uint64_t>(tag) << 32) | index;
+    }
+    static uint32_t IndexOf(uint64_t head) { return static_cast<uint32_t>(head); }
+    static uint32_t TagOf(uint64_t head) { return static_cast<uint32_t>(head >> 32); }
+
+    std::vector<float> storage_;
+    float* base_;                   // First 64-byte boundary in storage_
+    std::vector<AudioBlock> blocks_;
+    size_t stride_;
+    std::unique_ptr<std::atomic<uint32_t>[]> next_;
+    std::unique_ptr<std::atomic<uint32_t>[]> refs_;
+    std::atomic<uint64_t> head_;
+    std::atomic<int64_t> available_;
+};
+
+#endif // BLOCK_POOL_H
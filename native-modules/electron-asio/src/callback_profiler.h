@@ -0,0 +1,94 @@
+/**
+ * CallbackProfiler - per-stage execution time of the realtime callback
+ *
+ * PaCallback brackets each internal stage with monotonic timestamps and
+ * records the elapsed nanoseconds here. Every stage has its own
+ * LatencyHistogram, so recording never allocates or locks. Each callback's
+ * total is also checked against the period it had to fill: one that uses
+ * more than the configured fraction of its period is a deadline miss, and
+ * one that takes longer than the whole period is an overrun.
+ */
+
+#ifndef CALLBACK_PROFILER_H
+#define CALLBACK_PROFILER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "latency_histogram.h"
+
+enum class ProfileStage {
+    Output,     // Channel selection and write ring read
+    Aggregate,  // Pulling aggregate members through drift compensation
+    Graph,      // Monitoring graph
+    Tap,        // Meter and shared ring
+    Input,      // Copy into the delivery block, excluding enqueue
+    Enqueue,    // Queue push, eviction and JS wakeup
+    Total,      // Whole callback
+    Count
+};
+
+class CallbackProfiler {
+public:
+    static const int kStageCount = static_cast<int>(ProfileStage::Count);
+
+    CallbackProfiler() : nanosPerFrame_(0), deadlineFraction_(0.75) {
+        Reset();
+    }
+
+    // Not thread safe: call before the stream starts
+    void Configure(double sampleRate, double deadlineFraction) {
+        nanosPerFrame_ = sampleRate > 0 ? 1e9 / sampleRate : 0;
+        deadlineFraction_ = deadlineFraction;
+    }
+
+    void Reset() {
+        for (LatencyHistogram& stage : stages_) {
+            stage.Reset();
+        }
+        deadlineMisses_.store(0, std::memory_order_relaxed);
+        overruns_.store(0, std::memory_order_relaxed);
+        peakLoad_.store(0, std::memory_order_relaxed);
+    }
+
+    void Record(ProfileStage stage, uint64_t nanos) {
+        stages_[static_cast<int>(stage)].Record(nanos);
+    }
+
+    // Record a finished callback's total against its period
+    void EndCallback(uint64_t nanos, size_t frames) {
+        Record(ProfileStage::Total, nanos);
+        double period = static_cast<double>(frames) * nanosPerFrame_;
+        if (period <= 0) {
+            return;
+        }
+        double load = static_cast<double>(nanos) / period;
+        if (load > deadlineFraction_) {
+            deadlineMisses_.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (load > 1.0) {
+            overruns_.fetch_add(1, std::memory_order_relaxed);
+        }
+        // Peak load in 1/1000ths of the period
+        uint64_t permille = static_cast<uint64_t>(load * 1000.0);
+        uint64_t seen = peakLoad_.load(std::memory_order_relaxed);
+        while (permille > seen && !peakLoad_.compare_exchange_weak(seen, permille, std::memory_order_relaxed)) {
+        }
+    }
+
+    const LatencyHistogram& Stage(ProfileStage stage) const { return stages_[static_cast<int>(stage)]; }
+    double DeadlineFraction() const { return deadlineFraction_; }
+    uint64_t DeadlineMisses() const { return deadlineMisses_.load(std::memory_order_relaxed); }
+    uint64_t Overruns() const { return overruns_.load(std::memory_order_relaxed); }
+    double PeakLoad() const { return peakLoad_.load(std::memory_order_relaxed) / 1000.0; }
+
+private:
+    LatencyHistogram stages_[kStageCount];
+    double nanosPerFrame_;
+    double deadlineFraction_;
+    std::atomic<uint64_t> deadlineMisses_;
+    std::atomic<uint64_t> overruns_;
+    std::atomic<uint64_t> peakLoad_;
+};
+
+#endif // CALLBACK_PROFILER_H
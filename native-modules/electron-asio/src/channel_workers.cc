@@ -0,0 +1,79 @@
+/**
+ * ChannelWorkers implementation
+ */
+
+#include "channel_workers.h"
+
+ChannelWorkers::ChannelWorkers(int threads)
+    : generation_(0), stopping_(false), busy_(0), work_(nullptr), count_(0), next_(0) {
+    for (int i = 0; i < threads; i++) {
+        threads_.emplace_back(&ChannelWorkers::WorkerLoop, this);
+    }
+}
+
+ChannelWorkers::~ChannelWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+void ChannelWorkers::Run(int count, const std::function<void(int)>& work) {
+    if (threads_.empty() || count <= 1) {
+        for (int ch = 0; ch < count; ch++) {
+            work(ch);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        work_ = &work;
+        count_ = count;
+        next_.store(0, std::memory_order_relaxed);
+        busy_ = static_cast<int>(threads_.size());
+        generation_++;
+    }
+    wake_.notify_all();
+
+    // The caller works too, then waits for the stragglers
+    Drain();
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return busy_ == 0; });
+    work_ = nullptr;
+}
+
+void ChannelWorkers::Drain() {
+    for (;;) {
+        int ch = next_.fetch_add(1, std::memory_order_relaxed);
+        if (ch >= count_) {
+            return;
+        }
+        (*work_)(ch);
+    }
+}
+
+void ChannelWorkers::WorkerLoop() {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this, seen] { return stopping_ || generation_ != seen; });
+            if (stopping_) {
+                return;
+            }
+            seen = generation_;
+        }
+
+        Drain();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--busy_ == 0) {
+            done_.notify_one();
+        }
+    }
+}
@@ -0,0 +1,47 @@
+/**
+ * ChannelWorkers - small fixed thread pool for per-channel JS-thread work
+ *
+ * Run() hands channels out one at a time to the pool threads and the
+ * calling thread, and returns once every channel is done. Used to spread
+ * wide streams across cores without holding up the JS thread for the sum.
+ */
+
+#ifndef CHANNEL_WORKERS_H
+#define CHANNEL_WORKERS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ChannelWorkers {
+public:
+    explicit ChannelWorkers(int threads);
+    ~ChannelWorkers();
+
+    int Threads() const { return static_cast<int>(threads_.size()); }
+
+    // Call work(channel) for every channel in [0, count). Not reentrant.
+    void Run(int count, const std::function<void(int)>& work);
+
+private:
+    void WorkerLoop();
+    void Drain();
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    uint64_t generation_;
+    bool stopping_;
+    int busy_;                          // Pool threads still inside a job
+
+    const std::function<void(int)>* work_;
+    int count_;
+    std::atomic<int> next_;
+};
+
+#endif // CHANNEL_WORKERS_H
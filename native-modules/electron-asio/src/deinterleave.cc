@@ -0,0 +1,184 @@
+/**
+ * Deinterleave kernels
+ */
+
+#include "deinterleave.h"
+#include "simd.h"
+#include <cstring>
+
+namespace kernels {
+
+void DeinterleaveScalar(const float* src, float* const* dst, size_t frames, int channels) {
+    for (int ch = 0; ch < channels; ch++) {
+        float* out = dst[ch];
+        for (size_t i = 0; i < frames; i++) {
+            out[i] = src[i * channels + ch];
+        }
+    }
+}
+
+// Scalar tail for channels [firstChannel, channels) and frames [firstFrame, frames)
+static void DeinterleaveTail(const float* src, float* const* dst, size_t firstFrame, size_t frames,
+                             int firstChannel, int channels, int stride) {
+    for (size_t i = firstFrame; i < frames; i++) {
+        const float* frame = src + i * stride;
+        for (int ch = firstChannel; ch < channels; ch++) {
+            dst[ch][i] = frame[ch];
+        }
+    }
+}
+
+#if ASIO_HAVE_SSE2
+
+static void Deinterleave2Sse2(const float* src, float* const* dst, size_t frames) {
+    float* left = dst[0];
+    float* right = dst[1];
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128 a = _mm_loadu_ps(src + i * 2);       // L0 R0 L1 R1
+        __m128 b = _mm_loadu_ps(src + i * 2 + 4);   // L2 R2 L3 R3
+        _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    DeinterleaveTail(src, dst, i, frames, 0, 2, 2);
+}
+
+// Transposes 4x4 tiles: four frames of four adjacent channels at a time.
+// Handles any stream of at least four channels; leftover channels go scalar.
+static void DeinterleaveGroupsSse2(const float* src, float* const* dst, size_t frames,
+                                   int firstChannel, int channels) {
+    int groupEnd = firstChannel + ((channels - firstChannel) & ~3);
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        const float* row = src + i * channels;
+        for (int ch = firstChannel; ch < groupEnd; ch += 4) {
+            __m128 r0 = _mm_loadu_ps(row + ch);
+            __m128 r1 = _mm_loadu_ps(row + channels + ch);
+            __m128 r2 = _mm_loadu_ps(row + channels * 2 + ch);
+            __m128 r3 = _mm_loadu_ps(row + channels * 3 + ch);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(dst[ch] + i, r0);
+            _mm_storeu_ps(dst[ch + 1] + i, r1);
+            _mm_storeu_ps(dst[ch + 2] + i, r2);
+            _mm_storeu_ps(dst[ch + 3] + i, r3);
+        }
+    }
+    DeinterleaveTail(src, dst, i, frames, firstChannel, groupEnd, channels);
+    DeinterleaveTail(src, dst, 0, frames, groupEnd, channels, channels);
+}
+
+#endif // ASIO_HAVE_SSE2
+
+#if ASIO_HAVE_AVX2
+
+ASIO_TARGET_AVX2
+static void Deinterleave2Avx2(const float* src, float* const* dst, size_t frames) {
+    float* left = dst[0];
+    float* right = dst[1];
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m256 a = _mm256_loadu_ps(src + i * 2);
+        __m256 b = _mm256_loadu_ps(src + i * 2 + 8);
+        // Per-lane shuffle leaves 64-bit pairs out of order; permute restores them
+        __m256 l = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        l = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(l), _MM_SHUFFLE(3, 1, 2, 0)));
+        r = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm256_storeu_ps(left + i, l);
+        _mm256_storeu_ps(right + i, r);
+    }
+    DeinterleaveTail(src, dst, i, frames, 0, 2, 2);
+}
+
+// Transposes 8x8 tiles: eight frames of eight adjacent channels at a time.
+// Returns the first channel not covered by a full group of eight.
+ASIO_TARGET_AVX2
+static int DeinterleaveGroupsAvx2(const float* src, float* const* dst, size_t frames, int channels) {
+    int groupEnd = channels & ~7;
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        const float* row = src + i * channels;
+        for (int ch = 0; ch < groupEnd; ch += 8) {
+            __m256 r0 = _mm256_loadu_ps(row + ch);
+            __m256 r1 = _mm256_loadu_ps(row + channels + ch);
+            __m256 r2 = _mm256_loadu_ps(row + channels * 2 + ch);
+            __m256 r3 = _mm256_loadu_ps(row + channels * 3 + ch);
+            __m256 r4 = _mm256_loadu_ps(row + channels * 4 + ch);
+            __m256 r5 = _mm256_loadu_ps(row + channels * 5 + ch);
+            __m256 r6 = _mm256_loadu_ps(row + channels * 6 + ch);
+            __m256 r7 = _mm256_loadu_ps(row + channels * 7 + ch);
+
+            __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+            __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+            __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+            __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+            __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+            __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+            __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+            __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+
+            __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+            __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+            __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+            __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+            __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+            __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+            __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+            __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+            _mm256_storeu_ps(dst[ch] + i, _mm256_permute2f128_ps(u0, u4, 0x20));
+            _mm256_storeu_ps(dst[ch + 1] + i, _mm256_permute2f128_ps(u1, u5, 0x20));
+            _mm256_storeu_ps(dst[ch + 2] + i, _mm256_permute2f128_ps(u2, u6, 0x20));
+            _mm256_storeu_ps(dst[ch + 3] + i, _mm256_permute2f128_ps(u3, u7, 0x20));
+            _mm256_storeu_ps(dst[ch + 4] + i, _mm256_permute2f128_ps(u0, u4, 0x31));
+            _mm256_storeu_ps(dst[ch + 5] + i, _mm256_permute2f128_ps(u1, u5, 0x31));
+            _mm256_storeu_ps(dst[ch + 6] + i, _mm256_permute2f128_ps(u2, u6, 0x31));
+            _mm256_storeu_ps(dst[ch + 7] + i, _mm256_permute2f128_ps(u3, u7, 0x31));
+        }
+    }
+    DeinterleaveTail(src, dst, i, frames, 0, groupEnd, channels);
+    return groupEnd;
+}
+
+#endif // ASIO_HAVE_AVX2
+
+void Deinterleave(const float* src, float* const* dst, size_t frames, int channels) {
+    if (channels <= 0 || frames == 0) {
+        return;
+    }
+    if (channels == 1) {
+        std::memcpy(dst[0], src, frames * sizeof(float));
+        return;
+    }
+
+#if ASIO_HAVE_AVX2
+    if (simd::HasAvx2()) {
+        if (channels == 2) {
+            Deinterleave2Avx2(src, dst, frames);
+            return;
+        }
+        if (channels >= 8) {
+            int done = DeinterleaveGroupsAvx2(src, dst, frames, channels);
+            if (done < channels) {
+                DeinterleaveGroupsSse2(src, dst, frames, done, channels);
+            }
+            return;
+        }
+    }
+#endif
+
+#if ASIO_HAVE_SSE2
+    if (channels == 2) {
+        Deinterleave2Sse2(src, dst, frames);
+        return;
+    }
+    if (channels >= 4) {
+        DeinterleaveGroupsSse2(src, dst, frames, 0, channels);
+        return;
+    }
+#endif
+
+    DeinterleaveTail(src, dst, 0, frames, 0, channels, channels);
+}
+
+} // namespace kernels
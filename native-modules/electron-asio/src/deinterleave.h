@@ -0,0 +1,25 @@
+/**
+ * Interleaved to per-channel (planar) sample conversion
+ */
+
+#ifndef DEINTERLEAVE_H
+#define DEINTERLEAVE_H
+
+#include <cstddef>
+
+namespace kernels {
+
+// Split frames of interleaved src into channels destination arrays.
+// Mono is a memcpy and stereo has its own shuffle kernel (AVX2 or SSE2).
+// Wider streams transpose tiles of adjacent channels: 8x8 with AVX2 for 8
+// or more channels, 4x4 with SSE2 for the rest of them and for 4-7
+// channels. Channels and frames left over from the tiles, and 3-channel
+// streams, go through a scalar loop.
+void Deinterleave(const float* src, float* const* dst, size_t frames, int channels);
+
+// Reference implementation: one strided pass per channel
+void DeinterleaveScalar(const float* src, float* const* dst, size_t frames, int channels);
+
+} // namespace kernels
+
+#endif // DEINTERLEAVE_H
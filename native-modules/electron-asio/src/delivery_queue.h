@@ -0,0 +1,90 @@
+/**
+ * DeliveryQueue - bounded single-producer/single-consumer queue of blocks
+ *
+ * Sits between PaCallback and the JS thread. Unlike a plain ring, the
+ * producer may evict the oldest queued block when full, so a stalled consumer
+ * costs a bounded number of blocks instead of unbounded memory. Slots are
+ * swapped atomically, so every block has exactly one owner at any time; the
+ * consumer uses block sequence numbers to discard anything that was lapped.
+ */
+
+#ifndef DELIVERY_QUEUE_H
+#define DELIVERY_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "block_pool.h"
+
+#ifndef ASIO_CACHE_LINE_SIZE
+#define ASIO_CACHE_LINE_SIZE 64
+#endif
+
+enum class BackpressurePolicy {
+    DropOldest,   // Evict the oldest queued block to make room
+    DropNewest,   // Reject the incoming block
+    Coalesce      // Merge the backlog into one delivery; evict the oldest when full
+};
+
+class DeliveryQueue {
+public:
+    DeliveryQueue() : depth_(0), writeIndex_(0), readIndex_(0) {}
+
+    // Not thread safe: call only while neither side is running
+    void Reset(size_t depth) {
+        depth_ = depth > 0 ? depth : 1;
+        slots_.reset(new std::atomic<AudioBlock*>[depth_]);
+        for (size_t i = 0; i < depth_; i++) {
+            slots_[i].store(nullptr, std::memory_order_relaxed);
+        }
+        writeIndex_.store(0, std::memory_order_relaxed);
+        readIndex_.store(0, std::memory_order_relaxed);
+    }
+
+    size_t Depth() const { return depth_; }
+
+    size_t Size() const {
+        size_t n = writeIndex_.load(std::memory_order_acquire) - readIndex_.load(std::memory_order_acquire);
+        return n < depth_ ? n : depth_;
+    }
+
+    // Producer. Returns false if the queue is full and evictOldest is not set.
+    // A block pushed out to make room is returned through evicted.
+    bool Push(AudioBlock* block, bool evictOldest, AudioBlock** evicted) {
+        *evicted = nullptr;
+        size_t w = writeIndex_.load(std::memory_order_relaxed);
+        size_t r = readIndex_.load(std::memory_order_acquire);
+        if (w - r >= depth_ && !evictOldest) {
+            return false;
+        }
+        // When full, slot w aliases the oldest unread block
+        *evicted = slots_[w % depth_].exchange(block, std::memory_order_acq_rel);
+        writeIndex_.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer. Returns the next queued block, or nullptr when empty.
+    AudioBlock* Pop() {
+        size_t r = readIndex_.load(std::memory_order_relaxed);
+        size_t w = writeIndex_.load(std::memory_order_acquire);
+        if (w - r > depth_) {
+            r = w - depth_;   // Producer lapped us
+        }
+        AudioBlock* block = nullptr;
+        while (r != w && !block) {
+            block = slots_[r % depth_].exchange(nullptr, std::memory_order_acq_rel);
+            r++;
+        }
+        readIndex_.store(r, std::memory_order_release);
+        return block;
+    }
+
+private:
+    size_t depth_;
+    std::unique_ptr<std::atomic<AudioBlock*>[]> slots_;
+    alignas(ASIO_CACHE_LINE_SIZE) std::atomic<size_t> writeIndex_;
+    alignas(ASIO_CACHE_LINE_SIZE) std::atomic<size_t> readIndex_;
+};
+
+#endif // DELIVERY_QUEUE_H
@@ -0,0 +1,191 @@
+/**
+ * DriftCompensator implementation
+ */
+
+#include "drift_compensator.h"
+#include "deinterleave.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Loop gains, per second of error: a natural frequency of ~0.07 rad/s with
+// damping near 1 settles a 100 ppm step in about a minute while ignoring the
+// fill sawtooth that period-sized pushes and pulls produce
+const double kProportional = 0.15;
+const double kIntegral = 0.005;
+const double kFillSmoothingSeconds = 1.0;
+const double kMaxCorrection = 1000e-6;
+
+// Measured drift needs enough frames for period granularity to wash out
+const double kMinMeasureSeconds = 1.0;
+
+} // namespace
+
+DriftCompensator::DriftCompensator()
+    : channels_(0),
+      nominal_(1.0),
+      masterRate_(48000),
+      target_(0),
+      pushFrames_(0),
+      ratio_(1.0),
+      filteredFill_(0),
+      integral_(0),
+      masterFrames_(0),
+      primed_(false),
+      slaveFrames_(0),
+      slaveBase_(0),
+      lastPush_(0),
+      masterCount_(0),
+      correctionPpm_(0),
+      underruns_(0),
+      overflows_(0) {}
+
+void DriftCompensator::Reset(int channels, double masterRate, double slaveRate,
+                             size_t maxPullFrames, size_t pushFrames) {
+    channels_ = channels;
+    masterRate_ = masterRate;
+    nominal_ = slaveRate / masterRate;
+
+    // Two slave periods plus two master periods (in slave frames) absorbs
+    // the scheduling of both callbacks
+    size_t pullFrames = static_cast<size_t>(std::ceil(maxPullFrames * nominal_));
+    pushFrames_ = pushFrames;
+    target_ = 2 * pushFrames + 2 * pullFrames;
+    ring_.Reset(target_ * 4, channels);
+    pushPtrs_.assign(channels, nullptr);
+
+    resampler_.Reset(channels, maxPullFrames, nominal_ * (1.0 + kMaxCorrection));
+    ratio_ = nominal_;
+    filteredFill_ = static_cast<double>(target_);
+    integral_ = 0;
+    masterFrames_ = 0;
+    primed_ = false;
+    slaveFrames_ = 0;
+    slaveBase_ = 0;
+    lastPush_ = 0;
+    masterCount_ = 0;
+    correctionPpm_ = 0;
+    underruns_ = 0;
+    overflows_ = 0;
+}
+
+void DriftCompensator::Push(const void* input, size_t frames, bool planar, uint64_t now) {
+    if (!input || channels_ == 0) {
+        slaveFrames_.fetch_add(frames, std::memory_order_relaxed);
+        return;
+    }
+
+    size_t offset, firstLen;
+    size_t n = std::min(frames, ring_.PrepareWriteLanes(&offset, &firstLen));
+    if (n < frames) {
+        overflows_.fetch_add(1, std::memory_order_relaxed);
+    }
+    size_t a = std::min(n, firstLen);
+
+    if (planar) {
+        const float* const* in = static_cast<const float* const*>(input);
+        for (int ch = 0; ch < channels_; ch++) {
+            float* lane = ring_.Lane(ch);
+            std::memcpy(lane + offset, in[ch], a * sizeof(float));
+            std::memcpy(lane, in[ch] + a, (n - a) * sizeof(float));
+        }
+    } else {
+        // Deinterleave straight into the ring, once per contiguous region
+        const float* in = static_cast<const float*>(input);
+        for (int ch = 0; ch < channels_; ch++) {
+            pushPtrs_[ch] = ring_.Lane(ch) + offset;
+        }
+        kernels::Deinterleave(in, pushPtrs_.data(), a, channels_);
+        if (n > a) {
+            for (int ch = 0; ch < channels_; ch++) {
+                pushPtrs_[ch] = ring_.Lane(ch);
+            }
+            kernels::Deinterleave(in + a * channels_, pushPtrs_.data(), n - a, channels_);
+        }
+    }
+    ring_.CommitWrite(n);
+    slaveFrames_.fetch_add(frames, std::memory_order_relaxed);
+    lastPush_.store(now, std::memory_order_release);
+}
+
+double DriftCompensator::SmoothFill(uint64_t now, size_t* fill) const {
+    // Re-read if a push lands between the timestamp and the fill
+    uint64_t pushed;
+    do {
+        pushed = lastPush_.load(std::memory_order_acquire);
+        *fill = ring_.ReadAvailable();
+    } while (pushed != lastPush_.load(std::memory_order_acquire));
+
+    // Frames the slave has captured since its last push are on their way;
+    // counting them removes the push-sized sawtooth that would otherwise
+    // beat against the master's period
+    double since = now > pushed ? (now - pushed) * 1e-9 : 0.0;
+    double pending = std::min(since * nominal_ * masterRate_, static_cast<double>(pushFrames_));
+    return static_cast<double>(*fill) + pending;
+}
+
+void DriftCompensator::Pull(float* const* out, size_t frames, uint64_t now) {
+    size_t fill;
+    double smoothed = SmoothFill(now, &fill);
+
+    if (!primed_.load(std::memory_order_relaxed)) {
+        if (fill < target_) {
+            for (int ch = 0; ch < channels_; ch++) {
+                std::memset(out[ch], 0, frames * sizeof(float));
+            }
+            return;
+        }
+        // Lock from here: drift is measured against the frames the slave
+        // delivers from now on
+        slaveBase_.store(slaveFrames_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        masterFrames_ = 0;
+        filteredFill_ = smoothed;
+        resampler_.Clear();
+        primed_.store(true, std::memory_order_relaxed);
+    }
+
+    // PI controller on the smoothed fill, in seconds of slave audio
+    double dt = frames / masterRate_;
+    double alpha = std::min(1.0, dt / kFillSmoothingSeconds);
+    filteredFill_ += alpha * (smoothed - filteredFill_);
+    double error = (filteredFill_ - static_cast<double>(target_)) / (nominal_ * masterRate_);
+    integral_ += error * dt;
+    // Keep the integrator inside what the clamp can use (anti-windup)
+    integral_ = std::max(-kMaxCorrection / kIntegral, std::min(kMaxCorrection / kIntegral, integral_));
+    double correction = kProportional * error + kIntegral * integral_;
+    correction = std::max(-kMaxCorrection, std::min(kMaxCorrection, correction));
+    ratio_ = nominal_ * (1.0 + correction);
+    correctionPpm_.store(correction * 1e6, std::memory_order_relaxed);
+
+    size_t need = resampler_.InputNeeded(frames, ratio_);
+    if (need > fill) {
+        // Not enough buffered: emit silence and let the ring refill rather
+        // than stretching what is there
+        underruns_.fetch_add(1, std::memory_order_relaxed);
+        for (int ch = 0; ch < channels_; ch++) {
+            std::memset(out[ch], 0, frames * sizeof(float));
+        }
+        // Resume from the silence just played, not from the audio before it
+        resampler_.Clear();
+        return;
+    }
+    ring_.ReadLanes(resampler_.InputPlanes(), need);
+    resampler_.Process(out, frames, ratio_);
+
+    masterFrames_ += frames;
+    masterCount_.store(masterFrames_, std::memory_order_relaxed);
+}
+
+double DriftCompensator::MeasuredDriftPpm() const {
+    if (!primed_.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    uint64_t master = masterCount_.load(std::memory_order_relaxed);
+    if (master < kMinMeasureSeconds * masterRate_) {
+        return 0;
+    }
+    uint64_t slave = slaveFrames_.load(std::memory_order_relaxed) - slaveBase_.load(std::memory_order_relaxed);
+    return (static_cast<double>(slave) / (static_cast<double>(master) * nominal_) - 1.0) * 1e6;
+}
@@ -0,0 +1,86 @@
+/**
+ * DriftCompensator - locks a secondary device's input to the master clock
+ *
+ * The secondary device's audio thread pushes whatever it captures into a
+ * per-channel ring. The master's audio thread pulls exactly one master
+ * period at a time through a variable-ratio 4-point Hermite resampler. A PI
+ * controller on the (low-passed) ring fill steers the ratio, so the fill
+ * settles on its target and the resampling ratio converges on the true
+ * clock ratio between the two devices.
+ *
+ * Drift is reported two ways: measured from frame counts (slave frames
+ * received against master frames consumed since lock) and as the
+ * controller's current correction. Both are in parts per million.
+ */
+
+#ifndef DRIFT_COMPENSATOR_H
+#define DRIFT_COMPENSATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "fractional_resampler.h"
+#include "spsc_ring.h"
+
+class DriftCompensator {
+public:
+    DriftCompensator();
+
+    // Not thread safe: call while neither device is running. maxPullFrames
+    // bounds a single Pull; pushFrames is the secondary device's period.
+    void Reset(int channels, double masterRate, double slaveRate, size_t maxPullFrames, size_t pushFrames);
+
+    int Channels() const { return channels_; }
+
+    // Secondary device thread: append captured frames (interleaved, or one
+    // pointer per channel when planar). Frames that do not fit are dropped.
+    // now is MonotonicNanos() (any clock shared with Pull).
+    void Push(const void* input, size_t frames, bool planar, uint64_t now);
+    // Secondary device thread: count an overflow its driver reported
+    void CountOverflow() { overflows_.fetch_add(1, std::memory_order_relaxed); }
+
+    // Master device thread: produce exactly frames frames per channel.
+    // Outputs silence until the ring first reaches its target fill, and
+    // for any period the ring cannot cover.
+    void Pull(float* const* out, size_t frames, uint64_t now);
+
+    // Any thread
+    bool Locked() const { return primed_.load(std::memory_order_relaxed); }
+    double MeasuredDriftPpm() const;
+    double CorrectionPpm() const { return correctionPpm_.load(std::memory_order_relaxed); }
+    size_t Fill() const { return ring_.ReadAvailable(); }
+    size_t TargetFill() const { return target_; }
+    uint64_t Underruns() const { return underruns_.load(std::memory_order_relaxed); }
+    uint64_t Overflows() const { return overflows_.load(std::memory_order_relaxed); }
+
+private:
+    double SmoothFill(uint64_t now, size_t* fill) const;
+
+    int channels_;
+    double nominal_;            // Slave frames per master frame at nominal rates
+    double masterRate_;
+    size_t target_;             // Ring fill the controller steers towards
+    size_t pushFrames_;
+
+    SpscRing<float> ring_;      // One lane per channel
+    std::vector<float*> pushPtrs_;
+
+    // Master thread state
+    FractionalResampler resampler_;
+    double ratio_;
+    double filteredFill_;
+    double integral_;
+    uint64_t masterFrames_;     // Consumed since lock
+
+    std::atomic<bool> primed_;
+    std::atomic<uint64_t> slaveFrames_;     // Every frame the slave delivered
+    std::atomic<uint64_t> slaveBase_;       // slaveFrames_ when the lock began
+    std::atomic<uint64_t> lastPush_;        // Time of the latest push
+    std::atomic<uint64_t> masterCount_;     // Mirror of masterFrames_ for readers
+    std::atomic<double> correctionPpm_;
+    std::atomic<uint64_t> underruns_;
+    std::atomic<uint64_t> overflows_;
+};
+
+#endif // DRIFT_COMPENSATOR_H
@@ -0,0 +1,100 @@
+/**
+ * FractionalResampler implementation
+ */
+
+#include "fractional_resampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+inline float Hermite(float xm1, float x0, float x1, float x2, float t) {
+    float c1 = 0.5f * (x1 - xm1);
+    float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+    float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+    return ((c3 * t + c2) * t + c1) * t + x0;
+}
+
+} // namespace
+
+FractionalResampler::FractionalResampler()
+    : channels_(0),
+      position_(1.0),
+      carried_(kHistory) {}
+
+void FractionalResampler::Reset(int channels, size_t maxFrames, double maxRatio) {
+    channels_ = channels;
+    // Carried samples, the largest call at the largest ratio, and the
+    // interpolation taps
+    size_t workFrames = kHistory + 1 + static_cast<size_t>(std::ceil(maxFrames * maxRatio)) + 4;
+    work_.assign(channels, std::vector<float>(workFrames, 0.0f));
+    inputPtrs_.resize(channels);
+    Clear();
+}
+
+void FractionalResampler::Clear() {
+    for (std::vector<float>& work : work_) {
+        std::fill(work.begin(), work.begin() + kHistory, 0.0f);
+    }
+    position_ = 1.0;
+    carried_ = kHistory;
+}
+
+size_t FractionalResampler::InputNeeded(size_t frames, double ratio) const {
+    if (frames == 0) {
+        return 0;
+    }
+    // The last output frame reads up to floor(t) + 2, and the next call's
+    // history starts at floor(end) - 1
+    double end = position_ + frames * ratio;
+    size_t lastIndex = static_cast<size_t>(position_ + (frames - 1) * ratio);
+    size_t length = std::max(lastIndex + 3, static_cast<size_t>(end) + 2);
+    return length - carried_;
+}
+
+size_t FractionalResampler::FramesFor(size_t available, double ratio) const {
+    // Estimate from the read span, then step back until it fits
+    double span = static_cast<double>(carried_ + available) - 3.0 - position_;
+    if (span < 0) {
+        return 0;
+    }
+    size_t frames = static_cast<size_t>(span / ratio) + 1;
+    while (frames > 0 && InputNeeded(frames, ratio) > available) {
+        frames--;
+    }
+    return frames;
+}
+
+float* const* FractionalResampler::InputPlanes() {
+    for (int ch = 0; ch < channels_; ch++) {
+        inputPtrs_[ch] = work_[ch].data() + carried_;
+    }
+    return inputPtrs_.data();
+}
+
+void FractionalResampler::Process(float* const* out, size_t frames, double ratio) {
+    if (frames == 0) {
+        return;
+    }
+    double end = position_ + frames * ratio;
+    size_t length = carried_ + InputNeeded(frames, ratio);
+
+    // Everything from one sample before the new position on is unconsumed
+    size_t keep = static_cast<size_t>(end) - 1;
+    size_t carry = length - keep;
+    for (int ch = 0; ch < channels_; ch++) {
+        const float* x = work_[ch].data();
+        float* y = out[ch];
+        double t = position_;
+        for (size_t i = 0; i < frames; i++) {
+            size_t index = static_cast<size_t>(t);
+            float frac = static_cast<float>(t - index);
+            y[i] = Hermite(x[index - 1], x[index], x[index + 1], x[index + 2], frac);
+            t += ratio;
+        }
+        std::memmove(work_[ch].data(), x + keep, carry * sizeof(float));
+    }
+    position_ = end - static_cast<double>(keep);
+    carried_ = carry;
+}
@@ -0,0 +1,52 @@
+/**
+ * FractionalResampler - variable-ratio 4-point Hermite interpolation
+ *
+ * Produces exactly the requested number of output frames per call while the
+ * ratio (input frames per output frame) may change from call to call. Meant
+ * for ratios within a fraction of a percent of a nominal value, as used to
+ * steer buffer fill against a clock that drifts: cheap, with no filter
+ * state beyond a few samples carried between calls.
+ *
+ * The caller asks how much input a call needs, writes that many frames into
+ * InputPlanes(), then calls Process. Realtime safe after Reset.
+ */
+
+#ifndef FRACTIONAL_RESAMPLER_H
+#define FRACTIONAL_RESAMPLER_H
+
+#include <cstddef>
+#include <vector>
+
+class FractionalResampler {
+public:
+    FractionalResampler();
+
+    // Not realtime safe: size for calls of up to maxFrames output frames
+    // at ratios up to maxRatio, and clear the carried history
+    void Reset(int channels, size_t maxFrames, double maxRatio);
+    // Realtime safe: forget the carried history, as after a gap in the input
+    void Clear();
+
+    // Input frames Process(frames, ratio) will consume
+    size_t InputNeeded(size_t frames, double ratio) const;
+    // Most output frames the given input frames can produce at ratio
+    size_t FramesFor(size_t available, double ratio) const;
+
+    // Destination for the next call's input, one pointer per channel
+    float* const* InputPlanes();
+
+    // Consume InputNeeded(frames, ratio) frames from InputPlanes() and write
+    // frames frames per channel to out
+    void Process(float* const* out, size_t frames, double ratio);
+
+private:
+    static const size_t kHistory = 3;   // Minimum samples carried between calls
+
+    int channels_;
+    std::vector<std::vector<float>> work_;  // Per channel: carried + new input
+    std::vector<float*> inputPtrs_;
+    double position_;           // Read position in work_, in [1, 2) between calls
+    size_t carried_;            // Unconsumed samples at the start of work_
+};
+
+#endif // FRACTIONAL_RESAMPLER_H
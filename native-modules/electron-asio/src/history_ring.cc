@@ -0,0 +1,79 @@
+/**
+ * HistoryRing implementation
+ */
+
+#include "history_ring.h"
+#include "deinterleave.h"
+#include <algorithm>
+#include <cstring>
+
+HistoryRing::HistoryRing()
+    : channels_(0),
+      capacity_(0),
+      claimed_(0),
+      written_(0) {}
+
+void HistoryRing::Reset(int channels, size_t frames) {
+    channels_ = channels;
+    capacity_ = frames;
+    buffer_.assign(static_cast<size_t>(channels) * frames, 0.0f);
+    lanes_.resize(channels);
+    claimed_ = 0;
+    written_ = 0;
+}
+
+void HistoryRing::Write(const void* input, size_t frames, bool planar) {
+    if (capacity_ == 0) {
+        return;
+    }
+    // A period longer than the ring keeps only its newest frames
+    size_t skip = frames > capacity_ ? frames - capacity_ : 0;
+    uint64_t w = written_.load(std::memory_order_relaxed) + skip;
+    frames -= skip;
+
+    // Claim the frames before overwriting them: a reader that sees the old
+    // data also sees the claim once it has fenced
+    claimed_.store(w + frames, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    size_t offset = static_cast<size_t>(w % capacity_);
+    size_t a = std::min(frames, capacity_ - offset);
+    if (planar) {
+        const float* const* in = static_cast<const float* const*>(input);
+        for (int ch = 0; ch < channels_; ch++) {
+            float* lane = buffer_.data() + ch * capacity_;
+            std::memcpy(lane + offset, in[ch] + skip, a * sizeof(float));
+            std::memcpy(lane, in[ch] + skip + a, (frames - a) * sizeof(float));
+        }
+    } else {
+        const float* in = static_cast<const float*>(input) + skip * channels_;
+        for (int ch = 0; ch < channels_; ch++) {
+            lanes_[ch] = buffer_.data() + ch * capacity_ + offset;
+        }
+        kernels::Deinterleave(in, lanes_.data(), a, channels_);
+        if (frames > a) {
+            for (int ch = 0; ch < channels_; ch++) {
+                lanes_[ch] = buffer_.data() + ch * capacity_;
+            }
+            kernels::Deinterleave(in + a * channels_, lanes_.data(), frames - a, channels_);
+        }
+    }
+    written_.store(w + frames, std::memory_order_release);
+}
+
+bool HistoryRing::Read(uint64_t start, size_t frames, float* const* dst) const {
+    uint64_t end = start + frames;
+    if (frames > capacity_ || end > Written() || Written() > start + capacity_) {
+        return false;
+    }
+    size_t offset = static_cast<size_t>(start % capacity_);
+    size_t a = std::min(frames, capacity_ - offset);
+    for (int ch = 0; ch < channels_; ch++) {
+        const float* lane = Lane(ch);
+        std::memcpy(dst[ch], lane + offset, a * sizeof(float));
+        std::memcpy(dst[ch] + a, lane, (frames - a) * sizeof(float));
+    }
+    // Valid only if the writer had not claimed the oldest copied frame's slot
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return claimed_.load(std::memory_order_relaxed) <= start + capacity_;
+}
@@ -0,0 +1,55 @@
+/**
+ * HistoryRing - retrospective capture of the last N seconds of input
+ *
+ * A preallocated circular buffer, one lane per channel, that the audio
+ * thread overwrites continuously: writing never blocks, allocates or
+ * fails, and the oldest audio simply falls off. Any other thread can copy
+ * a window out while capture continues. The writer announces which frames
+ * it is about to overwrite before touching them (seqlock style), so a
+ * reader can tell afterwards whether any frame it copied was overwritten
+ * mid-copy.
+ */
+
+#ifndef HISTORY_RING_H
+#define HISTORY_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class HistoryRing {
+public:
+    HistoryRing();
+
+    // Not thread safe: allocate room for frames per channel
+    void Reset(int channels, size_t frames);
+
+    // Audio thread: append one period of interleaved or planar input
+    void Write(const void* input, size_t frames, bool planar);
+
+    // Any thread
+    int Channels() const { return channels_; }
+    size_t Capacity() const { return capacity_; }
+    size_t Bytes() const { return buffer_.size() * sizeof(float); }
+    // Frames written since Reset; frame indices below are in this count
+    uint64_t Written() const { return written_.load(std::memory_order_acquire); }
+
+    // Any thread: copy frames starting at frame index start into one array
+    // per channel. Returns false if any of them had already been, or was
+    // meanwhile, overwritten.
+    bool Read(uint64_t start, size_t frames, float* const* dst) const;
+
+private:
+    const float* Lane(int channel) const { return buffer_.data() + channel * capacity_; }
+
+    int channels_;
+    size_t capacity_;
+    std::vector<float> buffer_;
+    std::vector<float*> lanes_;     // Audio thread scratch
+
+    std::atomic<uint64_t> claimed_;     // Frames the writer has started on
+    std::atomic<uint64_t> written_;     // Frames complete and readable
+};
+
+#endif // HISTORY_RING_H
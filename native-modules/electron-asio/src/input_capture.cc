@@ -0,0 +1,241 @@
+/**
+ * InputCapture implementation
+ */
+
+#include "input_capture.h"
+#include "deinterleave.h"
+#include "latency_histogram.h"
+#include <cstring>
+#include <thread>
+
+InputCapture::InputCapture()
+    : pool_(std::make_shared<BlockPool>()),
+      consumers_(new Consumer[kMaxSubscribers]),
+      subscribers_(0),
+      reserved_(0),
+      fillBlock_(nullptr),
+      inputSequence_(0),
+      primary_(true),
+      queueing_(false),
+      poolExhausted_(0),
+      oversizedPeriods_(0) {}
+
+void InputCapture::Reset(const InputCaptureConfig& config) {
+    config_ = config;
+    pool_->Reset(config_.poolBlocks, config_.blockFrames * config_.channels);
+    for (int i = 1; i < kMaxSubscribers; i++) {
+        consumers_[i].active = false;
+    }
+    subscribers_ = 0;
+    Consumer& primary = consumers_[0];
+    primary.queue.Reset(config_.queueDepth);
+    primary.policy = config_.policy;
+    primary.nextSequence = 0;
+    primary.active = true;
+    // Every queued block plus the one being filled and the one being delivered
+    reserved_ = config_.queueDepth + 2;
+    channelPtrs_.resize(config_.channels);
+    fillBlock_ = nullptr;
+    inputSequence_ = 0;
+}
+
+uint64_t InputCapture::Append(const void* input, size_t frames, bool primary) {
+    primary_ = primary;
+    uint64_t enqueue = 0;
+    int channels = config_.channels;
+
+    // A period no block can hold is a sizing problem, not pool pressure
+    if (frames > config_.blockFrames) {
+        oversizedPeriods_++;
+        return enqueue;
+    }
+
+    // Ship the partial block first if this period would not fit in it
+    AudioBlock* block = fillBlock_;
+    if (block && block->frames + frames > config_.blockFrames) {
+        fillBlock_ = nullptr;
+        uint64_t begin = MonotonicNanos();
+        Queue(block);
+        enqueue += MonotonicNanos() - begin;
+        block = nullptr;
+    }
+
+    // Start a new pooled block; no heap traffic on this thread
+    if (!block) {
+        block = pool_->Acquire();
+        if (!block) {
+            poolExhausted_++;
+            return enqueue;
+        }
+        block->frames = 0;
+        block->stride = config_.blockFrames;
+        block->channels = channels;
+        block->planar = config_.planarInput || config_.planarBlocks;
+        block->sequence = inputSequence_++;
+        block->captureTime = MonotonicMicros();
+        fillBlock_ = block;
+    }
+
+    size_t at = block->frames;
+    if (config_.planarInput) {
+        // The driver's channel buffers map one-to-one onto the block
+        const float* const* in = static_cast<const float* const*>(input);
+        for (int ch = 0; ch < channels; ch++) {
+            std::memcpy(block->data + ch * block->stride + at, in[ch], frames * sizeof(float));
+        }
+    } else if (config_.planarBlocks) {
+        // Store planar so each channel can be handed to JS as a view
+        const float* in = static_cast<const float*>(input);
+        for (int ch = 0; ch < channels; ch++) {
+            channelPtrs_[ch] = block->data + ch * block->stride + at;
+        }
+        kernels::Deinterleave(in, channelPtrs_.data(), frames, channels);
+    } else {
+        const float* in = static_cast<const float*>(input);
+        std::memcpy(block->data + at * channels, in, frames * channels * sizeof(float));
+    }
+    block->frames += frames;
+
+    if (block->frames >= config_.framesPerDelivery) {
+        fillBlock_ = nullptr;
+        uint64_t begin = MonotonicNanos();
+        Queue(block);
+        enqueue += MonotonicNanos() - begin;
+    }
+    return enqueue;
+}
+
+void InputCapture::Flush(bool deliver) {
+    if (!fillBlock_) {
+        return;
+    }
+    AudioBlock* block = fillBlock_;
+    fillBlock_ = nullptr;
+    if (deliver) {
+        Queue(block);
+    } else {
+        pool_->Release(block);
+    }
+}
+
+void InputCapture::Queue(AudioBlock* block) {
+    // Announce the fan-out before looking at the active flags, so an
+    // Unsubscribe that cleared one either is seen here or waits for us
+    queueing_.store(true);
+    Consumer* targets[kMaxSubscribers];
+    int count = 0;
+    if (primary_) {
+        targets[count++] = &consumers_[0];
+    }
+    if (subscribers_.load(std::memory_order_relaxed) > 0) {
+        for (int i = 1; i < kMaxSubscribers; i++) {
+            if (consumers_[i].active.load()) {
+                targets[count++] = &consumers_[i];
+            }
+        }
+    }
+
+    // One reference per queue; the block is copied into none of them
+    if (count == 0) {
+        pool_->Release(block);
+    } else if (count > 1) {
+        pool_->Retain(block, count - 1);
+    }
+    for (int i = 0; i < count; i++) {
+        Push(*targets[i], block);
+    }
+    queueing_.store(false, std::memory_order_release);
+}
+
+void InputCapture::Push(Consumer& consumer, AudioBlock* block) {
+    AudioBlock* evicted = nullptr;
+    bool evictOldest = consumer.policy != BackpressurePolicy::DropNewest;
+    if (!consumer.queue.Push(block, evictOldest, &evicted)) {
+        pool_->Release(block);
+        consumer.droppedBlocks++;
+    }
+    if (evicted) {
+        pool_->Release(evicted);
+        consumer.droppedBlocks++;
+    }
+
+    size_t depth = consumer.queue.Size();
+    if (depth > consumer.peakQueueDepth.load(std::memory_order_relaxed)) {
+        consumer.peakQueueDepth.store(depth, std::memory_order_relaxed);
+    }
+
+    if (consumer.wake) {
+        consumer.wake(consumer.wakeContext);
+    }
+}
+
+AudioBlock* InputCapture::Next(int id) {
+    Consumer& consumer = consumers_[id];
+    for (;;) {
+        AudioBlock* block = consumer.queue.Pop();
+        if (!block) {
+            return nullptr;
+        }
+        // A block older than one already delivered was lapped while queued
+        if (block->sequence < consumer.nextSequence) {
+            pool_->Release(block);
+            consumer.droppedBlocks++;
+            continue;
+        }
+        consumer.nextSequence = block->sequence + 1;
+        return block;
+    }
+}
+
+void InputCapture::Discard(int id) {
+    while (AudioBlock* block = consumers_[id].queue.Pop()) {
+        pool_->Release(block);
+    }
+}
+
+int InputCapture::Subscribe(size_t queueDepth, BackpressurePolicy policy, WakeFn wake, void* context) {
+    // The pool must cover this queue on top of the others, or a stalled
+    // subscriber could starve the rest by holding every block
+    queueDepth = queueDepth > 0 ? queueDepth : 1;
+    if (reserved_ + queueDepth > config_.poolBlocks) {
+        return -1;
+    }
+    for (int i = 1; i < kMaxSubscribers; i++) {
+        Consumer& consumer = consumers_[i];
+        if (consumer.active.load()) {
+            continue;
+        }
+        consumer.queue.Reset(queueDepth);
+        consumer.policy = policy;
+        consumer.wake = wake;
+        consumer.wakeContext = context;
+        consumer.nextSequence = 0;
+        consumer.droppedBlocks = 0;
+        consumer.peakQueueDepth = 0;
+        consumer.active.store(true);
+        subscribers_.fetch_add(1, std::memory_order_relaxed);
+        reserved_ += queueDepth;
+        return i;
+    }
+    return -1;
+}
+
+void InputCapture::Unsubscribe(int id) {
+    if (id <= 0 || id >= kMaxSubscribers || !consumers_[id].active.load()) {
+        return;
+    }
+    Consumer& consumer = consumers_[id];
+    consumer.active.store(false);
+    while (queueing_.load()) {
+        std::this_thread::yield();
+    }
+    subscribers_.fetch_sub(1, std::memory_order_relaxed);
+    reserved_ -= consumer.queue.Depth();
+    Discard(id);
+}
+
+void InputCapture::ResetPeakQueueDepth() {
+    for (int i = 0; i < kMaxSubscribers; i++) {
+        consumers_[i].peakQueueDepth.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,134 @@
+/**
+ * InputCapture - realtime side of input delivery, free of N-API
+ *
+ * Owns the block pool and the delivery queue. The audio thread appends each
+ * period to the block being filled and queues it once it holds a delivery's
+ * worth of frames; the consumer pops blocks in capture order and hands them
+ * back to the pool. Waking the consumer is a plain function hook, so the
+ * same code runs under a thread-safe function in the addon and standalone
+ * in benchmarks.
+ *
+ * Besides the primary consumer, up to kMaxSubscribers - 1 further consumers
+ * can subscribe to the same capture. Each has its own delivery queue, read
+ * cursor and backpressure policy, and every queued block is shared between
+ * them by reference count, so a period is copied once however many consumers
+ * read it, and a slow consumer only ever loses its own blocks.
+ */
+
+#ifndef INPUT_CAPTURE_H
+#define INPUT_CAPTURE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "block_pool.h"
+#include "delivery_queue.h"
+
+struct InputCaptureConfig {
+    int channels = 0;
+    size_t blockFrames = 0;         // Frames each pooled block can hold
+    size_t framesPerDelivery = 0;   // 0 = one delivery per period
+    size_t poolBlocks = 32;
+    size_t queueDepth = 16;
+    BackpressurePolicy policy = BackpressurePolicy::DropOldest;
+    bool planarInput = false;       // Device buffers are per-channel pointers
+    bool planarBlocks = false;      // Store blocks channel-major
+};
+
+class InputCapture {
+public:
+    typedef void (*WakeFn)(void* context);
+
+    // Primary consumer plus subscribers
+    static const int kMaxSubscribers = 8;
+
+    InputCapture();
+
+    // Not thread safe: call while no block is outstanding
+    void Reset(const InputCaptureConfig& config);
+
+    // Called after a block is queued for the primary consumer; must be
+    // realtime safe
+    void SetWake(WakeFn wake, void* context) {
+        consumers_[0].wake = wake;
+        consumers_[0].wakeContext = context;
+    }
+
+    // Audio thread: append one period. Returns the nanoseconds spent
+    // queueing finished blocks. primary says whether blocks finished now go
+    // to the primary consumer as well as to the subscribers.
+    uint64_t Append(const void* input, size_t frames, bool primary = true);
+
+    // Audio thread, or any thread once the audio thread has stopped: queue
+    // the partial block (deliver) or return it to the pool
+    void Flush(bool deliver);
+
+    // Consumer: next block in capture order, skipping any lapped while queued
+    AudioBlock* Next(int consumer = 0);
+    void Release(AudioBlock* block) { pool_->Release(block); }
+    // Consumer: return everything still queued to the pool
+    void Discard(int consumer = 0);
+
+    // Consumer thread: add a subscriber with its own queue of queueDepth
+    // blocks. Returns its id, or -1 when every slot is taken or the pool
+    // cannot back another queue that deep.
+    int Subscribe(size_t queueDepth, BackpressurePolicy policy, WakeFn wake, void* context);
+    // Consumer thread: stop queueing to a subscriber, wait out an Append in
+    // progress and return its queued blocks to the pool
+    void Unsubscribe(int id);
+    int Subscribers() const { return subscribers_.load(std::memory_order_relaxed); }
+    // Pool blocks not yet promised to a queue
+    size_t UnreservedBlocks() const { return config_.poolBlocks - reserved_; }
+
+    const InputCaptureConfig& Config() const { return config_; }
+    const std::shared_ptr<BlockPool>& Pool() const { return pool_; }
+    BackpressurePolicy Policy(int consumer = 0) const { return consumers_[consumer].policy; }
+    size_t QueueSize(int consumer = 0) const { return consumers_[consumer].queue.Size(); }
+    size_t QueueDepth(int consumer = 0) const { return consumers_[consumer].queue.Depth(); }
+
+    uint64_t PoolExhausted() const { return poolExhausted_.load(std::memory_order_relaxed); }
+    uint64_t OversizedPeriods() const { return oversizedPeriods_.load(std::memory_order_relaxed); }
+    uint64_t DroppedBlocks(int consumer = 0) const {
+        return consumers_[consumer].droppedBlocks.load(std::memory_order_relaxed);
+    }
+    size_t PeakQueueDepth(int consumer = 0) const {
+        return consumers_[consumer].peakQueueDepth.load(std::memory_order_relaxed);
+    }
+    void ResetPeakQueueDepth();
+
+private:
+    struct Consumer {
+        DeliveryQueue queue;
+        BackpressurePolicy policy = BackpressurePolicy::DropOldest;
+        WakeFn wake = nullptr;
+        void* wakeContext = nullptr;
+        uint64_t nextSequence = 0;      // Consumer thread only
+        std::atomic<bool> active{false};
+        std::atomic<uint64_t> droppedBlocks{0};
+        std::atomic<size_t> peakQueueDepth{0};
+    };
+
+    void Queue(AudioBlock* block);
+    void Push(Consumer& consumer, AudioBlock* block);
+
+    InputCaptureConfig config_;
+
+    // Shared so zero-copy views can outlive the stream
+    std::shared_ptr<BlockPool> pool_;
+    std::unique_ptr<Consumer[]> consumers_;     // [0] is the primary consumer
+    std::atomic<int> subscribers_;
+    size_t reserved_;               // Consumer thread: blocks promised to queues
+
+    AudioBlock* fillBlock_;         // Audio thread: block being accumulated
+    uint64_t inputSequence_;        // Audio thread only
+    bool primary_;                  // Audio thread: primary takes the next block
+    std::atomic<bool> queueing_;    // Audio thread is inside Queue
+    std::vector<float*> channelPtrs_;   // Audio thread scratch for deinterleaving
+
+    std::atomic<uint64_t> poolExhausted_;
+    std::atomic<uint64_t> oversizedPeriods_;   // Periods longer than a whole block
+};
+
+#endif // INPUT_CAPTURE_H
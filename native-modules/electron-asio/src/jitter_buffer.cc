@@ -0,0 +1,326 @@
+/**
+ * JitterBuffer implementation
+ */
+
+#include "jitter_buffer.h"
+#include "deinterleave.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const double kHistoryMs = 10.0;     // Audio repeated while concealing
+const double kFadeMs = 3.0;         // Crossfade back into returning audio
+const double kConcealMs = 30.0;     // Concealment fades to silence over this
+
+// Producer lateness: the lower envelope may creep up this fast (seconds per
+// second) so a producer clock slower than the device is not read as jitter;
+// the peak holds, then relaxes with the decay time constant, so stalls that
+// recur every few seconds keep the reserve; a gap this long starts afresh
+const double kBaseCreep = 0.002;
+const double kPeakHoldSeconds = 30.0;
+const double kPeakDecaySeconds = 10.0;
+const double kIdleSeconds = 1.0;
+const double kLatenessMargin = 1.25;
+
+// Playout rate steering on the lowest fill seen per window
+const double kWindowSeconds = 0.5;
+const double kSteerGain = 0.1;          // Correction per second of surplus
+const double kMaxCorrection = 2000e-6;
+const double kAverageSeconds = 1.0;
+
+} // namespace
+
+JitterBuffer::JitterBuffer()
+    : minTarget_(0),
+      maxTarget_(0),
+      anchored_(false),
+      base_(0),
+      peakLateness_(0),
+      peakTime_(0),
+      lastWrite_(0),
+      written_(0),
+      historyFrames_(0),
+      historyWrite_(0),
+      historyFill_(0),
+      fadeFrames_(0),
+      concealFrames_(0),
+      concealing_(false),
+      concealPos_(0),
+      concealGain_(0),
+      ratio_(1.0),
+      windowFrames_(0),
+      windowLow_(0),
+      buffering_(true),
+      targetFrames_(0),
+      averageFill_(0),
+      producerJitter_(0),
+      correctionPpm_(0),
+      concealments_(0),
+      concealedFrames_(0),
+      partialPeriods_(0),
+      rebuffers_(0) {}
+
+void JitterBuffer::Reset(const JitterBufferConfig& config) {
+    config_ = config;
+    double framesPerMs = config_.sampleRate / 1000.0;
+    minTarget_ = config_.minMs > 0 ? static_cast<size_t>(config_.minMs * framesPerMs) : 2 * config_.maxFrames;
+    maxTarget_ = std::max(minTarget_, static_cast<size_t>(config_.maxMs * framesPerMs));
+    size_t initial = config_.initialMs > 0 ? static_cast<size_t>(config_.initialMs * framesPerMs) : minTarget_;
+    targetFrames_ = std::max(minTarget_, std::min(maxTarget_, initial));
+
+    int channels = config_.channels;
+    resampler_.Reset(channels, config_.maxFrames, 1.0 + kMaxCorrection);
+    size_t maxInput = static_cast<size_t>(std::ceil(config_.maxFrames * (1.0 + kMaxCorrection))) + 8;
+    interleaved_.assign(config_.planar ? 0 : maxInput * channels, 0.0f);
+    out_.assign(channels, std::vector<float>(config_.maxFrames, 0.0f));
+    outPtrs_.resize(channels);
+    for (int ch = 0; ch < channels; ch++) {
+        outPtrs_[ch] = out_[ch].data();
+    }
+    historyFrames_ = std::max<size_t>(1, static_cast<size_t>(kHistoryMs * framesPerMs));
+    history_.assign(channels, std::vector<float>(historyFrames_, 0.0f));
+    fadeFrames_ = std::max<size_t>(1, static_cast<size_t>(kFadeMs * framesPerMs));
+    concealFrames_ = std::max<size_t>(1, static_cast<size_t>(kConcealMs * framesPerMs));
+
+    averageFill_ = 0;
+    producerJitter_ = 0;
+    concealments_ = 0;
+    concealedFrames_ = 0;
+    partialPeriods_ = 0;
+    rebuffers_ = 0;
+    Restart();
+}
+
+void JitterBuffer::Restart() {
+    anchored_ = false;
+    peakLateness_ = 0;
+    peakTime_ = 0;
+    resampler_.Clear();
+    historyWrite_ = 0;
+    historyFill_ = 0;
+    // As if a concealment had just faded out, so playback fades in
+    concealing_ = true;
+    concealPos_ = 0;
+    concealGain_ = 0;
+    ratio_ = 1.0;
+    windowFrames_ = 0;
+    windowLow_ = SIZE_MAX;
+    correctionPpm_ = 0;
+    buffering_ = true;
+}
+
+void JitterBuffer::NoteWrite(size_t frames, uint64_t now) {
+    double t = now * 1e-9;
+
+    // Arrival offset: when this write arrived against when its audio falls
+    // due if the producer ran exactly at the device rate
+    double offset = t - static_cast<double>(written_) / config_.sampleRate;
+    if (!anchored_ || t - lastWrite_ > kIdleSeconds) {
+        anchored_ = true;
+        written_ = 0;
+        offset = t;
+        base_ = t;
+    }
+
+    // Lateness against the lower envelope: how much later than its best
+    // this write arrived, which is what the reserve has to cover
+    base_ = std::min(base_ + (t - lastWrite_) * kBaseCreep, offset);
+    double lateness = offset - base_;
+    if (lateness >= peakLateness_) {
+        peakLateness_ = lateness;
+        peakTime_ = t;
+    } else if (t - peakTime_ > kPeakHoldSeconds) {
+        peakLateness_ = std::max(lateness, peakLateness_ * std::exp(-(t - lastWrite_) / kPeakDecaySeconds));
+    }
+    lastWrite_ = t;
+    written_ += frames;
+
+    size_t target = static_cast<size_t>(peakLateness_ * kLatenessMargin * config_.sampleRate) + config_.maxFrames;
+    targetFrames_.store(std::max(minTarget_, std::min(maxTarget_, target)), std::memory_order_relaxed);
+    producerJitter_.store(peakLateness_ * 1000.0, std::memory_order_relaxed);
+}
+
+size_t JitterBuffer::FillFrames(const SpscRing<float>& ring) const {
+    size_t available = ring.ReadAvailable();
+    return config_.planar ? available : available / config_.channels;
+}
+
+void JitterBuffer::ReadInput(SpscRing<float>& ring, size_t frames) {
+    float* const* planes = resampler_.InputPlanes();
+    if (config_.planar) {
+        ring.ReadLanes(planes, frames);
+        return;
+    }
+    // A frame may straddle the ring's wrap point, so copy out first
+    ring.Read(interleaved_.data(), frames * config_.channels);
+    kernels::Deinterleave(interleaved_.data(), planes, frames, config_.channels);
+}
+
+void JitterBuffer::Remember(size_t from, size_t frames) {
+    // Keep the most recent played audio as the concealment source
+    for (int ch = 0; ch < config_.channels; ch++) {
+        const float* src = out_[ch].data() + from;
+        float* hist = history_[ch].data();
+        size_t pos = historyWrite_;
+        for (size_t i = 0; i < frames; i++) {
+            hist[pos] = src[i];
+            if (++pos == historyFrames_) pos = 0;
+        }
+    }
+    historyWrite_ = (historyWrite_ + frames) % historyFrames_;
+    historyFill_ = std::min(historyFrames_, historyFill_ + frames);
+}
+
+float JitterBuffer::Concealed(int channel, size_t n) const {
+    // Ping-pong over the history: backwards from the newest sample, then
+    // forwards again, so every turn is continuous with what preceded it
+    size_t len = historyFill_;
+    if (len < 2) {
+        return 0.0f;
+    }
+    size_t q = n % (2 * len - 2);
+    size_t index = q < len - 1 ? len - 2 - q : q - (len - 2);
+    size_t oldest = (historyWrite_ + historyFrames_ - len) % historyFrames_;
+    return history_[channel][(oldest + index) % historyFrames_];
+}
+
+void JitterBuffer::Conceal(size_t from, size_t frames) {
+    if (frames == 0) {
+        return;
+    }
+    if (!concealing_) {
+        concealing_ = true;
+        concealPos_ = 0;
+        concealGain_ = 1.0f;
+        concealments_.fetch_add(1, std::memory_order_relaxed);
+    }
+    concealedFrames_.fetch_add(frames, std::memory_order_relaxed);
+
+    float step = 1.0f / static_cast<float>(concealFrames_);
+    for (int ch = 0; ch < config_.channels; ch++) {
+        float* dst = out_[ch].data() + from;
+        float gain = concealGain_;
+        for (size_t i = 0; i < frames; i++) {
+            dst[i] = Concealed(ch, concealPos_ + i) * gain;
+            gain = std::max(0.0f, gain - step);
+        }
+    }
+    concealPos_ += frames;
+    concealGain_ = std::max(0.0f, concealGain_ - step * static_cast<float>(frames));
+}
+
+void JitterBuffer::Resume(size_t frames) {
+    // Crossfade from the concealment, carried on where it left off, into
+    // the returning audio
+    size_t fade = std::min(frames, fadeFrames_);
+    float step = 1.0f / static_cast<float>(concealFrames_);
+    for (int ch = 0; ch < config_.channels; ch++) {
+        float* dst = out_[ch].data();
+        float gain = concealGain_;
+        for (size_t i = 0; i < fade; i++) {
+            float w = static_cast<float>(i + 1) / static_cast<float>(fade + 1);
+            dst[i] = w * dst[i] + (1.0f - w) * Concealed(ch, concealPos_ + i) * gain;
+            gain = std::max(0.0f, gain - step);
+        }
+    }
+    concealing_ = false;
+}
+
+void JitterBuffer::Steer(size_t fill, size_t frames) {
+    // Track the low point of each window: that is the reserve actually held
+    size_t low = fill > frames ? fill - frames : 0;
+    windowLow_ = std::min(windowLow_, low);
+    windowFrames_ += frames;
+
+    double alpha = std::min(1.0, frames / (kAverageSeconds * config_.sampleRate));
+    double average = averageFill_.load(std::memory_order_relaxed);
+    averageFill_.store(average + alpha * (static_cast<double>(fill) - average), std::memory_order_relaxed);
+
+    if (windowFrames_ < kWindowSeconds * config_.sampleRate) {
+        return;
+    }
+    // Play slightly fast while holding more than the target, slightly slow
+    // while holding less
+    double surplus = (static_cast<double>(windowLow_) - static_cast<double>(TargetFrames())) / config_.sampleRate;
+    double correction = std::max(-kMaxCorrection, std::min(kMaxCorrection, kSteerGain * surplus));
+    ratio_ = 1.0 + correction;
+    correctionPpm_.store(correction * 1e6, std::memory_order_relaxed);
+    windowFrames_ = 0;
+    windowLow_ = SIZE_MAX;
+}
+
+size_t JitterBuffer::Play(SpscRing<float>& ring, void* output, size_t frames) {
+    int channels = config_.channels;
+    if (frames > config_.maxFrames) {
+        // Larger than any period the stream was opened for
+        if (config_.planar) {
+            float* const* out = static_cast<float* const*>(output);
+            for (int ch = 0; ch < channels; ch++) {
+                std::memset(out[ch], 0, frames * sizeof(float));
+            }
+        } else {
+            std::memset(output, 0, frames * channels * sizeof(float));
+        }
+        return 0;
+    }
+    size_t fill = FillFrames(ring);
+    size_t played = 0;
+
+    if (buffering_.load(std::memory_order_relaxed)) {
+        // Refill to the target before playing; the first period fades in
+        if (fill >= TargetFrames() + frames) {
+            buffering_.store(false, std::memory_order_relaxed);
+            resampler_.Clear();
+        }
+    }
+
+    if (!buffering_.load(std::memory_order_relaxed)) {
+        Steer(fill, frames);
+        size_t need = resampler_.InputNeeded(frames, ratio_);
+        if (need <= fill) {
+            played = frames;
+        } else {
+            // Play what is queued; conceal the remainder
+            played = resampler_.FramesFor(fill, ratio_);
+            need = resampler_.InputNeeded(played, ratio_);
+            if (played > 0) {
+                partialPeriods_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        ReadInput(ring, need);
+        resampler_.Process(outPtrs_.data(), played, ratio_);
+        if (played > 0 && concealing_) {
+            Resume(played);
+        }
+        Remember(0, played);
+        Conceal(played, frames - played);
+
+        // A concealment that faded out completely waits for a full reserve
+        if (concealing_ && concealGain_ <= 0.0f) {
+            buffering_.store(true, std::memory_order_relaxed);
+            rebuffers_.fetch_add(1, std::memory_order_relaxed);
+        }
+    } else {
+        for (int ch = 0; ch < channels; ch++) {
+            std::memset(out_[ch].data(), 0, frames * sizeof(float));
+        }
+    }
+
+    // Out to the device in its layout
+    if (config_.planar) {
+        float* const* out = static_cast<float* const*>(output);
+        for (int ch = 0; ch < channels; ch++) {
+            std::memcpy(out[ch], out_[ch].data(), frames * sizeof(float));
+        }
+    } else {
+        float* out = static_cast<float*>(output);
+        for (size_t i = 0; i < frames; i++) {
+            for (int ch = 0; ch < channels; ch++) {
+                *out++ = out_[ch][i];
+            }
+        }
+    }
+    return played;
+}
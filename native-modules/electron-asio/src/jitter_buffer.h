@@ -0,0 +1,121 @@
+/**
+ * JitterBuffer - adaptive playout of write() output
+ *
+ * Sits between the write ring and the device so a producer with uneven
+ * timing does not turn into dropouts:
+ *
+ *  - The target fill (the low-water mark the buffer keeps in reserve)
+ *    follows the producer's observed lateness, rising at once and relaxing
+ *    slowly.
+ *  - A period that is only partly queued plays what is there.
+ *  - The rest is concealed by replaying the last few milliseconds played
+ *    back and forth, fading out, and crossfading back when data returns.
+ *    If the fade reaches silence, the buffer refills to its target before
+ *    playing.
+ *  - The playout rate is nudged by up to 0.2% through a fractional
+ *    resampler, so the reserve settles on its target however the
+ *    producer's clock drifts against the device's.
+ *
+ * NoteWrite runs on the producer (JS) thread, Play on the audio thread.
+ * Statistics may be read from any thread.
+ */
+
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "fractional_resampler.h"
+#include "spsc_ring.h"
+
+struct JitterBufferConfig {
+    double sampleRate = 48000;
+    int channels = 2;
+    size_t maxFrames = 256;     // Largest device period
+    bool planar = false;        // Ring lanes and device buffers are per channel
+    double minMs = 0;           // Lowest target; 0 = two periods
+    double maxMs = 200;         // Highest target
+    double initialMs = 0;       // Target before any lateness is seen; 0 = minMs
+};
+
+class JitterBuffer {
+public:
+    JitterBuffer();
+
+    // Not thread safe: call while the audio thread is stopped
+    void Reset(const JitterBufferConfig& config);
+    // JS thread, audio thread stopped: refill before playing again
+    void Restart();
+
+    // Producer thread: frames were just queued in the ring at time now (ns)
+    void NoteWrite(size_t frames, uint64_t now);
+
+    // Audio thread: fill one period of device output from the ring,
+    // concealing whatever is missing. Returns frames of queued audio played.
+    size_t Play(SpscRing<float>& ring, void* output, size_t frames);
+
+    // Any thread
+    const JitterBufferConfig& Config() const { return config_; }
+    size_t TargetFrames() const { return targetFrames_.load(std::memory_order_relaxed); }
+    double AverageFill() const { return averageFill_.load(std::memory_order_relaxed); }
+    double ProducerJitter() const { return producerJitter_.load(std::memory_order_relaxed); }
+    double CorrectionPpm() const { return correctionPpm_.load(std::memory_order_relaxed); }
+    uint64_t Concealments() const { return concealments_.load(std::memory_order_relaxed); }
+    uint64_t ConcealedFrames() const { return concealedFrames_.load(std::memory_order_relaxed); }
+    uint64_t PartialPeriods() const { return partialPeriods_.load(std::memory_order_relaxed); }
+    uint64_t Rebuffers() const { return rebuffers_.load(std::memory_order_relaxed); }
+    bool Buffering() const { return buffering_.load(std::memory_order_relaxed); }
+
+private:
+    size_t FillFrames(const SpscRing<float>& ring) const;
+    void ReadInput(SpscRing<float>& ring, size_t frames);
+    void Remember(size_t from, size_t frames);
+    float Concealed(int channel, size_t n) const;
+    void Conceal(size_t from, size_t frames);
+    void Resume(size_t frames);
+    void Steer(size_t fill, size_t frames);
+
+    JitterBufferConfig config_;
+    size_t minTarget_;
+    size_t maxTarget_;
+
+    // Producer thread state
+    bool anchored_;
+    double base_;               // Lower envelope of arrival offset, seconds
+    double peakLateness_;       // Held, then decaying, peak of lateness, seconds
+    double peakTime_;
+    double lastWrite_;
+    uint64_t written_;          // Frames queued since the anchor
+
+    // Audio thread state
+    FractionalResampler resampler_;
+    std::vector<float> interleaved_;    // Ring read scratch (interleaved rings)
+    std::vector<std::vector<float>> out_;   // One period, per channel
+    std::vector<float*> outPtrs_;
+    std::vector<std::vector<float>> history_;   // Last played audio, circular
+    size_t historyFrames_;
+    size_t historyWrite_;
+    size_t historyFill_;
+    size_t fadeFrames_;         // Resume crossfade length
+    size_t concealFrames_;      // Fade-out length of a concealment
+    bool concealing_;
+    size_t concealPos_;         // Frames concealed since the concealment began
+    float concealGain_;
+    double ratio_;
+    size_t windowFrames_;       // Frames played in the current steering window
+    size_t windowLow_;          // Lowest fill seen in it
+
+    std::atomic<bool> buffering_;
+    std::atomic<size_t> targetFrames_;
+    std::atomic<double> averageFill_;
+    std::atomic<double> producerJitter_;
+    std::atomic<double> correctionPpm_;
+    std::atomic<uint64_t> concealments_;
+    std::atomic<uint64_t> concealedFrames_;
+    std::atomic<uint64_t> partialPeriods_;
+    std::atomic<uint64_t> rebuffers_;
+};
+
+#endif // JITTER_BUFFER_H
@@ -0,0 +1,141 @@
+/**
+ * LatencyHistogram - lock-free log-bucketed histogram of durations
+ *
+ * Values are unsigned integers in whatever unit the caller picks
+ * (microseconds for delivery latency, nanoseconds for callback profiling).
+ * Each power of two is split into eight linear sub-buckets, so any value
+ * lands in a bucket at most 12.5% wide; 240 buckets cover 1 to 2^32. Record is a couple of
+ * relaxed atomic adds, so any thread may record while another reads or
+ * resets; a reader racing a writer sees a slightly stale but usable view.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Monotonic timestamps; steady_clock reads are vDSO/QPC backed and safe to
+// take on the audio thread
+inline uint64_t MonotonicNanos() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+inline uint64_t MonotonicMicros() {
+    return MonotonicNanos() / 1000;
+}
+
+class LatencyHistogram {
+public:
+    static const int kSubBits = 3;
+    static const int kSubBuckets = 1 << kSubBits;
+    static const int kBucketCount = 240;
+
+    struct Summary {
+        uint64_t count;
+        double mean;    // All values below are in the recorded unit
+        double p50;
+        double p95;
+        double p99;
+        double max;
+    };
+
+    LatencyHistogram() { Reset(); }
+
+    void Reset() {
+        for (int i = 0; i < kBucketCount; i++) {
+            buckets_[i].store(0, std::memory_order_relaxed);
+        }
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    void Record(uint64_t value) {
+        buckets_[BucketFor(value)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+        uint64_t seen = max_.load(std::memory_order_relaxed);
+        while (value > seen && !max_.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Percentiles report the midpoint of the bucket holding the rank,
+    // clamped to the exact maximum
+    Summary Summarize() const {
+        uint64_t counts[kBucketCount];
+        uint64_t total = 0;
+        for (int i = 0; i < kBucketCount; i++) {
+            counts[i] = buckets_[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+
+        Summary s;
+        s.count = total;
+        s.max = static_cast<double>(max_.load(std::memory_order_relaxed));
+        s.mean = total > 0 ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / total : 0;
+        s.p50 = Percentile(counts, total, 0.50, s.max);
+        s.p95 = Percentile(counts, total, 0.95, s.max);
+        s.p99 = Percentile(counts, total, 0.99, s.max);
+        return s;
+    }
+
+    static int BucketFor(uint64_t value) {
+        if (value < kSubBuckets) {
+            return static_cast<int>(value);
+        }
+        int msb = 63 - CountLeadingZeros(value);
+        int index = (msb - kSubBits + 1) * kSubBuckets + static_cast<int>((value >> (msb - kSubBits)) & (kSubBuckets - 1));
+        return index < kBucketCount ? index : kBucketCount - 1;
+    }
+
+    static uint64_t BucketLow(int index) {
+        if (index < kSubBuckets) {
+            return static_cast<uint64_t>(index);
+        }
+        int msb = index / kSubBuckets + kSubBits - 1;
+        uint64_t sub = static_cast<uint64_t>(index % kSubBuckets);
+        return (kSubBuckets + sub) << (msb - kSubBits);
+    }
+
+    static uint64_t BucketWidth(int index) {
+        return index < kSubBuckets ? 1 : uint64_t(1) << (index / kSubBuckets - 1);
+    }
+
+private:
+    static int CountLeadingZeros(uint64_t value) {
+#if defined(_MSC_VER)
+        unsigned long bit;
+        _BitScanReverse64(&bit, value);
+        return 63 - static_cast<int>(bit);
+#else
+        return __builtin_clzll(value);
+#endif
+    }
+
+    static double Percentile(const uint64_t* counts, uint64_t total, double q, double max) {
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < kBucketCount; i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                double mid = static_cast<double>(BucketLow(i)) + (static_cast<double>(BucketWidth(i)) - 1) / 2;
+                return mid < max ? mid : max;
+            }
+        }
+        return max;
+    }
+
+    std::atomic<uint64_t> buckets_[kBucketCount];
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+};
+
+#endif // LATENCY_HISTOGRAM_H
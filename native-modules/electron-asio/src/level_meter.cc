@@ -0,0 +1,229 @@
+/**
+ * LevelMeter implementation
+ */
+
+#include "level_meter.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+
+namespace kernels {
+
+static void AccumulateLevelsScalar(const float* src, size_t frames, int firstChannel, int channels,
+                                   int stride, float* peak, float* energy) {
+    for (int ch = firstChannel; ch < channels; ch++) {
+        float p = peak[ch];
+        float e = 0.0f;
+        for (size_t i = 0; i < frames; i++) {
+            float x = src[i * stride + ch];
+            p = std::max(p, std::fabs(x));
+            e += x * x;
+        }
+        peak[ch] = p;
+        energy[ch] += e;
+    }
+}
+
+#if ASIO_HAVE_SSE2
+
+// Channels [firstChannel, end) in groups of four; returns the first channel left over
+static int AccumulateGroupsSse2(const float* src, size_t frames, int firstChannel, int channels,
+                                float* peak, float* energy) {
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    int end = firstChannel + ((channels - firstChannel) & ~3);
+    for (int ch = firstChannel; ch < end; ch += 4) {
+        __m128 p = _mm_loadu_ps(peak + ch);
+        __m128 e = _mm_setzero_ps();
+        const float* s = src + ch;
+        for (size_t i = 0; i < frames; i++) {
+            __m128 x = _mm_loadu_ps(s + i * channels);
+            p = _mm_max_ps(p, _mm_andnot_ps(signMask, x));
+            e = _mm_add_ps(e, _mm_mul_ps(x, x));
+        }
+        _mm_storeu_ps(peak + ch, p);
+        _mm_storeu_ps(energy + ch, _mm_add_ps(_mm_loadu_ps(energy + ch), e));
+    }
+    return end;
+}
+
+static void AccumulateChannelSse2(const float* src, size_t frames, float* peak, float* energy) {
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 p0 = _mm_setzero_ps(), p1 = _mm_setzero_ps();
+    __m128 e0 = _mm_setzero_ps(), e1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m128 a = _mm_loadu_ps(src + i);
+        __m128 b = _mm_loadu_ps(src + i + 4);
+        p0 = _mm_max_ps(p0, _mm_andnot_ps(signMask, a));
+        p1 = _mm_max_ps(p1, _mm_andnot_ps(signMask, b));
+        e0 = _mm_add_ps(e0, _mm_mul_ps(a, a));
+        e1 = _mm_add_ps(e1, _mm_mul_ps(b, b));
+    }
+    float p[4], e[4];
+    _mm_storeu_ps(p, _mm_max_ps(p0, p1));
+    _mm_storeu_ps(e, _mm_add_ps(e0, e1));
+    float pk = std::max(std::max(p[0], p[1]), std::max(p[2], p[3]));
+    float en = (e[0] + e[1]) + (e[2] + e[3]);
+    for (; i < frames; i++) {
+        pk = std::max(pk, std::fabs(src[i]));
+        en += src[i] * src[i];
+    }
+    *peak = std::max(*peak, pk);
+    *energy += en;
+}
+
+#endif // ASIO_HAVE_SSE2
+
+#if ASIO_HAVE_AVX2
+
+ASIO_TARGET_AVX2
+static int AccumulateGroupsAvx2(const float* src, size_t frames, int channels, float* peak, float* energy) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    int end = channels & ~7;
+    for (int ch = 0; ch < end; ch += 8) {
+        __m256 p = _mm256_loadu_ps(peak + ch);
+        __m256 e = _mm256_setzero_ps();
+        const float* s = src + ch;
+        for (size_t i = 0; i < frames; i++) {
+            __m256 x = _mm256_loadu_ps(s + i * channels);
+            p = _mm256_max_ps(p, _mm256_andnot_ps(signMask, x));
+            e = _mm256_fmadd_ps(x, x, e);
+        }
+        _mm256_storeu_ps(peak + ch, p);
+        _mm256_storeu_ps(energy + ch, _mm256_add_ps(_mm256_loadu_ps(energy + ch), e));
+    }
+    return end;
+}
+
+#endif // ASIO_HAVE_AVX2
+
+void AccumulateLevelsInterleaved(const float* src, size_t frames, int channels, float* peak, float* energy) {
+    int done = 0;
+#if ASIO_HAVE_AVX2
+    if (simd::HasAvx2() && channels >= 8) {
+        done = AccumulateGroupsAvx2(src, frames, channels, peak, energy);
+    }
+#endif
+#if ASIO_HAVE_SSE2
+    done = AccumulateGroupsSse2(src, frames, done, channels, peak, energy);
+#endif
+    AccumulateLevelsScalar(src, frames, done, channels, channels, peak, energy);
+}
+
+void AccumulateLevelsChannel(const float* src, size_t frames, float* peak, float* energy) {
+#if ASIO_HAVE_SSE2
+    AccumulateChannelSse2(src, frames, peak, energy);
+#else
+    AccumulateLevelsScalar(src, frames, 0, 1, 1, peak, energy);
+#endif
+}
+
+} // namespace kernels
+
+LevelMeter::LevelMeter()
+    : channels_(0),
+      publishHz_(30),
+      framesPerPublish_(1600),
+      holdFrames_(48000),
+      decayPerPublish_(1.0f),
+      accumulatedFrames_(0),
+      sequence_(0) {}
+
+void LevelMeter::Reset(int channels, double sampleRate, double publishHz, double holdSeconds,
+                       double decayDbPerSecond) {
+    channels_ = channels > 0 ? channels : 0;
+    publishHz_ = publishHz > 0 ? publishHz : 30;
+    framesPerPublish_ = std::max<size_t>(1, static_cast<size_t>(sampleRate / publishHz_));
+    holdFrames_ = static_cast<size_t>(std::max(0.0, holdSeconds) * sampleRate);
+    decayPerPublish_ = static_cast<float>(std::pow(10.0, -decayDbPerSecond / 20.0 / publishHz_));
+
+    accumulatedFrames_ = 0;
+    peakAcc_.assign(channels_, 0.0f);
+    energyAcc_.assign(channels_, 0.0f);
+    energyTotal_.assign(channels_, 0.0);
+    hold_.assign(channels_, 0.0f);
+    holdRemaining_.assign(channels_, 0);
+
+    published_.reset(new std::atomic<float>[channels_ * 3 + 1]);
+    for (int i = 0; i < channels_ * 3; i++) {
+        published_[i].store(0.0f, std::memory_order_relaxed);
+    }
+    sequence_.store(0, std::memory_order_relaxed);
+}
+
+bool LevelMeter::Process(const void* input, size_t frames, bool planar) {
+    if (!input || channels_ == 0) {
+        return false;
+    }
+
+    // Energy is summed in float per buffer, then folded into double totals
+    std::fill(energyAcc_.begin(), energyAcc_.end(), 0.0f);
+    if (planar) {
+        const float* const* in = static_cast<const float* const*>(input);
+        for (int ch = 0; ch < channels_; ch++) {
+            kernels::AccumulateLevelsChannel(in[ch], frames, &peakAcc_[ch], &energyAcc_[ch]);
+        }
+    } else {
+        kernels::AccumulateLevelsInterleaved(static_cast<const float*>(input), frames, channels_,
+                                             peakAcc_.data(), energyAcc_.data());
+    }
+    for (int ch = 0; ch < channels_; ch++) {
+        energyTotal_[ch] += energyAcc_[ch];
+    }
+
+    accumulatedFrames_ += frames;
+    if (accumulatedFrames_ < framesPerPublish_) {
+        return false;
+    }
+
+    Publish();
+    return true;
+}
+
+void LevelMeter::Publish() {
+    uint64_t seq = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (int ch = 0; ch < channels_; ch++) {
+        float peak = peakAcc_[ch];
+        float rms = static_cast<float>(std::sqrt(energyTotal_[ch] / static_cast<double>(accumulatedFrames_)));
+
+        // Peak hold: latch new maxima, hold them, then decay
+        if (peak >= hold_[ch]) {
+            hold_[ch] = peak;
+            holdRemaining_[ch] = holdFrames_;
+        } else if (holdRemaining_[ch] > accumulatedFrames_) {
+            holdRemaining_[ch] -= accumulatedFrames_;
+        } else {
+            holdRemaining_[ch] = 0;
+            hold_[ch] = std::max(peak, hold_[ch] * decayPerPublish_);
+        }
+
+        published_[ch * 3].store(peak, std::memory_order_relaxed);
+        published_[ch * 3 + 1].store(rms, std::memory_order_relaxed);
+        published_[ch * 3 + 2].store(hold_[ch], std::memory_order_relaxed);
+
+        peakAcc_[ch] = 0.0f;
+        energyTotal_[ch] = 0.0;
+    }
+    accumulatedFrames_ = 0;
+
+    sequence_.store(seq + 2, std::memory_order_release);
+}
+
+uint64_t LevelMeter::Read(float* levels) const {
+    for (;;) {
+        uint64_t before = sequence_.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;   // Publish in progress; it is a handful of stores
+        }
+        for (int i = 0; i < channels_ * 3; i++) {
+            levels[i] = published_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) == before) {
+            return before / 2;
+        }
+    }
+}
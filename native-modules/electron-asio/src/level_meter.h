@@ -0,0 +1,68 @@
+/**
+ * LevelMeter - per-channel peak, RMS and peak-hold metering
+ *
+ * Accumulates on the audio thread with SIMD reductions and publishes a
+ * snapshot at a fixed rate through a sequence lock, so readers on any thread
+ * get a consistent set of levels without ever blocking the audio thread.
+ */
+
+#ifndef LEVEL_METER_H
+#define LEVEL_METER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace kernels {
+
+// Fold frames of interleaved audio into per-channel running peak (max |x|)
+// and energy (sum of x^2). Vectorized across channels.
+void AccumulateLevelsInterleaved(const float* src, size_t frames, int channels, float* peak, float* energy);
+
+// Same for one planar channel. Vectorized across samples.
+void AccumulateLevelsChannel(const float* src, size_t frames, float* peak, float* energy);
+
+} // namespace kernels
+
+class LevelMeter {
+public:
+    LevelMeter();
+
+    // Not thread safe: call only while the audio thread is not metering
+    void Reset(int channels, double sampleRate, double publishHz, double holdSeconds, double decayDbPerSecond);
+
+    int Channels() const { return channels_; }
+    double PublishHz() const { return publishHz_; }
+
+    // Audio thread. Returns true when a new snapshot was published.
+    bool Process(const void* input, size_t frames, bool planar);
+
+    // Any thread: copy the latest snapshot as [peak, rms, peakHold] per
+    // channel (3 * Channels() floats). Returns the snapshot number.
+    uint64_t Read(float* levels) const;
+
+private:
+    void Publish();
+
+    int channels_;
+    double publishHz_;
+    size_t framesPerPublish_;
+    size_t holdFrames_;
+    float decayPerPublish_;
+
+    // Audio thread state
+    size_t accumulatedFrames_;
+    std::vector<float> peakAcc_;
+    std::vector<float> energyAcc_;
+    std::vector<double> energyTotal_;
+    std::vector<float> hold_;
+    std::vector<size_t> holdRemaining_;
+
+    // Published snapshot guarded by a sequence lock (odd = write in progress)
+    std::atomic<uint64_t> sequence_;
+    std::unique_ptr<std::atomic<float>[]> published_;
+};
+
+#endif // LEVEL_METER_H
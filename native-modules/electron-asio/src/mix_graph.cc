@@ -0,0 +1,155 @@
+/**
+ * MixGraph implementation
+ */
+
+#include "mix_graph.h"
+#include <algorithm>
+
+MixGraph::MixGraph(int inputChannels, int outputChannels, int busCount, size_t maxFrames,
+                   std::vector<MixTap> taps, std::vector<MixRoute> routes)
+    : inputChannels_(inputChannels),
+      outputChannels_(outputChannels),
+      busCount_(busCount),
+      maxFrames_(maxFrames),
+      taps_(std::move(taps)),
+      routes_(std::move(routes)),
+      busBuffers_(static_cast<size_t>(busCount) * maxFrames, 0.0f),
+      busGain_(new std::atomic<float>[busCount > 0 ? busCount : 1]),
+      busMute_(new std::atomic<bool>[busCount > 0 ? busCount : 1]),
+      inputGain_(new std::atomic<float>[inputChannels > 0 ? inputChannels : 1]),
+      appliedBusGain_(busCount, 1.0f) {
+
+    for (int b = 0; b < busCount; b++) {
+        busGain_[b].store(1.0f, std::memory_order_relaxed);
+        busMute_[b].store(false, std::memory_order_relaxed);
+    }
+    for (int ch = 0; ch < inputChannels; ch++) {
+        inputGain_[ch].store(1.0f, std::memory_order_relaxed);
+    }
+
+    // Group work by bus so each bus buffer stays hot while it is summed
+    std::stable_sort(taps_.begin(), taps_.end(),
+                     [](const MixTap& a, const MixTap& b) { return a.bus < b.bus; });
+}
+
+void MixGraph::Process(const void* input, void* output, size_t frames, bool planar) {
+    if (!output) {
+        return;
+    }
+
+    // Process in chunks no larger than the preallocated bus buffers
+    size_t offset = 0;
+    while (offset < frames) {
+        size_t n = std::min(frames - offset, maxFrames_);
+
+        // Sum taps into buses
+        std::fill(busBuffers_.begin(), busBuffers_.begin() + static_cast<size_t>(busCount_) * n, 0.0f);
+        if (input) {
+            for (const MixTap& tap : taps_) {
+                float gain = tap.gain * inputGain_[tap.channel].load(std::memory_order_relaxed);
+                if (gain == 0.0f) continue;
+
+                float* bus = busBuffers_.data() + static_cast<size_t>(tap.bus) * n;
+                if (planar) {
+                    const float* src = static_cast<const float* const*>(input)[tap.channel] + offset;
+                    for (size_t i = 0; i < n; i++) {
+                        bus[i] += src[i] * gain;
+                    }
+                } else {
+                    const float* src = static_cast<const float*>(input) + offset * inputChannels_ + tap.channel;
+                    for (size_t i = 0; i < n; i++) {
+                        bus[i] += src[i * inputChannels_] * gain;
+                    }
+                }
+            }
+        }
+
+        // Ramp each bus gain linearly across the chunk to avoid zipper noise
+        for (int b = 0; b < busCount_; b++) {
+            float target = busMute_[b].load(std::memory_order_relaxed)
+                ? 0.0f : busGain_[b].load(std::memory_order_relaxed);
+            float start = appliedBusGain_[b];
+            float* bus = busBuffers_.data() + static_cast<size_t>(b) * n;
+            if (start == target) {
+                if (target != 1.0f) {
+                    for (size_t i = 0; i < n; i++) bus[i] *= target;
+                }
+            } else {
+                float step = (target - start) / static_cast<float>(n);
+                for (size_t i = 0; i < n; i++) {
+                    bus[i] *= start + step * static_cast<float>(i + 1);
+                }
+            }
+            appliedBusGain_[b] = target;
+        }
+
+        // Route buses to outputs
+        for (const MixRoute& route : routes_) {
+            const float* bus = busBuffers_.data() + static_cast<size_t>(route.bus) * n;
+            if (planar) {
+                float* dst = static_cast<float* const*>(output)[route.channel] + offset;
+                for (size_t i = 0; i < n; i++) {
+                    dst[i] += bus[i];
+                }
+            } else {
+                float* dst = static_cast<float*>(output) + offset * outputChannels_ + route.channel;
+                for (size_t i = 0; i < n; i++) {
+                    dst[i * outputChannels_] += bus[i];
+                }
+            }
+        }
+
+        offset += n;
+    }
+}
+
+MixGraph* GraphSlot::Removed() {
+    static char sentinel;
+    return reinterpret_cast<MixGraph*>(&sentinel);
+}
+
+GraphSlot::~GraphSlot() {
+    MixGraph* pending = pending_.load();
+    if (pending != Removed()) {
+        delete pending;
+    }
+    delete current_;
+    Collect();
+}
+
+void GraphSlot::Publish(MixGraph* graph) {
+    Collect();
+    // Replace any graph the audio thread has not picked up yet
+    MixGraph* stale = pending_.exchange(graph ? graph : Removed(), std::memory_order_acq_rel);
+    if (stale != Removed()) {
+        delete stale;
+    }
+}
+
+void GraphSlot::Collect() {
+    // Taking the whole list at once leaves no node for a concurrent push to
+    // race with, so there is no A-B-A to guard against
+    MixGraph* graph = retired_.exchange(nullptr, std::memory_order_acquire);
+    while (graph) {
+        MixGraph* next = graph->retiredNext_;
+        delete graph;
+        graph = next;
+    }
+}
+
+MixGraph* GraphSlot::Acquire() {
+    if (pending_.load(std::memory_order_relaxed)) {
+        MixGraph* next = pending_.exchange(nullptr, std::memory_order_acq_rel);
+        if (next) {
+            if (MixGraph* old = current_) {
+                MixGraph* head = retired_.load(std::memory_order_relaxed);
+                do {
+                    old->retiredNext_ = head;
+                } while (!retired_.compare_exchange_weak(head, old, std::memory_order_release,
+                                                         std::memory_order_relaxed));
+            }
+            current_ = next == Removed() ? nullptr : next;
+        }
+    }
+    return current_;
+}
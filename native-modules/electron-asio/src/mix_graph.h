@@ -0,0 +1,94 @@
+/**
+ * MixGraph - allocation-free monitoring mixer run inside PaCallback
+ *
+ * Input taps feed summing buses; each bus has a gain and mute and is routed
+ * to one or more output channels. The topology is built on the JS thread and
+ * published whole through GraphSlot; gains and mutes are plain atomics so
+ * they can change without republishing.
+ */
+
+#ifndef MIX_GRAPH_H
+#define MIX_GRAPH_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+struct MixTap {
+    int bus;
+    int channel;    // Input channel
+    float gain;
+};
+
+struct MixRoute {
+    int bus;
+    int channel;    // Output channel
+};
+
+class MixGraph {
+public:
+    // Allocates everything Process will touch. Taps and routes must already
+    // be validated against the channel counts.
+    MixGraph(int inputChannels, int outputChannels, int busCount, size_t maxFrames,
+             std::vector<MixTap> taps, std::vector<MixRoute> routes);
+
+    int BusCount() const { return busCount_; }
+    int InputChannels() const { return inputChannels_; }
+
+    // Parameter updates; safe from any thread while the audio thread runs
+    void SetBusGain(int bus, float gain) { busGain_[bus].store(gain, std::memory_order_relaxed); }
+    void SetBusMute(int bus, bool mute) { busMute_[bus].store(mute, std::memory_order_relaxed); }
+    void SetInputGain(int channel, float gain) { inputGain_[channel].store(gain, std::memory_order_relaxed); }
+
+    // Audio thread: mix input into output. Output is summed into, not
+    // overwritten, so it layers on top of write() playback. Planar buffers
+    // are arrays of channel pointers; interleaved buffers are single arrays.
+    void Process(const void* input, void* output, size_t frames, bool planar);
+
+private:
+    friend class GraphSlot;
+
+    int inputChannels_;
+    int outputChannels_;
+    int busCount_;
+    size_t maxFrames_;
+    std::vector<MixTap> taps_;
+    std::vector<MixRoute> routes_;
+
+    std::vector<float> busBuffers_;         // busCount x maxFrames
+    std::unique_ptr<std::atomic<float>[]> busGain_;
+    std::unique_ptr<std::atomic<bool>[]> busMute_;
+    std::unique_ptr<std::atomic<float>[]> inputGain_;
+    std::vector<float> appliedBusGain_;     // Audio thread: last gain used, for ramping
+    MixGraph* retiredNext_ = nullptr;       // GraphSlot retired list link
+};
+
+// Single-slot hand-off of graph topologies from the JS thread to the audio
+// thread. The audio thread adopts a pending graph at the top of a callback
+// and pushes the one it replaced onto a lock-free list for the JS thread to
+// delete, so adoption never waits on a collection.
+class GraphSlot {
+public:
+    GraphSlot() : current_(nullptr), pending_(nullptr), retired_(nullptr) {}
+    ~GraphSlot();
+
+    // JS thread: queue graph (or nullptr to remove the graph) for adoption
+    void Publish(MixGraph* graph);
+
+    // JS thread: free graphs the audio thread is done with
+    void Collect();
+
+    // Audio thread: adopt any pending graph and return the active one
+    MixGraph* Acquire();
+
+private:
+    // Stands in for "no graph" in pending_, where nullptr means "nothing queued"
+    static MixGraph* Removed();
+
+    MixGraph* current_;                     // Audio thread only
+    std::atomic<MixGraph*> pending_;
+    std::atomic<MixGraph*> retired_;        // Head of the retired list
+};
+
+#endif // MIX_GRAPH_H
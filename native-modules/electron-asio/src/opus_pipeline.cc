@@ -0,0 +1,339 @@
+/**
+ * OpusPipeline implementation
+ */
+
+#include "opus_pipeline.h"
+#include "deinterleave.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(ELECTRON_ASIO_HAVE_OPUS)
+#include <opus.h>
+#endif
+
+namespace {
+
+const size_t kMaxPacketBytes = 4000;    // Recommended opus_encode buffer size
+const double kRingSeconds = 0.5;        // Input held for a busy encoder thread
+
+} // namespace
+
+OpusPipeline::OpusPipeline()
+    : frameSize_(0),
+      lookahead_(0),
+      pendingSilence_(0),
+      pushedFrames_(0),
+      lastPush_(0),
+      stopping_(false),
+      position_(0),
+      sequence_(0),
+      maxQueue_(0),
+      wake_(nullptr),
+      wakeContext_(nullptr),
+      framesEncoded_(0),
+      bytesEncoded_(0),
+      droppedInput_(0),
+      droppedFrames_(0),
+      encodeErrors_(0) {}
+
+OpusPipeline::~OpusPipeline() {
+    Stop();
+}
+
+bool OpusPipeline::Available() {
+#if defined(ELECTRON_ASIO_HAVE_OPUS)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool OpusPipeline::Start(const OpusPipelineConfig& config, std::string* error) {
+#if !defined(ELECTRON_ASIO_HAVE_OPUS)
+    (void)config;
+    *error = "Built without Opus: add libopus under deps/opus and rebuild";
+    return false;
+#else
+    Stop();
+    config_ = config;
+
+    long rate = std::lround(config_.sampleRate);
+    if (rate != 8000 && rate != 12000 && rate != 16000 && rate != 24000 && rate != 48000) {
+        *error = "Opus encoding needs a sample rate of 8, 12, 16, 24 or 48 kHz";
+        return false;
+    }
+    static const double kFrameMs[] = {2.5, 5, 10, 20, 40, 60};
+    if (std::find(std::begin(kFrameMs), std::end(kFrameMs), config_.frameMs) == std::end(kFrameMs)) {
+        *error = "frameMs must be 2.5, 5, 10, 20, 40 or 60";
+        return false;
+    }
+    if (config_.bitrate < 6000 || config_.bitrate > 256000) {
+        *error = "bitrate must be 6000 to 256000 bits per second per channel";
+        return false;
+    }
+    if (config_.complexity < 0 || config_.complexity > 10) {
+        *error = "complexity must be 0 to 10";
+        return false;
+    }
+    frameSize_ = static_cast<size_t>(rate * config_.frameMs / 1000.0);
+
+    int application = OPUS_APPLICATION_AUDIO;
+    if (config_.application == OpusApplication::Voip) {
+        application = OPUS_APPLICATION_VOIP;
+    } else if (config_.application == OpusApplication::LowDelay) {
+        application = OPUS_APPLICATION_RESTRICTED_LOWDELAY;
+    }
+
+    // Stereo pairs (the last channel of an odd count alone), or all mono
+    int width = config_.stereoPairs ? 2 : 1;
+    for (int ch = 0; ch < config_.channels; ch += width) {
+        Group group;
+        group.firstChannel = ch;
+        group.channels = std::min(width, config_.channels - ch);
+        int status = OPUS_OK;
+        group.encoder = opus_encoder_create(static_cast<opus_int32>(rate), group.channels, application, &status);
+        if (status != OPUS_OK || !group.encoder) {
+            *error = std::string("Cannot create Opus encoder: ") + opus_strerror(status);
+            DestroyEncoders();
+            return false;
+        }
+        opus_encoder_ctl(group.encoder, OPUS_SET_BITRATE(config_.bitrate * group.channels));
+        opus_encoder_ctl(group.encoder, OPUS_SET_COMPLEXITY(config_.complexity));
+        group.pcm.assign(frameSize_ * group.channels, 0.0f);
+        group.packet.assign(kMaxPacketBytes, 0);
+        groups_.push_back(std::move(group));
+    }
+    opus_int32 lookahead = 0;
+    opus_encoder_ctl(groups_[0].encoder, OPUS_GET_LOOKAHEAD(&lookahead));
+    lookahead_ = lookahead;
+
+    int threads = config_.threads;
+    int groups = static_cast<int>(groups_.size());
+    if (threads < 0) {
+        int cores = static_cast<int>(std::thread::hardware_concurrency());
+        threads = groups >= 4 ? std::max(0, std::min({4, cores - 1, groups / 2})) : 0;
+    }
+    if (threads > 0) {
+        workers_.reset(new ChannelWorkers(threads));
+        encodeGroup_ = [this](int group) { EncodeGroup(group); };
+    }
+
+    size_t ringFrames = std::max(frameSize_ * 4, static_cast<size_t>(kRingSeconds * rate));
+    ring_.Reset(ringFrames, config_.channels);
+    pushPtrs_.resize(config_.channels);
+    frame_.assign(config_.channels, std::vector<float>(frameSize_, 0.0f));
+    framePtrs_.resize(config_.channels);
+    for (int ch = 0; ch < config_.channels; ch++) {
+        framePtrs_[ch] = frame_[ch].data();
+    }
+    maxQueue_ = std::max<size_t>(2, static_cast<size_t>(config_.queueMs / config_.frameMs));
+
+    pendingSilence_ = 0;
+    pushedFrames_ = 0;
+    lastPush_ = 0;
+    position_ = 0;
+    sequence_ = 0;
+    framesEncoded_ = 0;
+    bytesEncoded_ = 0;
+    droppedInput_ = 0;
+    droppedFrames_ = 0;
+    encodeErrors_ = 0;
+    encodeTime_.Reset();
+    stopping_ = false;
+    thread_ = std::thread(&OpusPipeline::Run, this);
+    return true;
+#endif
+}
+
+void OpusPipeline::Stop() {
+    stopping_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    workers_.reset();
+    DestroyEncoders();
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    queue_.clear();
+}
+
+void OpusPipeline::SetWake(void (*wake)(void*), void* context) {
+    wake_ = wake;
+    wakeContext_ = context;
+}
+
+void OpusPipeline::Push(const void* input, size_t frames, bool planar, uint64_t now) {
+    int channels = config_.channels;
+    size_t offset, firstLen;
+    size_t free = ring_.PrepareWriteLanes(&offset, &firstLen);
+    if (free < frames) {
+        // Dropped whole; silence takes its place once there is room, so
+        // timestamps keep following the capture clock
+        droppedInput_.fetch_add(frames, std::memory_order_relaxed);
+        pendingSilence_ += frames;
+    } else {
+        if (pendingSilence_ > 0) {
+            size_t silence = std::min(pendingSilence_, free - frames);
+            size_t a = std::min(silence, firstLen);
+            for (int ch = 0; ch < channels; ch++) {
+                float* lane = ring_.Lane(ch);
+                std::fill(lane + offset, lane + offset + a, 0.0f);
+                std::fill(lane, lane + (silence - a), 0.0f);
+            }
+            ring_.CommitWrite(silence);
+            pendingSilence_ -= silence;
+            ring_.PrepareWriteLanes(&offset, &firstLen);
+        }
+
+        size_t a = std::min(frames, firstLen);
+        if (planar) {
+            const float* const* in = static_cast<const float* const*>(input);
+            for (int ch = 0; ch < channels; ch++) {
+                float* lane = ring_.Lane(ch);
+                std::memcpy(lane + offset, in[ch], a * sizeof(float));
+                std::memcpy(lane, in[ch] + a, (frames - a) * sizeof(float));
+            }
+        } else {
+            // Deinterleave straight into the ring, once per contiguous region
+            const float* in = static_cast<const float*>(input);
+            for (int ch = 0; ch < channels; ch++) {
+                pushPtrs_[ch] = ring_.Lane(ch) + offset;
+            }
+            kernels::Deinterleave(in, pushPtrs_.data(), a, channels);
+            if (frames > a) {
+                for (int ch = 0; ch < channels; ch++) {
+                    pushPtrs_[ch] = ring_.Lane(ch);
+                }
+                kernels::Deinterleave(in + a * channels, pushPtrs_.data(), frames - a, channels);
+            }
+        }
+        ring_.CommitWrite(frames);
+    }
+    lastPush_.store(now, std::memory_order_release);
+    pushedFrames_.fetch_add(frames, std::memory_order_release);
+}
+
+void OpusPipeline::Drain(std::deque<EncodedFrame>* out) {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    for (EncodedFrame& frame : queue_) {
+        out->push_back(std::move(frame));
+    }
+    queue_.clear();
+}
+
+size_t OpusPipeline::QueueDepth() const {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    return queue_.size();
+}
+
+void OpusPipeline::Run() {
+    double rate = config_.sampleRate;
+    for (;;) {
+        if (stopping_.load(std::memory_order_acquire)) {
+            break;
+        }
+        size_t available = ring_.ReadAvailable();
+        if (available < frameSize_) {
+            // Sleep until the rest of the frame should have arrived
+            double wait = (frameSize_ - available) / rate;
+            std::this_thread::sleep_for(std::chrono::duration<double>(std::max(wait, 0.001)));
+            continue;
+        }
+        ring_.ReadLanes(framePtrs_.data(), frameSize_);
+        EncodeFrame(CaptureTime(position_));
+        position_ += frameSize_;
+    }
+}
+
+uint64_t OpusPipeline::CaptureTime(uint64_t position) const {
+    // Re-read if a push lands between the two loads
+    uint64_t pushed, time;
+    do {
+        pushed = pushedFrames_.load(std::memory_order_acquire);
+        time = lastPush_.load(std::memory_order_acquire);
+    } while (pushed != pushedFrames_.load(std::memory_order_acquire));
+
+    // The latest push ended with sample pushed - 1, captured at about time
+    double ago = (pushed > position ? pushed - position : 0) / config_.sampleRate * 1e9;
+    return (time > ago ? time - static_cast<uint64_t>(ago) : 0) / 1000;
+}
+
+void OpusPipeline::EncodeFrame(uint64_t captureTime) {
+    int groups = static_cast<int>(groups_.size());
+    uint64_t begin = MonotonicNanos();
+    if (workers_) {
+        workers_->Run(groups, encodeGroup_);
+    } else {
+        for (int g = 0; g < groups; g++) {
+            EncodeGroup(g);
+        }
+    }
+    encodeTime_.Record((MonotonicNanos() - begin) / 1000);
+
+    EncodedFrame frame;
+    frame.sequence = sequence_++;
+    frame.timestamp = position_;
+    frame.captureTime = captureTime;
+    frame.sizes.resize(groups);
+    size_t total = 0;
+    for (const Group& group : groups_) {
+        total += group.bytes > 0 ? group.bytes : 0;
+    }
+    frame.data.resize(total);
+    size_t offset = 0;
+    for (int g = 0; g < groups; g++) {
+        const Group& group = groups_[g];
+        if (group.bytes < 0) {
+            encodeErrors_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        std::memcpy(frame.data.data() + offset, group.packet.data(), group.bytes);
+        frame.sizes[g] = static_cast<uint32_t>(group.bytes);
+        offset += group.bytes;
+    }
+    framesEncoded_.fetch_add(1, std::memory_order_relaxed);
+    bytesEncoded_.fetch_add(total, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        if (queue_.size() >= maxQueue_) {
+            // JS is not keeping up: drop the oldest frame rather than grow
+            queue_.pop_front();
+            droppedFrames_.fetch_add(1, std::memory_order_relaxed);
+        }
+        queue_.push_back(std::move(frame));
+    }
+    if (wake_) {
+        wake_(wakeContext_);
+    }
+}
+
+void OpusPipeline::EncodeGroup(int index) {
+    Group& group = groups_[index];
+    int channels = group.channels;
+    float* pcm = group.pcm.data();
+    for (int c = 0; c < channels; c++) {
+        const float* src = frame_[group.firstChannel + c].data();
+        for (size_t i = 0; i < frameSize_; i++) {
+            pcm[i * channels + c] = src[i];
+        }
+    }
+#if defined(ELECTRON_ASIO_HAVE_OPUS)
+    group.bytes = opus_encode_float(group.encoder, pcm, static_cast<int>(frameSize_), group.packet.data(),
+                                    static_cast<opus_int32>(group.packet.size()));
+#else
+    group.bytes = -1;
+#endif
+}
+
+void OpusPipeline::DestroyEncoders() {
+#if defined(ELECTRON_ASIO_HAVE_OPUS)
+    for (Group& group : groups_) {
+        if (group.encoder) {
+            opus_encoder_destroy(group.encoder);
+        }
+    }
+#endif
+    groups_.clear();
+}
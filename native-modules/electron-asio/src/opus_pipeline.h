@@ -0,0 +1,153 @@
+/**
+ * OpusPipeline - compressed delivery of captured input
+ *
+ * The audio thread copies each period into a lock-free ring, one lane per
+ * channel. A dedicated encoder thread reframes the ring into fixed Opus
+ * frames (2.5 to 60 ms) and encodes them, fanning the channel groups of a
+ * wide stream out over a small ChannelWorkers pool. Channels are encoded
+ * as stereo pairs (or mono) so every group is an ordinary Opus stream a
+ * WebRTC or network consumer can decode on its own.
+ *
+ * Encoded frames wait in a short queue for the JS thread, which is woken
+ * through the wake hook. Opus is optional at build time: without
+ * ELECTRON_ASIO_HAVE_OPUS, Start fails with an explanatory error.
+ */
+
+#ifndef OPUS_PIPELINE_H
+#define OPUS_PIPELINE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "channel_workers.h"
+#include "latency_histogram.h"
+#include "spsc_ring.h"
+
+struct OpusEncoder;
+
+enum class OpusApplication {
+    Audio,      // Music and mixed content
+    Voip,       // Speech intelligibility first
+    LowDelay    // CELT only, lowest algorithmic delay
+};
+
+struct OpusPipelineConfig {
+    double sampleRate = 48000;      // 8, 12, 16, 24 or 48 kHz
+    int channels = 2;
+    double frameMs = 20;            // 2.5, 5, 10, 20, 40 or 60
+    int bitrate = 64000;            // Bits per second per channel
+    int complexity = 5;             // 0 (fastest) to 10
+    OpusApplication application = OpusApplication::Audio;
+    bool stereoPairs = true;        // Pair channels 0+1, 2+3, ...; false = all mono
+    int threads = -1;               // Encoder pool threads; -1 = auto
+    double queueMs = 500;           // Encoded audio held for a slow JS thread
+};
+
+// One frame period of every channel group, encoded
+struct EncodedFrame {
+    uint64_t sequence = 0;          // Frames since the pipeline started
+    uint64_t timestamp = 0;         // Sample position of the first sample
+    uint64_t captureTime = 0;       // MonotonicMicros() the first sample was captured
+    std::vector<uint8_t> data;      // Packets back to back, in group order
+    std::vector<uint32_t> sizes;    // Bytes per group
+};
+
+class OpusPipeline {
+public:
+    OpusPipeline();
+    ~OpusPipeline();
+
+    // True when the addon was built with Opus
+    static bool Available();
+
+    // JS thread: create the encoders and start the encoder thread. Returns
+    // false with error set on an unsupported configuration.
+    bool Start(const OpusPipelineConfig& config, std::string* error);
+    void Stop();
+
+    // Called on the encoder thread whenever frames are queued
+    void SetWake(void (*wake)(void*), void* context);
+
+    // Audio thread: queue one period of interleaved or planar input
+    void Push(const void* input, size_t frames, bool planar, uint64_t now);
+
+    // JS thread: move every queued frame into out (appended)
+    void Drain(std::deque<EncodedFrame>* out);
+
+    // Any thread
+    const OpusPipelineConfig& Config() const { return config_; }
+    size_t FrameSize() const { return frameSize_; }
+    int Groups() const { return static_cast<int>(groups_.size()); }
+    int GroupChannels(int group) const { return groups_[group].channels; }
+    int Threads() const { return workers_ ? workers_->Threads() : 0; }
+    int Lookahead() const { return lookahead_; }
+    uint64_t FramesEncoded() const { return framesEncoded_.load(std::memory_order_relaxed); }
+    uint64_t BytesEncoded() const { return bytesEncoded_.load(std::memory_order_relaxed); }
+    uint64_t DroppedInput() const { return droppedInput_.load(std::memory_order_relaxed); }
+    uint64_t DroppedFrames() const { return droppedFrames_.load(std::memory_order_relaxed); }
+    uint64_t EncodeErrors() const { return encodeErrors_.load(std::memory_order_relaxed); }
+    size_t QueueDepth() const;
+    // Wall time to encode every group of one frame, microseconds
+    LatencyHistogram& EncodeTime() { return encodeTime_; }
+
+private:
+    struct Group {
+        OpusEncoder* encoder = nullptr;
+        int firstChannel = 0;
+        int channels = 0;
+        std::vector<float> pcm;         // One frame, interleaved
+        std::vector<uint8_t> packet;
+        int bytes = 0;
+    };
+
+    void Run();
+    void EncodeFrame(uint64_t captureTime);
+    void EncodeGroup(int index);
+    uint64_t CaptureTime(uint64_t position) const;
+    void DestroyEncoders();
+
+    OpusPipelineConfig config_;
+    size_t frameSize_;
+    int lookahead_;
+    std::vector<Group> groups_;
+    std::unique_ptr<ChannelWorkers> workers_;
+    std::function<void(int)> encodeGroup_;     // Pool job: encode one group
+
+    // Audio thread state
+    SpscRing<float> ring_;
+    std::vector<float*> pushPtrs_;
+    size_t pendingSilence_;             // Dropped frames still to be filled in
+    std::atomic<uint64_t> pushedFrames_;
+    std::atomic<uint64_t> lastPush_;    // MonotonicNanos() of the latest push
+
+    // Encoder thread state
+    std::thread thread_;
+    std::atomic<bool> stopping_;
+    std::vector<std::vector<float>> frame_;     // One frame per channel
+    std::vector<float*> framePtrs_;
+    uint64_t position_;                 // Samples encoded so far
+    uint64_t sequence_;
+
+    // Handoff to the JS thread; neither side is realtime
+    mutable std::mutex queueMutex_;
+    std::deque<EncodedFrame> queue_;
+    size_t maxQueue_;
+    void (*wake_)(void*);
+    void* wakeContext_;
+
+    std::atomic<uint64_t> framesEncoded_;
+    std::atomic<uint64_t> bytesEncoded_;
+    std::atomic<uint64_t> droppedInput_;
+    std::atomic<uint64_t> droppedFrames_;
+    std::atomic<uint64_t> encodeErrors_;
+    LatencyHistogram encodeTime_;
+};
+
+#endif // OPUS_PIPELINE_H
@@ -0,0 +1,255 @@
+/**
+ * Recorder implementation
+ */
+
+#include "recorder.h"
+#include "deinterleave.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+const size_t kChunkFrames = 4096;       // Frames written per writer step
+const int kPollMs = 5;                  // Writer sleep when the ring is empty
+
+// "show.wav" -> "show_03.wav"
+std::string ChannelPath(const std::string& path, int channel, int channels) {
+    size_t slash = path.find_last_of("/\\");
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        dot = path.size();
+    }
+    std::string number = std::to_string(channel + 1);
+    size_t width = std::max<size_t>(2, std::to_string(channels).size());
+    number.insert(0, width - std::min(width, number.size()), '0');
+    return path.substr(0, dot) + "_" + number + path.substr(dot);
+}
+
+} // namespace
+
+Recorder::Recorder()
+    : pendingSilence_(0),
+      stopping_(false),
+      highWater_(0),
+      framesWritten_(0),
+      bytesWritten_(0),
+      droppedFrames_(0),
+      throughput_(0),
+      maxWriteMs_(0),
+      syncs_(0),
+      failed_(false) {}
+
+Recorder::~Recorder() {
+    if (thread_.joinable()) {
+        RecorderSummary discard;
+        Finish(&discard);
+    }
+}
+
+bool Recorder::Start(const std::string& path, const RecorderConfig& config, std::string* error) {
+    config_ = config;
+    int channels = config_.channels;
+    int files = config_.split ? channels : 1;
+
+    paths_.clear();
+    writers_.clear();
+    for (int i = 0; i < files; i++) {
+        paths_.push_back(config_.split ? ChannelPath(path, i, channels) : path);
+        std::unique_ptr<WavWriter> writer(new WavWriter());
+        if (!writer->Open(paths_[i], config_.sampleRate, config_.split ? 1 : channels, config_.format,
+                          config_.dither, config_.writeBlockBytes, config_.preallocateSeconds)) {
+            *error = "Cannot create " + paths_[i];
+            writers_.clear();
+            return false;
+        }
+        writers_.push_back(std::move(writer));
+    }
+
+    size_t ringFrames = std::max<size_t>(static_cast<size_t>(config_.ringSeconds * config_.sampleRate),
+                                         kChunkFrames * 2);
+    ring_.Reset(ringFrames, channels);
+    pushPtrs_.resize(channels);
+    readPtrs_.resize(channels);
+    pendingSilence_ = 0;
+
+    highWater_ = 0;
+    framesWritten_ = 0;
+    bytesWritten_ = 0;
+    droppedFrames_ = 0;
+    throughput_ = 0;
+    maxWriteMs_ = 0;
+    syncs_ = 0;
+    failed_ = false;
+    error_.clear();
+    stopping_ = false;
+    thread_ = std::thread(&Recorder::Run, this);
+    return true;
+}
+
+void Recorder::Finish(RecorderSummary* summary) {
+    stopping_.store(true, std::memory_order_release);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    for (std::unique_ptr<WavWriter>& writer : writers_) {
+        if (failed_) {
+            writer->Close();
+        } else if (!writer->Finish()) {
+            Fail("Write failed (disk full?)");
+        }
+    }
+    UpdateWriteStats();
+
+    summary->files = paths_;
+    summary->frames = framesWritten_.load();
+    summary->bytes = bytesWritten_.load();
+    summary->droppedFrames = droppedFrames_.load();
+    summary->error = failed_ ? error_ : std::string();
+    writers_.clear();
+}
+
+void Recorder::Push(const void* input, size_t frames, bool planar) {
+    int channels = config_.channels;
+    size_t offset, firstLen;
+    size_t free = ring_.PrepareWriteLanes(&offset, &firstLen);
+    if (free < frames) {
+        // Dropped whole; the gap is filled with silence once there is room
+        droppedFrames_.fetch_add(frames, std::memory_order_relaxed);
+        pendingSilence_ += frames;
+        highWater_.store(ring_.Capacity(), std::memory_order_relaxed);
+        return;
+    }
+
+    if (pendingSilence_ > 0) {
+        size_t silence = std::min(pendingSilence_, free - frames);
+        size_t a = std::min(silence, firstLen);
+        for (int ch = 0; ch < channels; ch++) {
+            float* lane = ring_.Lane(ch);
+            std::fill(lane + offset, lane + offset + a, 0.0f);
+            std::fill(lane, lane + (silence - a), 0.0f);
+        }
+        ring_.CommitWrite(silence);
+        pendingSilence_ -= silence;
+        free = ring_.PrepareWriteLanes(&offset, &firstLen);
+    }
+
+    size_t a = std::min(frames, firstLen);
+    if (planar) {
+        const float* const* in = static_cast<const float* const*>(input);
+        for (int ch = 0; ch < channels; ch++) {
+            float* lane = ring_.Lane(ch);
+            std::memcpy(lane + offset, in[ch], a * sizeof(float));
+            std::memcpy(lane, in[ch] + a, (frames - a) * sizeof(float));
+        }
+    } else {
+        // Deinterleave straight into the ring, once per contiguous region
+        const float* in = static_cast<const float*>(input);
+        for (int ch = 0; ch < channels; ch++) {
+            pushPtrs_[ch] = ring_.Lane(ch) + offset;
+        }
+        kernels::Deinterleave(in, pushPtrs_.data(), a, channels);
+        if (frames > a) {
+            for (int ch = 0; ch < channels; ch++) {
+                pushPtrs_[ch] = ring_.Lane(ch);
+            }
+            kernels::Deinterleave(in + a * channels, pushPtrs_.data(), frames - a, channels);
+        }
+    }
+    ring_.CommitWrite(frames);
+
+    size_t fill = ring_.Capacity() - free + frames;
+    if (fill > highWater_.load(std::memory_order_relaxed)) {
+        highWater_.store(fill, std::memory_order_relaxed);
+    }
+}
+
+void Recorder::Run() {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point lastSync = Clock::now();
+    Clock::time_point windowStart = lastSync;
+    uint64_t windowBytes = 0;
+    auto syncInterval = std::chrono::duration<double, std::milli>(config_.syncIntervalMs);
+
+    for (;;) {
+        // Read the flag first so everything pushed before Finish is drained
+        bool stopping = stopping_.load(std::memory_order_acquire);
+        size_t offset, firstLen;
+        size_t queued = ring_.PrepareReadLanes(&offset, &firstLen);
+        if (queued == 0) {
+            if (stopping) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(kPollMs));
+        } else {
+            size_t frames = std::min(firstLen, kChunkFrames);
+            if (!failed_.load(std::memory_order_relaxed)) {
+                Convert(offset, frames);
+            }
+            // After a failure the ring is still drained, so the audio
+            // thread does not count the rest of the show as dropped
+            ring_.CommitRead(frames);
+        }
+
+        Clock::time_point now = Clock::now();
+        double elapsed = std::chrono::duration<double>(now - windowStart).count();
+        if (elapsed >= 1.0) {
+            uint64_t bytes = bytesWritten_.load(std::memory_order_relaxed);
+            throughput_.store((bytes - windowBytes) / elapsed, std::memory_order_relaxed);
+            windowBytes = bytes;
+            windowStart = now;
+        }
+        if (config_.syncIntervalMs > 0 && now - lastSync >= syncInterval && !failed_.load()) {
+            SyncAll();
+            lastSync = now;
+        }
+    }
+}
+
+void Recorder::Convert(size_t offset, size_t frames) {
+    for (int ch = 0; ch < config_.channels; ch++) {
+        readPtrs_[ch] = ring_.Lane(ch) + offset;
+    }
+    for (size_t i = 0; i < writers_.size(); i++) {
+        // Split files take one lane each, a single file all of them
+        if (!writers_[i]->Append(readPtrs_.data() + (config_.split ? i : 0), frames)) {
+            Fail("Write failed (disk full?)");
+            return;
+        }
+    }
+    framesWritten_.fetch_add(frames, std::memory_order_relaxed);
+    UpdateWriteStats();
+}
+
+bool Recorder::SyncAll() {
+    // Each sync also rewrites the header, so a crash leaves files playable
+    // up to the last sync
+    for (std::unique_ptr<WavWriter>& writer : writers_) {
+        if (!writer->Sync()) {
+            Fail("Sync failed");
+            return false;
+        }
+    }
+    UpdateWriteStats();
+    syncs_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void Recorder::UpdateWriteStats() {
+    uint64_t bytes = 0;
+    double maxWriteMs = 0;
+    for (const std::unique_ptr<WavWriter>& writer : writers_) {
+        bytes += writer->DataBytes();
+        maxWriteMs = std::max(maxWriteMs, writer->MaxWriteMs());
+    }
+    bytesWritten_.store(bytes, std::memory_order_relaxed);
+    maxWriteMs_.store(maxWriteMs, std::memory_order_relaxed);
+}
+
+void Recorder::Fail(const std::string& message) {
+    if (!failed_.load(std::memory_order_relaxed)) {
+        error_ = message;
+        failed_.store(true, std::memory_order_release);
+    }
+}
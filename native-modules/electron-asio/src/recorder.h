@@ -0,0 +1,111 @@
+/**
+ * Recorder - native multitrack recording to WAV/RF64
+ *
+ * The audio thread deinterleaves each period into a lock-free ring, one
+ * lane per channel. A dedicated writer thread drains the ring into one
+ * WavWriter per file (large aligned writes, preallocation, RF64 past 4 GB)
+ * and syncs them to disk in batches.
+ *
+ * A period that does not fit in the ring is dropped whole, and the same
+ * number of silent frames is written once there is room again, so every
+ * channel keeps its timeline however far the disk falls behind.
+ */
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "sample_format.h"
+#include "spsc_ring.h"
+#include "wav_writer.h"
+
+struct RecorderConfig {
+    double sampleRate = 48000;
+    int channels = 2;
+    SampleFormat format = SampleFormat::Int24;  // Int16, Int24 or Float32
+    bool dither = false;                // TPDF dither for integer formats
+    bool split = false;                 // One mono file per channel
+    double ringSeconds = 4;             // Audio buffered against disk stalls
+    size_t writeBlockBytes = 1 << 20;   // Bytes per file write (multiple of 4 KiB)
+    double syncIntervalMs = 2000;       // 0 = sync only when stopping
+    double preallocateSeconds = 60;     // File space reserved ahead of the data
+};
+
+struct RecorderSummary {
+    std::vector<std::string> files;
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    uint64_t droppedFrames = 0;
+    std::string error;
+};
+
+class Recorder {
+public:
+    Recorder();
+    ~Recorder();
+
+    // JS thread: create the files and start the writer thread. Returns
+    // false with error set when a file cannot be created.
+    bool Start(const std::string& path, const RecorderConfig& config, std::string* error);
+    // JS thread: write out everything queued, finalize the headers and
+    // close the files. The audio thread must no longer call Push.
+    void Finish(RecorderSummary* summary);
+
+    // Audio thread: queue one period of interleaved or planar input
+    void Push(const void* input, size_t frames, bool planar);
+
+    // Any thread
+    const RecorderConfig& Config() const { return config_; }
+    const std::vector<std::string>& Files() const { return paths_; }
+    size_t RingFrames() const { return ring_.Capacity(); }
+    size_t RingFill() const { return ring_.ReadAvailable(); }
+    size_t RingHighWater() const { return highWater_.load(std::memory_order_relaxed); }
+    uint64_t FramesWritten() const { return framesWritten_.load(std::memory_order_relaxed); }
+    uint64_t BytesWritten() const { return bytesWritten_.load(std::memory_order_relaxed); }
+    uint64_t DroppedFrames() const { return droppedFrames_.load(std::memory_order_relaxed); }
+    double Throughput() const { return throughput_.load(std::memory_order_relaxed); }
+    double MaxWriteMs() const { return maxWriteMs_.load(std::memory_order_relaxed); }
+    uint64_t Syncs() const { return syncs_.load(std::memory_order_relaxed); }
+    bool Failed() const { return failed_.load(std::memory_order_acquire); }
+    // Valid once Failed() is true
+    const std::string& Error() const { return error_; }
+
+private:
+    void Run();
+    void Convert(size_t offset, size_t frames);
+    bool SyncAll();
+    void UpdateWriteStats();
+    void Fail(const std::string& message);
+
+    RecorderConfig config_;
+    std::vector<std::string> paths_;
+    std::vector<std::unique_ptr<WavWriter>> writers_;   // One per file
+
+    // Audio thread state
+    SpscRing<float> ring_;
+    std::vector<float*> pushPtrs_;
+    size_t pendingSilence_;             // Dropped frames still to be filled in
+
+    // Writer thread state
+    std::thread thread_;
+    std::atomic<bool> stopping_;
+    std::vector<const float*> readPtrs_;    // Ring lanes at the read position
+    std::string error_;
+
+    std::atomic<size_t> highWater_;
+    std::atomic<uint64_t> framesWritten_;
+    std::atomic<uint64_t> bytesWritten_;
+    std::atomic<uint64_t> droppedFrames_;
+    std::atomic<double> throughput_;    // Bytes per second over the last second
+    std::atomic<double> maxWriteMs_;
+    std::atomic<uint64_t> syncs_;
+    std::atomic<bool> failed_;
+};
+
+#endif // RECORDER_H
@@ -0,0 +1,204 @@
+/**
+ * PolyphaseResampler implementation
+ */
+
+#include "resampler.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace kernels {
+
+float DotProductScalar(const float* a, const float* b, size_t count) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+#if ASIO_HAVE_SSE2
+
+static float DotProductSse2(const float* a, const float* b, size_t count) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (size_t i = 0; i < count; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 sum = _mm_add_ps(acc0, acc1);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+#endif // ASIO_HAVE_SSE2
+
+#if ASIO_HAVE_AVX2
+
+ASIO_TARGET_AVX2
+static float DotProductAvx2(const float* a, const float* b, size_t count) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    if (i < count) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    __m256 sum8 = _mm256_add_ps(acc0, acc1);
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(sum8), _mm256_extractf128_ps(sum8, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+#endif // ASIO_HAVE_AVX2
+
+float DotProduct(const float* a, const float* b, size_t count) {
+#if ASIO_HAVE_AVX2
+    if (simd::HasAvx2()) {
+        return DotProductAvx2(a, b, count);
+    }
+#endif
+#if ASIO_HAVE_SSE2
+    return DotProductSse2(a, b, count);
+#else
+    return DotProductScalar(a, b, count);
+#endif
+}
+
+} // namespace kernels
+
+// Zeroth-order modified Bessel function, for the Kaiser window
+static double BesselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 64; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+static uint32_t Gcd(uint32_t a, uint32_t b) {
+    while (b) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+PolyphaseResampler::PolyphaseResampler()
+    : taps_(0), interpolation_(1), decimation_(1), phaseCount_(1) {}
+
+void PolyphaseResampler::Reset(double inputRate, double outputRate, int channels, ResampleQuality quality) {
+    uint32_t in = static_cast<uint32_t>(std::lround(inputRate));
+    uint32_t out = static_cast<uint32_t>(std::lround(outputRate));
+    if (in == 0 || out == 0) {
+        in = out = 1;
+    }
+    uint32_t g = Gcd(in, out);
+    interpolation_ = out / g;
+    decimation_ = in / g;
+    phaseCount_ = interpolation_ < kMaxPhases ? interpolation_ : static_cast<uint32_t>(kMaxPhases);
+
+    double rolloff, beta;
+    switch (quality) {
+        case ResampleQuality::Low:    taps_ = 16; rolloff = 0.85; beta = 6.0;  break;
+        case ResampleQuality::High:   taps_ = 64; rolloff = 0.95; beta = 10.0; break;
+        default:                      taps_ = 32; rolloff = 0.91; beta = 8.0;  break;
+    }
+
+    // Cutoff in cycles per input sample: below the lower of the two Nyquists
+    double ratio = static_cast<double>(interpolation_) / static_cast<double>(decimation_);
+    double cutoff = 0.5 * std::min(1.0, ratio) * rolloff;
+    double half = taps_ / 2.0;
+    double windowNorm = BesselI0(beta);
+    const double pi = 3.14159265358979323846;
+
+    // Phase p covers outputs landing p/phaseCount_ of the way past an input
+    // sample; one extra table lets a rounded-up phase land on 1.0
+    coefficients_.assign(static_cast<size_t>(phaseCount_ + 1) * taps_, 0.0f);
+    std::vector<double> h(taps_);
+    for (uint32_t p = 0; p <= phaseCount_; p++) {
+        float* c = coefficients_.data() + static_cast<size_t>(p) * taps_;
+        double offset = static_cast<double>(p) / phaseCount_;
+        double sum = 0.0;
+        for (int k = 0; k < taps_; k++) {
+            double t = offset + half - 1.0 - k;
+            double x = 2.0 * cutoff * t;
+            double sinc = std::fabs(x) < 1e-12 ? 1.0 : std::sin(pi * x) / (pi * x);
+            double u = t / half;
+            double window = std::fabs(u) >= 1.0 ? 0.0 : BesselI0(beta * std::sqrt(1.0 - u * u)) / windowNorm;
+            h[k] = 2.0 * cutoff * sinc * window;
+            sum += h[k];
+        }
+        // Unity gain at DC for every phase
+        for (int k = 0; k < taps_; k++) {
+            c[k] = static_cast<float>(h[k] / sum);
+        }
+    }
+
+    // Prime with half a filter of silence so output 0 lines up with input 0
+    state_.assign(channels > 0 ? channels : 0, ChannelState());
+    for (ChannelState& s : state_) {
+        s.count = static_cast<size_t>(taps_ / 2 - 1);
+        s.history.assign(s.count, 0.0f);
+        s.base = 0;
+        s.phase = 0;
+    }
+}
+
+const float* PolyphaseResampler::Coefficients(uint32_t phase) const {
+    uint32_t index = phase;
+    if (phaseCount_ != interpolation_) {
+        // Nearest of the quantized phases
+        index = static_cast<uint32_t>((static_cast<uint64_t>(phase) * phaseCount_ + interpolation_ / 2) / interpolation_);
+    }
+    return coefficients_.data() + static_cast<size_t>(index) * taps_;
+}
+
+size_t PolyphaseResampler::OutputFrames(size_t inputFrames) const {
+    if (state_.empty()) {
+        return 0;
+    }
+    const ChannelState& s = state_[0];
+    // Outputs j whose first tap base + floor((phase + j*M) / L) still has a
+    // full window of input behind it
+    int64_t avail = static_cast<int64_t>(s.count + inputFrames) - taps_ - static_cast<int64_t>(s.base);
+    if (avail < 0) {
+        return 0;
+    }
+    uint64_t span = static_cast<uint64_t>(avail + 1) * interpolation_ - s.phase;
+    return static_cast<size_t>((span + decimation_ - 1) / decimation_);
+}
+
+size_t PolyphaseResampler::Process(int channel, const float* input, size_t inputFrames, float* output) {
+    ChannelState& s = state_[channel];
+    if (s.history.size() < s.count + inputFrames) {
+        s.history.resize(s.count + inputFrames);
+    }
+    std::memcpy(s.history.data() + s.count, input, inputFrames * sizeof(float));
+    s.count += inputFrames;
+
+    size_t written = 0;
+    const float* history = s.history.data();
+    while (s.base + taps_ <= s.count) {
+        output[written++] = kernels::DotProduct(history + s.base, Coefficients(s.phase), taps_);
+        s.phase += decimation_;
+        s.base += s.phase / interpolation_;
+        s.phase %= interpolation_;
+    }
+
+    // Keep the unconsumed tail; a large decimation can step past the end
+    size_t keep = s.base < s.count ? s.count - s.base : 0;
+    std::memmove(s.history.data(), s.history.data() + (s.count - keep), keep * sizeof(float));
+    s.base = s.base > s.count ? s.base - s.count : 0;
+    s.count = keep;
+    return written;
+}
@@ -0,0 +1,72 @@
+/**
+ * PolyphaseResampler - windowed-sinc sample-rate conversion for delivery
+ *
+ * Converts between integer rates related by a ratio L/M (44.1k -> 48k is
+ * 160/147). Each of up to kMaxPhases filter phases is a Kaiser-windowed sinc
+ * of a fixed tap count; the inner loop is one SIMD dot product per output
+ * sample. Channels keep independent state so they can be processed on
+ * different threads.
+ */
+
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class ResampleQuality {
+    Low,        // 16 taps
+    Medium,     // 32 taps
+    High        // 64 taps
+};
+
+namespace kernels {
+
+// Sum of a[i] * b[i]; count must be a multiple of 8
+float DotProduct(const float* a, const float* b, size_t count);
+float DotProductScalar(const float* a, const float* b, size_t count);
+
+} // namespace kernels
+
+class PolyphaseResampler {
+public:
+    static const uint32_t kMaxPhases = 1024;
+
+    PolyphaseResampler();
+
+    // Not thread safe. Rates are rounded to whole hertz.
+    void Reset(double inputRate, double outputRate, int channels, ResampleQuality quality);
+
+    int Channels() const { return static_cast<int>(state_.size()); }
+    int Taps() const { return taps_; }
+    uint32_t Interpolation() const { return interpolation_; }
+    uint32_t Decimation() const { return decimation_; }
+
+    // Exact number of frames the next Process call on any channel yields
+    // for inputFrames of input (all channels advance in lockstep)
+    size_t OutputFrames(size_t inputFrames) const;
+
+    // Resample one channel; out must hold OutputFrames(inputFrames). Calls
+    // for different channels may run concurrently. Returns frames written.
+    size_t Process(int channel, const float* input, size_t inputFrames, float* output);
+
+private:
+    struct ChannelState {
+        std::vector<float> history;     // Pending input, oldest first
+        size_t count;                   // Valid samples in history
+        size_t base;                    // First tap of the next output
+        uint32_t phase;                 // Fractional position, in 1/L
+    };
+
+    const float* Coefficients(uint32_t phase) const;
+
+    int taps_;
+    uint32_t interpolation_;    // L
+    uint32_t decimation_;       // M
+    uint32_t phaseCount_;       // Filter tables: L, or kMaxPhases when L is larger
+    std::vector<float> coefficients_;   // (phaseCount_ + 1) x taps_
+    std::vector<ChannelState> state_;
+};
+
+#endif // RESAMPLER_H
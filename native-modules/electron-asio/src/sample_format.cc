@@ -0,0 +1,199 @@
+/**
+ * Sample format conversion kernels
+ */
+
+#include "sample_format.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void DitherState::Seed(uint32_t seed) {
+    // xorshift must never start at zero
+    for (int i = 0; i < 8; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        lanes[i] = seed ? seed : 0x9e3779b9u;
+    }
+}
+
+namespace kernels {
+
+static inline uint32_t NextRandom(uint32_t& x) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+// Triangular noise in (-1, 1) LSB
+static inline float TpdfScalar(DitherState* dither) {
+    const float unit = 1.0f / 16777216.0f;
+    float a = static_cast<float>(NextRandom(dither->lanes[0]) >> 8) * unit;
+    float b = static_cast<float>(NextRandom(dither->lanes[4]) >> 8) * unit;
+    return a - b;
+}
+
+static inline int32_t ConvertScalar(float x, float scale, float lo, float hi, DitherState* dither) {
+    float v = x * scale;
+    if (dither) v += TpdfScalar(dither);
+    v = std::min(std::max(v, lo), hi);
+    return static_cast<int32_t>(std::lrintf(v));
+}
+
+#if ASIO_HAVE_SSE2
+
+static inline __m128i NextRandom4(__m128i& x) {
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+    return x;
+}
+
+static inline __m128 Tpdf4(__m128i& a, __m128i& b) {
+    const __m128 unit = _mm_set1_ps(1.0f / 16777216.0f);
+    __m128 ua = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(NextRandom4(a), 8)), unit);
+    __m128 ub = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(NextRandom4(b), 8)), unit);
+    return _mm_sub_ps(ua, ub);
+}
+
+// Scale, dither, clip and round four samples to int32 (round to nearest
+// under the default MXCSR mode)
+static inline __m128i Convert4(const float* src, __m128 scale, __m128 lo, __m128 hi,
+                               bool dither, __m128i& ra, __m128i& rb) {
+    __m128 v = _mm_mul_ps(_mm_loadu_ps(src), scale);
+    if (dither) v = _mm_add_ps(v, Tpdf4(ra, rb));
+    v = _mm_min_ps(_mm_max_ps(v, lo), hi);
+    return _mm_cvtps_epi32(v);
+}
+
+#endif // ASIO_HAVE_SSE2
+
+void FloatToInt16(const float* src, int16_t* dst, size_t count, DitherState* dither) {
+    const float scale = 32767.0f, lo = -32768.0f, hi = 32767.0f;
+    size_t i = 0;
+#if ASIO_HAVE_SSE2
+    __m128i ra = _mm_setzero_si128(), rb = _mm_setzero_si128();
+    if (dither) {
+        ra = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dither->lanes));
+        rb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dither->lanes + 4));
+    }
+    const __m128 vscale = _mm_set1_ps(scale), vlo = _mm_set1_ps(lo), vhi = _mm_set1_ps(hi);
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = Convert4(src + i, vscale, vlo, vhi, dither != nullptr, ra, rb);
+        __m128i b = Convert4(src + i + 4, vscale, vlo, vhi, dither != nullptr, ra, rb);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(a, b));
+    }
+    if (dither) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dither->lanes), ra);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dither->lanes + 4), rb);
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = static_cast<int16_t>(ConvertScalar(src[i], scale, lo, hi, dither));
+    }
+}
+
+void FloatToInt24(const float* src, uint8_t* dst, size_t count, DitherState* dither) {
+    const float scale = 8388607.0f, lo = -8388608.0f, hi = 8388607.0f;
+    size_t i = 0;
+#if ASIO_HAVE_SSE2
+    __m128i ra = _mm_setzero_si128(), rb = _mm_setzero_si128();
+    if (dither) {
+        ra = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dither->lanes));
+        rb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dither->lanes + 4));
+    }
+    const __m128 vscale = _mm_set1_ps(scale), vlo = _mm_set1_ps(lo), vhi = _mm_set1_ps(hi);
+    alignas(16) int32_t tmp[4];
+    for (; i + 4 <= count; i += 4) {
+        _mm_store_si128(reinterpret_cast<__m128i*>(tmp),
+                        Convert4(src + i, vscale, vlo, vhi, dither != nullptr, ra, rb));
+        // SSE2 has no byte shuffle; pack the low three bytes of each lane
+        uint8_t* out = dst + i * 3;
+        for (int k = 0; k < 4; k++) {
+            uint32_t v = static_cast<uint32_t>(tmp[k]);
+            out[k * 3] = static_cast<uint8_t>(v);
+            out[k * 3 + 1] = static_cast<uint8_t>(v >> 8);
+            out[k * 3 + 2] = static_cast<uint8_t>(v >> 16);
+        }
+    }
+    if (dither) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dither->lanes), ra);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dither->lanes + 4), rb);
+    }
+#endif
+    for (; i < count; i++) {
+        uint32_t v = static_cast<uint32_t>(ConvertScalar(src[i], scale, lo, hi, dither));
+        dst[i * 3] = static_cast<uint8_t>(v);
+        dst[i * 3 + 1] = static_cast<uint8_t>(v >> 8);
+        dst[i * 3 + 2] = static_cast<uint8_t>(v >> 16);
+    }
+}
+
+uint16_t FloatToHalfScalar(float value) {
+    uint32_t f;
+    std::memcpy(&f, &value, sizeof(f));
+    uint32_t sign = (f >> 16) & 0x8000;
+    uint32_t exponent = (f >> 23) & 0xff;
+    uint32_t mantissa = f & 0x7fffff;
+
+    if (exponent == 0xff) {
+        // Infinity stays infinity; NaN stays a quiet NaN
+        return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 | (mantissa >> 13) : 0));
+    }
+
+    int e = static_cast<int>(exponent) - 127 + 15;
+    if (e >= 0x1f) {
+        return static_cast<uint16_t>(sign | 0x7c00);
+    }
+
+    uint32_t half, rem, mid;
+    if (e <= 0) {
+        // Subnormal half (or zero): shift the implicit-one mantissa down
+        if (e < -10) {
+            return static_cast<uint16_t>(sign);
+        }
+        mantissa |= 0x800000;
+        int shift = 14 - e;
+        half = mantissa >> shift;
+        rem = mantissa & ((1u << shift) - 1);
+        mid = 1u << (shift - 1);
+    } else {
+        half = (static_cast<uint32_t>(e) << 10) | (mantissa >> 13);
+        rem = mantissa & 0x1fff;
+        mid = 0x1000;
+    }
+
+    // Round to nearest even; a carry out of the mantissa bumps the exponent
+    if (rem > mid || (rem == mid && (half & 1))) {
+        half++;
+    }
+    return static_cast<uint16_t>(sign | half);
+}
+
+#if ASIO_HAVE_AVX2
+
+ASIO_TARGET_F16C
+static size_t FloatToHalfF16c(const float* src, uint16_t* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+    }
+    return i;
+}
+
+#endif // ASIO_HAVE_AVX2
+
+void FloatToHalf(const float* src, uint16_t* dst, size_t count) {
+    size_t i = 0;
+#if ASIO_HAVE_AVX2
+    if (simd::HasF16c()) {
+        i = FloatToHalfF16c(src, dst, count);
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = FloatToHalfScalar(src[i]);
+    }
+}
+
+} // namespace kernels
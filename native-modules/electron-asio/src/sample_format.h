@@ -0,0 +1,51 @@
+/**
+ * Float to delivery-format sample conversion
+ *
+ * Converts float32 channel data to 16-bit PCM, packed little-endian 24-bit
+ * PCM or IEEE half floats, with clipping and optional TPDF dither, so
+ * consumers that want integer PCM receive it at its final size.
+ */
+
+#ifndef SAMPLE_FORMAT_H
+#define SAMPLE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+enum class SampleFormat {
+    Float32,
+    Int16,
+    Int24,      // Packed: 3 bytes per sample, little endian
+    Float16     // IEEE 754 binary16 bit patterns
+};
+
+inline size_t BytesPerSample(SampleFormat format) {
+    switch (format) {
+        case SampleFormat::Int16: return 2;
+        case SampleFormat::Int24: return 3;
+        case SampleFormat::Float16: return 2;
+        default: return 4;
+    }
+}
+
+// Per-stream dither generator: four xorshift32 lanes per uniform source,
+// two sources summed into a triangular distribution
+struct DitherState {
+    uint32_t lanes[8];
+    void Seed(uint32_t seed);
+};
+
+namespace kernels {
+
+// Scale to full range, add TPDF dither of +/-1 LSB when dither is non-null,
+// round to nearest and clip
+void FloatToInt16(const float* src, int16_t* dst, size_t count, DitherState* dither);
+void FloatToInt24(const float* src, uint8_t* dst, size_t count, DitherState* dither);
+
+// Round to nearest even; out-of-range values become infinities
+void FloatToHalf(const float* src, uint16_t* dst, size_t count);
+uint16_t FloatToHalfScalar(float value);
+
+} // namespace kernels
+
+#endif // SAMPLE_FORMAT_H
@@ -0,0 +1,94 @@
+/**
+ * SharedRingWriter implementation
+ */
+
+#include "shared_ring.h"
+#include "deinterleave.h"
+#include <algorithm>
+#include <cstring>
+
+// JS Atomics operate on plain 32-bit words; the native side must match
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "atomic<uint32_t> must be a plain word");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "atomic<uint32_t> must be lock free");
+
+namespace {
+const size_t kWriteIndex = 0;
+const size_t kReadIndex = 64;
+const size_t kCapacity = 128;
+const size_t kChannels = 132;
+const size_t kDroppedFrames = 140;
+}
+
+SharedRingWriter* SharedRingWriter::Attach(void* memory, size_t byteLength, int channels, const char** error) {
+    uint8_t* base = static_cast<uint8_t*>(memory);
+    if (!base || byteLength < kHeaderBytes || reinterpret_cast<uintptr_t>(base) % 8 != 0) {
+        *error = "Shared ring buffer is too small";
+        return nullptr;
+    }
+
+    uint32_t capacity, ringChannels;
+    std::memcpy(&capacity, base + kCapacity, sizeof(capacity));
+    std::memcpy(&ringChannels, base + kChannels, sizeof(ringChannels));
+
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        *error = "Shared ring capacity must be a power of two";
+        return nullptr;
+    }
+    if (static_cast<int>(ringChannels) != channels) {
+        *error = "Shared ring channel count does not match the stream";
+        return nullptr;
+    }
+    if (byteLength < kHeaderBytes + static_cast<size_t>(capacity) * ringChannels * sizeof(float)) {
+        *error = "Shared ring buffer is smaller than its header describes";
+        return nullptr;
+    }
+
+    return new SharedRingWriter(base, capacity, channels);
+}
+
+SharedRingWriter::SharedRingWriter(uint8_t* memory, size_t capacity, int channels)
+    : memory_(memory),
+      data_(reinterpret_cast<float*>(memory + kHeaderBytes)),
+      capacity_(capacity),
+      mask_(static_cast<uint32_t>(capacity - 1)),
+      channels_(channels),
+      lanes_(channels) {}
+
+bool SharedRingWriter::Write(const void* input, size_t frames, bool planar) {
+    uint32_t w = Index(kWriteIndex)->load(std::memory_order_relaxed);
+    uint32_t r = Index(kReadIndex)->load(std::memory_order_acquire);
+    size_t free = capacity_ - static_cast<uint32_t>(w - r);
+    if (frames > free) {
+        Index(kDroppedFrames)->fetch_add(static_cast<uint32_t>(frames), std::memory_order_relaxed);
+        return false;
+    }
+
+    size_t offset = w & mask_;
+    size_t head = std::min(frames, capacity_ - offset);
+    size_t tail = frames - head;
+
+    if (planar) {
+        const float* const* in = static_cast<const float* const*>(input);
+        for (int ch = 0; ch < channels_; ch++) {
+            float* lane = data_ + ch * capacity_;
+            std::memcpy(lane + offset, in[ch], head * sizeof(float));
+            std::memcpy(lane, in[ch] + head, tail * sizeof(float));
+        }
+    } else {
+        // Deinterleave straight into the lanes, in two parts around the wrap
+        const float* in = static_cast<const float*>(input);
+        for (int ch = 0; ch < channels_; ch++) {
+            lanes_[ch] = data_ + ch * capacity_ + offset;
+        }
+        kernels::Deinterleave(in, lanes_.data(), head, channels_);
+        if (tail > 0) {
+            for (int ch = 0; ch < channels_; ch++) {
+                lanes_[ch] = data_ + ch * capacity_;
+            }
+            kernels::Deinterleave(in + head * channels_, lanes_.data(), tail, channels_);
+        }
+    }
+
+    Index(kWriteIndex)->store(w + static_cast<uint32_t>(frames), std::memory_order_release);
+    return true;
+}
@@ -0,0 +1,57 @@
+/**
+ * SharedRingWriter - audio-thread producer for a SharedArrayBuffer ring
+ *
+ * The ring lives in memory owned by JavaScript (a SharedArrayBuffer), so a
+ * renderer thread or AudioWorklet in the same process can consume it with
+ * Atomics and no per-block messaging. The layout is shared with
+ * lib/shared-ring.js:
+ *
+ *   byte   0  uint32 writeIndex    (frames, wraps at 2^32; producer)
+ *   byte  64  uint32 readIndex     (frames, wraps at 2^32; consumer)
+ *   byte 128  uint32 capacity      (frames per channel, power of two)
+ *   byte 132  uint32 channels
+ *   byte 136  uint32 sampleRate
+ *   byte 140  uint32 droppedFrames (periods skipped because the ring was full)
+ *   byte 192  float32 data, one lane of `capacity` frames per channel
+ */
+
+#ifndef SHARED_RING_H
+#define SHARED_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class SharedRingWriter {
+public:
+    static const size_t kHeaderBytes = 192;
+
+    // Validate the header at memory and bind to it. Returns nullptr (and
+    // sets *error) if the layout does not describe a usable ring.
+    static SharedRingWriter* Attach(void* memory, size_t byteLength, int channels, const char** error);
+
+    int Channels() const { return channels_; }
+    size_t Capacity() const { return capacity_; }
+
+    // Audio thread: append frames of interleaved or planar input. The whole
+    // period is skipped if it does not fit, so the reader never sees a torn
+    // period. Returns false when frames were dropped.
+    bool Write(const void* input, size_t frames, bool planar);
+
+private:
+    SharedRingWriter(uint8_t* memory, size_t capacity, int channels);
+
+    std::atomic<uint32_t>* Index(size_t byteOffset) const {
+        return reinterpret_cast<std::atomic<uint32_t>*>(memory_ + byteOffset);
+    }
+
+    uint8_t* memory_;
+    float* data_;
+    size_t capacity_;
+    uint32_t mask_;
+    int channels_;
+    std::vector<float*> lanes_;     // Scratch destination pointers
+};
+
+#endif // SHARED_RING_H
@@ -0,0 +1,92 @@
+/**
+ * SIMD helpers shared by the sample kernels
+ *
+ * SSE2 is the x64 baseline and is used unconditionally there. AVX2 code is
+ * compiled per function and only called after a runtime CPU check, so the
+ * addon still loads on older machines.
+ */
+
+#ifndef ASIO_SIMD_H
+#define ASIO_SIMD_H
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ASIO_HAVE_SSE2 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#else
+#define ASIO_HAVE_SSE2 0
+#endif
+
+#if ASIO_HAVE_SSE2 && (defined(_MSC_VER) || defined(__GNUC__) || defined(__clang__))
+#define ASIO_HAVE_AVX2 1
+#else
+#define ASIO_HAVE_AVX2 0
+#endif
+
+// MSVC emits AVX2 intrinsics without per-function opt-in; GCC/Clang need it
+#if ASIO_HAVE_AVX2 && !defined(_MSC_VER)
+#define ASIO_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define ASIO_TARGET_F16C __attribute__((target("avx,f16c")))
+#else
+#define ASIO_TARGET_AVX2
+#define ASIO_TARGET_F16C
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace simd {
+
+// True when both the CPU and the OS (saved YMM state) support AVX2
+inline bool HasAvx2() {
+#if ASIO_HAVE_AVX2
+    static const bool supported = [] {
+#if defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 0);
+        if (regs[0] < 7) return false;
+        __cpuid(regs, 1);
+        bool osxsave = (regs[2] & (1 << 27)) != 0;
+        bool avx = (regs[2] & (1 << 28)) != 0;
+        bool fma = (regs[2] & (1 << 12)) != 0;
+        if (!osxsave || !avx || !fma) return false;
+        if ((_xgetbv(0) & 0x6) != 0x6) return false;
+        __cpuidex(regs, 7, 0);
+        return (regs[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+// True when the CPU has the F16C half-precision conversions (and AVX state)
+inline bool HasF16c() {
+#if ASIO_HAVE_AVX2
+    static const bool supported = [] {
+#if defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 1);
+        bool osxsave = (regs[2] & (1 << 27)) != 0;
+        bool avx = (regs[2] & (1 << 28)) != 0;
+        bool f16c = (regs[2] & (1 << 29)) != 0;
+        return osxsave && avx && f16c && (_xgetbv(0) & 0x6) == 0x6;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+#endif
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+} // namespace simd
+
+#endif // ASIO_SIMD_H
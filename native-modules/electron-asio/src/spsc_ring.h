@@ -0,0 +1,244 @@
+/**
+ * SpscRing - wait-free single-producer/single-consumer ring buffer
+ *
+ * One thread writes, one thread reads; neither ever blocks or takes a lock.
+ * Indices increase monotonically and are masked into a power-of-two buffer,
+ * so a consume is O(1) regardless of how much data is queued.
+ *
+ * A ring may carry several lanes (e.g. one per channel) that share a single
+ * pair of indices, so planar audio moves with one memcpy per lane.
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#ifndef ASIO_CACHE_LINE_SIZE
+#define ASIO_CACHE_LINE_SIZE 64
+#endif
+
+template <typename T>
+class SpscRing {
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRing requires trivially copyable elements");
+
+public:
+    SpscRing() : capacity_(0), mask_(0), lanes_(1), writeIndex_(0), readIndex_(0) {}
+
+    // Allocate storage for at least minCapacity elements per lane. Not thread
+    // safe: call only while neither side is running.
+    void Reset(size_t minCapacity, size_t lanes = 1) {
+        size_t capacity = 1;
+        while (capacity < minCapacity) {
+            capacity <<= 1;
+        }
+        capacity_ = minCapacity > 0 ? capacity : 0;
+        mask_ = minCapacity > 0 ? capacity - 1 : 0;
+        lanes_ = lanes > 0 ? lanes : 1;
+        buffer_.assign(capacity_ * lanes_, T());
+        writeIndex_.store(0, std::memory_order_relaxed);
+        readIndex_.store(0, std::memory_order_relaxed);
+    }
+
+    // Elements per lane
+    size_t Capacity() const { return capacity_; }
+    size_t Lanes() const { return lanes_; }
+
+    // Elements ready to be read (exact for the consumer, a snapshot otherwise)
+    size_t ReadAvailable() const {
+        return writeIndex_.load(std::memory_order_acquire) - readIndex_.load(std::memory_order_acquire);
+    }
+
+    // Free space (exact for the producer, a snapshot otherwise)
+    size_t WriteAvailable() const {
+        return Capacity() - ReadAvailable();
+    }
+
+    // Producer: copy up to count elements in, returns the number written
+    size_t Write(const T* src, size_t count) {
+        T* first;
+        T* second;
+        size_t firstLen, secondLen;
+        size_t n = std::min(count, PrepareWrite(&first, &firstLen, &second, &secondLen));
+        size_t a = std::min(n, firstLen);
+        std::memcpy(first, src, a * sizeof(T));
+        if (n > a) {
+            std::memcpy(second, src + a, (n - a) * sizeof(T));
+        }
+        CommitWrite(n);
+        return n;
+    }
+
+    // Consumer: copy up to count elements out, returns the number read
+    size_t Read(T* dst, size_t count) {
+        const T* first;
+        const T* second;
+        size_t firstLen, secondLen;
+        size_t n = std::min(count, PrepareRead(&first, &firstLen, &second, &secondLen));
+        size_t a = std::min(n, firstLen);
+        std::memcpy(dst, first, a * sizeof(T));
+        if (n > a) {
+            std::memcpy(dst + a, second, (n - a) * sizeof(T));
+        }
+        CommitRead(n);
+        return n;
+    }
+
+    // Producer: expose the free space as (up to) two contiguous regions so
+    // callers can fill it in place. Returns total writable elements.
+    size_t PrepareWrite(T** first, size_t* firstLen, T** second, size_t* secondLen) {
+        size_t w = writeIndex_.load(std::memory_order_relaxed);
+        size_t r = readIndex_.load(std::memory_order_acquire);
+        return Regions(w, Capacity() - (w - r), first, firstLen, second, secondLen);
+    }
+
+    void CommitWrite(size_t count) {
+        writeIndex_.store(writeIndex_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    // Consumer: expose the queued data as (up to) two contiguous regions
+    size_t PrepareRead(const T** first, size_t* firstLen, const T** second, size_t* secondLen) {
+        size_t r = readIndex_.load(std::memory_order_relaxed);
+        size_t w = writeIndex_.load(std::memory_order_acquire);
+        T* f;
+        T* s;
+        size_t n = Regions(r, w - r, &f, firstLen, &s, secondLen);
+        *first = f;
+        *second = s;
+        return n;
+    }
+
+    void CommitRead(size_t count) {
+        readIndex_.store(readIndex_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    // Multi-lane producer: copy count elements into every lane. A null source
+    // lane is written as zeros. Returns elements written per lane.
+    size_t WriteLanes(const T* const* src, size_t count) {
+        size_t offset, firstLen;
+        size_t n = std::min(count, PrepareWriteLanes(&offset, &firstLen));
+        size_t a = std::min(n, firstLen);
+        for (size_t lane = 0; lane < lanes_; lane++) {
+            T* base = Lane(lane);
+            if (src[lane]) {
+                std::memcpy(base + offset, src[lane], a * sizeof(T));
+                std::memcpy(base, src[lane] + a, (n - a) * sizeof(T));
+            } else {
+                std::fill(base + offset, base + offset + a, T());
+                std::fill(base, base + (n - a), T());
+            }
+        }
+        CommitWrite(n);
+        return n;
+    }
+
+    // Single-lane producer: interleave up to frames whole frames of channels
+    // sources into the free space. Source c supplies srcFrames[c] samples;
+    // a null or short source is padded with zeros. Returns frames written.
+    size_t WriteInterleaved(const T* const* src, const size_t* srcFrames, size_t channels, size_t frames) {
+        T* first;
+        T* second;
+        size_t firstLen, secondLen;
+        size_t n = std::min(frames, PrepareWrite(&first, &firstLen, &second, &secondLen) / channels);
+        if (n == 0) {
+            return 0;
+        }
+        for (size_t ch = 0; ch < channels; ch++) {
+            const T* in = src[ch];
+            size_t valid = in ? std::min(srcFrames[ch], n) : 0;
+
+            // Frames whose sample for this channel still fits before the wrap point
+            size_t split = firstLen > ch ? (firstLen - ch + channels - 1) / channels : 0;
+            split = std::min(split, n);
+
+            for (size_t i = 0; i < n; i++) {
+                T sample = i < valid ? in[i] : T();
+                if (i < split) {
+                    first[i * channels + ch] = sample;
+                } else {
+                    second[i * channels + ch - firstLen] = sample;
+                }
+            }
+        }
+        CommitWrite(n * channels);
+        return n;
+    }
+
+    // Multi-lane consumer: copy count elements out of every lane
+    size_t ReadLanes(T* const* dst, size_t count) {
+        size_t r = readIndex_.load(std::memory_order_relaxed);
+        size_t w = writeIndex_.load(std::memory_order_acquire);
+        size_t n = std::min(count, w - r);
+        if (n == 0) {
+            return 0;
+        }
+        size_t offset = r & mask_;
+        size_t a = std::min(n, capacity_ - offset);
+        for (size_t lane = 0; lane < lanes_; lane++) {
+            const T* base = Lane(lane);
+            std::memcpy(dst[lane], base + offset, a * sizeof(T));
+            std::memcpy(dst[lane] + a, base, (n - a) * sizeof(T));
+        }
+        CommitRead(n);
+        return n;
+    }
+
+    // Multi-lane producer: position of the next free slot in every lane and
+    // how many slots precede the wrap. Returns free elements per lane.
+    size_t PrepareWriteLanes(size_t* offset, size_t* firstLen) {
+        size_t w = writeIndex_.load(std::memory_order_relaxed);
+        size_t r = readIndex_.load(std::memory_order_acquire);
+        size_t free = capacity_ - (w - r);
+        *offset = capacity_ > 0 ? (w & mask_) : 0;
+        *firstLen = std::min(free, capacity_ - *offset);
+        return free;
+    }
+
+    // Multi-lane consumer: position of the oldest queued element in every
+    // lane and how many precede the wrap. Returns queued elements per lane.
+    size_t PrepareReadLanes(size_t* offset, size_t* firstLen) const {
+        size_t r = readIndex_.load(std::memory_order_relaxed);
+        size_t w = writeIndex_.load(std::memory_order_acquire);
+        size_t queued = w - r;
+        *offset = capacity_ > 0 ? (r & mask_) : 0;
+        *firstLen = std::min(queued, capacity_ - *offset);
+        return queued;
+    }
+
+    T* Lane(size_t lane) { return buffer_.data() + lane * capacity_; }
+    const T* Lane(size_t lane) const { return buffer_.data() + lane * capacity_; }
+
+private:
+    size_t Regions(size_t index, size_t count, T** first, size_t* firstLen, T** second, size_t* secondLen) {
+        if (buffer_.empty()) {
+            *first = *second = nullptr;
+            *firstLen = *secondLen = 0;
+            return 0;
+        }
+        size_t start = index & mask_;
+        size_t tail = capacity_ - start;
+        *first = buffer_.data() + start;
+        *firstLen = std::min(count, tail);
+        *second = buffer_.data();
+        *secondLen = count - *firstLen;
+        return count;
+    }
+
+    std::vector<T> buffer_;
+    size_t capacity_;
+    size_t mask_;
+    size_t lanes_;
+
+    // Producer and consumer indices live on separate cache lines so the two
+    // threads never false-share
+    alignas(ASIO_CACHE_LINE_SIZE) std::atomic<size_t> writeIndex_;
+    alignas(ASIO_CACHE_LINE_SIZE) std::atomic<size_t> readIndex_;
+    char padding_[ASIO_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,376 @@
+/**
+ * VirtualDevice implementation
+ */
+
+#include "virtual_device.h"
+#include "deinterleave.h"
+#include "resampler.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Sleep most of the way, then spin: OS sleeps overshoot by up to a
+// scheduler tick, which is longer than small audio periods
+void SleepUntil(Clock::time_point deadline) {
+    const auto spin = std::chrono::microseconds(500);
+    auto now = Clock::now();
+    if (deadline - now > spin) {
+        std::this_thread::sleep_until(deadline - spin);
+    }
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+uint32_t ReadLe(const uint8_t* p, int bytes) {
+    uint32_t v = 0;
+    for (int i = 0; i < bytes; i++) {
+        v |= static_cast<uint32_t>(p[i]) << (8 * i);
+    }
+    return v;
+}
+
+// Convert interleaved samples between rates, one channel at a time. Runs
+// once at open, so it favours quality over speed.
+void ResampleInterleaved(std::vector<float>* samples, int channels, double fromRate, double toRate) {
+    PolyphaseResampler resampler;
+    resampler.Reset(fromRate, toRate, channels, ResampleQuality::High);
+    size_t frames = samples->size() / channels;
+    size_t outFrames = resampler.OutputFrames(frames);
+
+    std::vector<float> in(frames);
+    std::vector<float> out(outFrames);
+    std::vector<float> result(outFrames * channels);
+    for (int ch = 0; ch < channels; ch++) {
+        for (size_t i = 0; i < frames; i++) {
+            in[i] = (*samples)[i * channels + ch];
+        }
+        size_t n = resampler.Process(ch, in.data(), frames, out.data());
+        for (size_t i = 0; i < n; i++) {
+            result[i * channels + ch] = out[i];
+        }
+    }
+    samples->swap(result);
+}
+
+} // namespace
+
+bool LoadWavFile(const std::string& path, std::vector<float>* samples, int* channels,
+                 double* sampleRate, std::string* error) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        *error = "Cannot open " + path;
+        return false;
+    }
+    std::vector<uint8_t> bytes;
+    uint8_t chunk[65536];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        bytes.insert(bytes.end(), chunk, chunk + n);
+    }
+    std::fclose(file);
+
+    if (bytes.size() < 12 || std::memcmp(bytes.data(), "RIFF", 4) != 0 ||
+        std::memcmp(bytes.data() + 8, "WAVE", 4) != 0) {
+        *error = path + " is not a WAV file";
+        return false;
+    }
+
+    uint32_t format = 0, bits = 0;
+    const uint8_t* data = nullptr;
+    size_t dataBytes = 0;
+    *channels = 0;
+    for (size_t pos = 12; pos + 8 <= bytes.size();) {
+        const uint8_t* header = bytes.data() + pos;
+        size_t size = ReadLe(header + 4, 4);
+        size_t body = pos + 8;
+        size_t avail = bytes.size() - body;
+        if (std::memcmp(header, "fmt ", 4) == 0 && size >= 16 && avail >= 16) {
+            format = ReadLe(header + 8, 2);
+            *channels = static_cast<int>(ReadLe(header + 10, 2));
+            *sampleRate = ReadLe(header + 12, 4);
+            bits = ReadLe(header + 22, 2);
+            // WAVE_FORMAT_EXTENSIBLE carries the real format in its subformat GUID
+            if (format == 0xfffe && size >= 40 && avail >= 40) {
+                format = ReadLe(header + 32, 2);
+            }
+        } else if (std::memcmp(header, "data", 4) == 0) {
+            data = bytes.data() + body;
+            dataBytes = size < avail ? size : avail;
+        }
+        pos = body + size + (size & 1);
+    }
+
+    bool pcm = format == 1 && (bits == 16 || bits == 24 || bits == 32);
+    bool ieee = format == 3 && bits == 32;
+    if (!data || *channels <= 0 || (!pcm && !ieee)) {
+        *error = path + ": only 16/24/32-bit PCM and 32-bit float WAV files are supported";
+        return false;
+    }
+
+    size_t width = bits / 8;
+    size_t count = dataBytes / width;
+    samples->resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* p = data + i * width;
+        if (ieee) {
+            std::memcpy(&(*samples)[i], p, sizeof(float));
+        } else {
+            // Left-align into 32 bits so the sign bit lands in place
+            int32_t v = static_cast<int32_t>(ReadLe(p, static_cast<int>(width)) << (32 - bits));
+            (*samples)[i] = static_cast<float>(v / 2147483648.0);
+        }
+    }
+    return true;
+}
+
+VirtualDevice::VirtualDevice()
+    : callback_(nullptr),
+      userData_(nullptr),
+      running_(false),
+      phase_(0),
+      position_(0),
+      random_(0x9e3779b9u),
+      fileChannels_(0),
+      fileFrames_(0),
+      cpuLoad_(0),
+      callbacks_(0),
+      missedDeadlines_(0),
+      captureOverruns_(0) {}
+
+VirtualDevice::~VirtualDevice() {
+    Stop();
+}
+
+bool VirtualDevice::Open(const VirtualDeviceConfig& config, PaStreamCallback* callback, void* userData,
+                         std::string* error) {
+    config_ = config;
+    if (config_.framesPerBuffer == 0) {
+        config_.framesPerBuffer = 256;
+    }
+    if (config_.impulseInterval == 0) {
+        config_.impulseInterval = static_cast<size_t>(config_.sampleRate);
+    }
+    callback_ = callback;
+    userData_ = userData;
+
+    if (config_.signal == VirtualSignal::File) {
+        double fileRate = 0;
+        if (!LoadWavFile(config_.file, &fileSamples_, &fileChannels_, &fileRate, error)) {
+            return false;
+        }
+        // Played at the device rate, a file recorded at another rate would
+        // come out at the wrong pitch and speed
+        if (fileRate > 0 && std::lround(fileRate) != std::lround(config_.sampleRate) && !fileSamples_.empty()) {
+            ResampleInterleaved(&fileSamples_, fileChannels_, fileRate, config_.sampleRate);
+        }
+        fileFrames_ = fileSamples_.size() / fileChannels_;
+        if (fileFrames_ == 0) {
+            config_.signal = VirtualSignal::Silence;
+        }
+    }
+
+    size_t frames = config_.framesPerBuffer;
+    input_.assign(frames * config_.inputChannels, 0.0f);
+    output_.assign(frames * config_.outputChannels, 0.0f);
+    inputPlanes_.resize(config_.inputChannels);
+    for (int ch = 0; ch < config_.inputChannels; ch++) {
+        inputPlanes_[ch] = input_.data() + ch * frames;
+    }
+    outputPlanes_.resize(config_.outputChannels);
+    for (int ch = 0; ch < config_.outputChannels; ch++) {
+        outputPlanes_[ch] = output_.data() + ch * frames;
+    }
+
+    size_t captureFrames = static_cast<size_t>(config_.captureSeconds * config_.sampleRate);
+    if (config_.outputChannels > 0 && captureFrames > 0) {
+        capture_.Reset(captureFrames, config_.outputChannels);
+        captureScratch_.assign(config_.planar ? 0 : frames * config_.outputChannels, 0.0f);
+        capturePlanes_.resize(config_.outputChannels);
+        for (int ch = 0; ch < config_.outputChannels; ch++) {
+            capturePlanes_[ch] = config_.planar ? outputPlanes_[ch] : captureScratch_.data() + ch * frames;
+        }
+    } else {
+        capture_.Reset(0);
+    }
+
+    phase_ = 0;
+    position_ = 0;
+    return true;
+}
+
+bool VirtualDevice::Start() {
+    if (running_.exchange(true)) {
+        return true;
+    }
+    // The previous run may have ended on its own after a non-continue result
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    thread_ = std::thread(&VirtualDevice::Run, this);
+    return true;
+}
+
+void VirtualDevice::Stop() {
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+size_t VirtualDevice::ReadCapture(float* const* dst, size_t frames) {
+    if (capture_.Capacity() == 0) {
+        return 0;
+    }
+    return capture_.ReadLanes(dst, frames);
+}
+
+uint32_t VirtualDevice::NextRandom() {
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 17;
+    random_ ^= random_ << 5;
+    return random_;
+}
+
+void VirtualDevice::Generate(size_t frames) {
+    int channels = config_.inputChannels;
+    if (channels == 0) {
+        return;
+    }
+    // Sample (frame i, channel ch) lives at i * step + ch * stride
+    size_t step = config_.planar ? 1 : static_cast<size_t>(channels);
+    size_t stride = config_.planar ? frames : 1;
+    float* out = input_.data();
+    float amplitude = static_cast<float>(config_.amplitude);
+
+    switch (config_.signal) {
+        case VirtualSignal::Silence:
+            std::memset(out, 0, frames * channels * sizeof(float));
+            break;
+        case VirtualSignal::Sine: {
+            const double twoPi = 6.28318530717958647692;
+            double increment = twoPi * config_.frequency / config_.sampleRate;
+            for (size_t i = 0; i < frames; i++) {
+                float v = amplitude * static_cast<float>(std::sin(phase_));
+                phase_ += increment;
+                for (int ch = 0; ch < channels; ch++) {
+                    out[i * step + ch * stride] = v;
+                }
+            }
+            phase_ = std::fmod(phase_, twoPi);
+            break;
+        }
+        case VirtualSignal::Noise:
+            for (size_t i = 0; i < frames; i++) {
+                for (int ch = 0; ch < channels; ch++) {
+                    float unit = static_cast<float>(NextRandom() >> 8) * (2.0f / 16777216.0f) - 1.0f;
+                    out[i * step + ch * stride] = amplitude * unit;
+                }
+            }
+            break;
+        case VirtualSignal::Impulse:
+            for (size_t i = 0; i < frames; i++) {
+                float v = (position_ + i) % config_.impulseInterval == 0 ? amplitude : 0.0f;
+                for (int ch = 0; ch < channels; ch++) {
+                    out[i * step + ch * stride] = v;
+                }
+            }
+            break;
+        case VirtualSignal::File:
+            for (size_t i = 0; i < frames; i++) {
+                const float* frame = fileSamples_.data() + ((position_ + i) % fileFrames_) * fileChannels_;
+                for (int ch = 0; ch < channels; ch++) {
+                    out[i * step + ch * stride] = frame[ch % fileChannels_];
+                }
+            }
+            break;
+    }
+    position_ += frames;
+}
+
+void VirtualDevice::Capture(size_t frames) {
+    if (capture_.Capacity() == 0) {
+        return;
+    }
+    if (!config_.planar) {
+        kernels::Deinterleave(output_.data(), capturePlanes_.data(), frames, config_.outputChannels);
+    }
+    // Keep the oldest audio; a consumer that stops reading loses the tail
+    if (capture_.WriteLanes(capturePlanes_.data(), frames) < frames) {
+        captureOverruns_++;
+    }
+}
+
+void VirtualDevice::Run() {
+    size_t frames = config_.framesPerBuffer;
+    double actualRate = config_.sampleRate * (1.0 + config_.clockPpm * 1e-6);
+    auto period = std::chrono::nanoseconds(static_cast<int64_t>(frames * 1e9 / actualRate));
+    auto jitterNanos = static_cast<uint32_t>(config_.jitterMs * 1e6);
+    auto start = Clock::now();
+    auto next = start + period;
+    uint64_t count = 0;
+    PaStreamCallbackFlags flags = 0;
+
+    const void* input = nullptr;
+    if (config_.inputChannels > 0) {
+        input = config_.planar ? static_cast<const void*>(inputPlanes_.data()) : input_.data();
+    }
+    void* output = nullptr;
+    if (config_.outputChannels > 0) {
+        output = config_.planar ? static_cast<void*>(outputPlanes_.data()) : output_.data();
+    }
+
+    while (running_.load(std::memory_order_relaxed)) {
+        auto wake = next;
+        if (jitterNanos > 0) {
+            wake += std::chrono::nanoseconds(NextRandom() % jitterNanos);
+        }
+        if (config_.missEvery > 0 && ++count % config_.missEvery == 0) {
+            // The driver was a period late: the data is flagged, and the
+            // next callback follows immediately to catch up
+            wake += period;
+            flags |= paInputOverflow | paOutputUnderflow;
+            missedDeadlines_++;
+        }
+        SleepUntil(wake);
+
+        Generate(frames);
+        auto begin = Clock::now();
+        double now = std::chrono::duration<double>(begin - start).count();
+        double periodSeconds = std::chrono::duration<double>(period).count();
+        PaStreamCallbackTimeInfo timeInfo;
+        timeInfo.currentTime = now;
+        timeInfo.inputBufferAdcTime = now - periodSeconds;
+        timeInfo.outputBufferDacTime = now + periodSeconds;
+
+        int result = callback_(input, output, static_cast<unsigned long>(frames), &timeInfo, flags, userData_);
+        flags = 0;
+        auto end = Clock::now();
+        Capture(frames);
+        callbacks_++;
+
+        double load = std::chrono::duration<double>(end - begin).count() / periodSeconds;
+        double smoothed = cpuLoad_.load(std::memory_order_relaxed);
+        cpuLoad_.store(smoothed + 0.1 * (load - smoothed), std::memory_order_relaxed);
+
+        if (result != paContinue) {
+            break;
+        }
+
+        // A callback (or host) slower than real time drops whole periods,
+        // as a device would, instead of bursting to catch up
+        next += period;
+        if (end > next + period) {
+            auto behind = (end - next) / period;
+            next += behind * period;
+            missedDeadlines_ += static_cast<uint64_t>(behind);
+            flags |= paInputOverflow | paOutputUnderflow;
+        }
+    }
+    running_ = false;
+}
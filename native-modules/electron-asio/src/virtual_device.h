@@ -0,0 +1,120 @@
+/**
+ * VirtualDevice - hardware-free stand-in for a PortAudio stream
+ *
+ * Drives the same PaStreamCallback a real device would, from a timer thread
+ * that wakes on absolute period deadlines (sleep, then a short spin for the
+ * last stretch). Input comes from a built-in signal generator or a looped
+ * WAV file; output is captured into a ring the JS thread can drain. Wake-up
+ * jitter and missed deadlines can be injected to exercise the delivery path
+ * under the conditions real drivers produce.
+ */
+
+#ifndef VIRTUAL_DEVICE_H
+#define VIRTUAL_DEVICE_H
+
+#include <portaudio.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "spsc_ring.h"
+
+enum class VirtualSignal {
+    Silence,
+    Sine,       // frequency, amplitude; same phase on every channel
+    Noise,      // White noise at amplitude, independent per channel
+    Impulse,    // One sample at amplitude every impulseInterval frames
+    File        // Looped WAV; channel n plays file channel n % fileChannels
+};
+
+struct VirtualDeviceConfig {
+    double sampleRate = 48000;
+    size_t framesPerBuffer = 256;
+    int inputChannels = 2;
+    int outputChannels = 0;
+    bool planar = false;
+
+    VirtualSignal signal = VirtualSignal::Sine;
+    double frequency = 440;
+    double amplitude = 0.5;
+    size_t impulseInterval = 0;     // 0 = once per second
+    std::string file;               // WAV path for VirtualSignal::File
+
+    double jitterMs = 0;            // Uniform extra wake-up delay per period
+    double clockPpm = 0;            // Crystal error: runs this much fast (+) or slow (-)
+    uint32_t missEvery = 0;         // Run every Nth callback one period late
+    double captureSeconds = 0;      // Output kept for ReadCapture
+};
+
+class VirtualDevice {
+public:
+    VirtualDevice();
+    ~VirtualDevice();
+
+    // Not thread safe: call while stopped. Returns false with error set when
+    // the file cannot be loaded.
+    bool Open(const VirtualDeviceConfig& config, PaStreamCallback* callback, void* userData,
+              std::string* error);
+
+    bool Start();
+    void Stop();
+    bool IsRunning() const { return running_.load(); }
+
+    const VirtualDeviceConfig& Config() const { return config_; }
+
+    // JS thread: move up to frames of captured output into one array per
+    // output channel. Returns frames read.
+    size_t ReadCapture(float* const* dst, size_t frames);
+    size_t CaptureAvailable() const { return capture_.ReadAvailable(); }
+
+    // Smoothed callback time as a fraction of the period
+    double CpuLoad() const { return cpuLoad_.load(std::memory_order_relaxed); }
+    uint64_t Callbacks() const { return callbacks_.load(std::memory_order_relaxed); }
+    uint64_t MissedDeadlines() const { return missedDeadlines_.load(std::memory_order_relaxed); }
+    uint64_t CaptureOverruns() const { return captureOverruns_.load(std::memory_order_relaxed); }
+
+private:
+    void Run();
+    void Generate(size_t frames);
+    void Capture(size_t frames);
+    uint32_t NextRandom();
+
+    VirtualDeviceConfig config_;
+    PaStreamCallback* callback_;
+    void* userData_;
+
+    std::thread thread_;
+    std::atomic<bool> running_;
+
+    // Device buffers, channel-major when planar
+    std::vector<float> input_;
+    std::vector<float> output_;
+    std::vector<const float*> inputPlanes_;
+    std::vector<float*> outputPlanes_;
+
+    // Generator state (timer thread only)
+    double phase_;
+    uint64_t position_;             // Frames generated so far
+    uint32_t random_;
+    std::vector<float> fileSamples_;    // Interleaved
+    int fileChannels_;
+    size_t fileFrames_;
+
+    // Output capture: one lane per output channel
+    SpscRing<float> capture_;
+    std::vector<float> captureScratch_;
+    std::vector<float*> capturePlanes_;
+
+    std::atomic<double> cpuLoad_;
+    std::atomic<uint64_t> callbacks_;
+    std::atomic<uint64_t> missedDeadlines_;
+    std::atomic<uint64_t> captureOverruns_;
+};
+
+// Read a PCM (16/24/32-bit) or float32 WAV file into interleaved floats
+bool LoadWavFile(const std::string& path, std::vector<float>* samples, int* channels,
+                 double* sampleRate, std::string* error);
+
+#endif // VIRTUAL_DEVICE_H
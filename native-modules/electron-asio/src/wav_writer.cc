@@ -0,0 +1,364 @@
+/**
+ * WavWriter implementation
+ */
+
+#include "wav_writer.h"
+#include "latency_histogram.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t kAlign = 4096;             // File offset and memory alignment of writes
+const size_t kHeaderBytes = kAlign;     // Header, padded so audio starts aligned
+const size_t kChunkFrames = 4096;       // Frames encoded per step
+const uint64_t kRiffLimit = 0xFFFFFFFFull;
+
+void PutLe(uint8_t* p, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        p[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+void PutTag(uint8_t* p, const char* tag) {
+    std::memcpy(p, tag, 4);
+}
+
+size_t AlignUp(size_t value) {
+    return (value + kAlign - 1) / kAlign * kAlign;
+}
+
+void Encode(const float* src, uint8_t* dst, size_t count, SampleFormat format, DitherState* dither) {
+    switch (format) {
+        case SampleFormat::Int16:
+            kernels::FloatToInt16(src, reinterpret_cast<int16_t*>(dst), count, dither);
+            break;
+        case SampleFormat::Int24:
+            kernels::FloatToInt24(src, dst, count, dither);
+            break;
+        default:
+            std::memcpy(dst, src, count * sizeof(float));
+            break;
+    }
+}
+
+} // namespace
+
+// Positioned writes, space reservation and sync on a native file handle
+class WavWriter::File {
+public:
+#if defined(_WIN32)
+    File() : handle_(INVALID_HANDLE_VALUE) {}
+#else
+    File() : fd_(-1) {}
+#endif
+    ~File() { Close(); }
+
+    bool Open(const std::string& path) {
+#if defined(_WIN32)
+        // UTF-8 from JS; the wide API handles any path
+        int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+        std::wstring wide(length > 0 ? length : 1, L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wide[0], length);
+        handle_ = CreateFileW(wide.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        return handle_ != INVALID_HANDLE_VALUE;
+#else
+        fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        return fd_ >= 0;
+#endif
+    }
+
+    bool WriteAt(uint64_t offset, const void* data, size_t bytes) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        while (bytes > 0) {
+#if defined(_WIN32)
+            OVERLAPPED position = {};
+            position.Offset = static_cast<DWORD>(offset);
+            position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD request = static_cast<DWORD>(std::min<size_t>(bytes, 1u << 30));
+            DWORD written = 0;
+            if (!WriteFile(handle_, p, request, &written, &position) || written == 0) {
+                return false;
+            }
+#else
+            ssize_t written = pwrite(fd_, p, bytes, static_cast<off_t>(offset));
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+#endif
+            p += written;
+            offset += written;
+            bytes -= written;
+        }
+        return true;
+    }
+
+    // Best effort: reserve space up to bytes without moving the end of file
+    void Reserve(uint64_t bytes) {
+#if defined(_WIN32)
+        FILE_ALLOCATION_INFO allocation;
+        allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(bytes);
+        SetFileInformationByHandle(handle_, FileAllocationInfo, &allocation, sizeof(allocation));
+#elif defined(__linux__)
+        fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(bytes));
+#elif defined(__APPLE__)
+        fstore_t store = { F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, static_cast<off_t>(bytes), 0 };
+        if (fcntl(fd_, F_PREALLOCATE, &store) < 0) {
+            store.fst_flags = F_ALLOCATEALL;
+            fcntl(fd_, F_PREALLOCATE, &store);
+        }
+#else
+        (void)bytes;
+#endif
+    }
+
+    bool Sync() {
+#if defined(_WIN32)
+        return FlushFileBuffers(handle_) != 0;
+#elif defined(__linux__)
+        return fdatasync(fd_) == 0;
+#else
+        return fsync(fd_) == 0;
+#endif
+    }
+
+    // Cut the file at bytes, releasing space reserved past the audio
+    bool Truncate(uint64_t bytes) {
+#if defined(_WIN32)
+        // Allocation past the end of file is released on close
+        (void)bytes;
+        return true;
+#else
+        return ftruncate(fd_, static_cast<off_t>(bytes)) == 0;
+#endif
+    }
+
+    void Close() {
+#if defined(_WIN32)
+        if (handle_ != INVALID_HANDLE_VALUE) {
+            CloseHandle(handle_);
+            handle_ = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+#endif
+    }
+
+private:
+#if defined(_WIN32)
+    HANDLE handle_;
+#else
+    int fd_;
+#endif
+};
+
+WavWriter::WavWriter()
+    : sampleRate_(0),
+      channels_(0),
+      format_(SampleFormat::Int24),
+      dither_(false),
+      frameBytes_(0),
+      blockBytes_(0),
+      reserveStep_(0),
+      allocated_(0),
+      dataBytes_(0),
+      staging_(nullptr),
+      staged_(0),
+      maxWriteMs_(0) {}
+
+WavWriter::~WavWriter() {
+    Close();
+}
+
+bool WavWriter::Open(const std::string& path, double sampleRate, int channels, SampleFormat format,
+                     bool dither, size_t blockBytes, double reserveSeconds) {
+    sampleRate_ = sampleRate;
+    channels_ = channels;
+    format_ = format;
+    dither_ = dither;
+    ditherState_.Seed(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(this)));
+    frameBytes_ = BytesPerSample(format) * channels;
+    blockBytes_ = std::max(kAlign, blockBytes / kAlign * kAlign);
+    reserveStep_ = static_cast<uint64_t>(reserveSeconds * sampleRate) * frameBytes_;
+    dataBytes_ = 0;
+    staged_ = 0;
+    maxWriteMs_ = 0;
+
+    size_t stagingBytes = AlignUp(blockBytes_ + kChunkFrames * frameBytes_ + 1);
+    stagingMemory_.assign(stagingBytes + kAlign, 0);
+    staging_ = stagingMemory_.data();
+    staging_ += (kAlign - reinterpret_cast<uintptr_t>(staging_) % kAlign) % kAlign;
+    interleaved_.assign(channels > 1 ? kChunkFrames * channels : 0, 0.0f);
+
+    file_.reset(new File());
+    if (!file_->Open(path) || !WriteHeader()) {
+        file_.reset();
+        return false;
+    }
+    allocated_ = kHeaderBytes + reserveStep_;
+    file_->Reserve(allocated_);
+    return true;
+}
+
+bool WavWriter::Append(const float* const* planes, size_t frames) {
+    DitherState* dither = dither_ ? &ditherState_ : nullptr;
+    for (size_t done = 0; done < frames;) {
+        size_t n = std::min(frames - done, kChunkFrames);
+        uint8_t* dst = staging_ + staged_;
+        if (channels_ == 1) {
+            Encode(planes[0] + done, dst, n, format_, dither);
+        } else {
+            float* interleaved = interleaved_.data();
+            for (int ch = 0; ch < channels_; ch++) {
+                const float* src = planes[ch] + done;
+                for (size_t i = 0; i < n; i++) {
+                    interleaved[i * channels_ + ch] = src[i];
+                }
+            }
+            Encode(interleaved, dst, n * channels_, format_, dither);
+        }
+        staged_ += n * frameBytes_;
+        if (staged_ >= blockBytes_ && !WriteStaged(false)) {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+bool WavWriter::Sync() {
+    // Aligned staged audio first, then the header with the sizes so far
+    return WriteStaged(false) && WriteHeader() && file_->Sync();
+}
+
+bool WavWriter::Finish() {
+    if (!file_) {
+        return false;
+    }
+    bool ok = WriteStaged(true) && WriteHeader() && file_->Sync();
+    if (ok) {
+        // A failed truncate only leaves reserved space; the header bounds the audio
+        file_->Truncate(kHeaderBytes + dataBytes_ + (dataBytes_ & 1));
+    }
+    Close();
+    return ok;
+}
+
+void WavWriter::Close() {
+    if (file_) {
+        file_->Close();
+        file_.reset();
+    }
+}
+
+bool WavWriter::WriteStaged(bool final) {
+    // Whole aligned blocks while recording; everything, padded to an even
+    // length as RIFF requires, at the end
+    size_t bytes = staged_;
+    size_t pad = 0;
+    if (final) {
+        pad = static_cast<size_t>((dataBytes_ + bytes) & 1);
+        staging_[bytes] = 0;
+    } else {
+        bytes -= bytes % kAlign;
+    }
+    size_t writeBytes = bytes + pad;
+    if (writeBytes == 0) {
+        return true;
+    }
+
+    uint64_t offset = kHeaderBytes + dataBytes_;
+    if (offset + writeBytes > allocated_) {
+        allocated_ = offset + std::max<uint64_t>(writeBytes, reserveStep_);
+        file_->Reserve(allocated_);
+    }
+
+    uint64_t begin = MonotonicNanos();
+    if (!file_->WriteAt(offset, staging_, writeBytes)) {
+        return false;
+    }
+    maxWriteMs_ = std::max(maxWriteMs_, (MonotonicNanos() - begin) / 1e6);
+
+    dataBytes_ += bytes;
+    staged_ -= bytes;
+    std::memmove(staging_, staging_ + bytes, staged_);
+    return true;
+}
+
+bool WavWriter::WriteHeader() {
+    uint8_t header[kHeaderBytes];
+    std::memset(header, 0, sizeof(header));
+    uint64_t dataBytes = dataBytes_;
+    uint64_t riffBytes = kHeaderBytes - 8 + dataBytes + (dataBytes & 1);
+    bool rf64 = riffBytes > kRiffLimit;
+    bool integer = format_ != SampleFormat::Float32;
+    uint32_t bits = static_cast<uint32_t>(BytesPerSample(format_) * 8);
+    bool extensible = channels_ > 2 || bits > 16;
+
+    PutTag(header, rf64 ? "RF64" : "RIFF");
+    PutLe(header + 4, rf64 ? kRiffLimit : riffBytes, 4);
+    PutTag(header + 8, "WAVE");
+
+    // ds64 when the sizes need 64 bits, a placeholder of the same size until then
+    uint8_t* p = header + 12;
+    PutTag(p, rf64 ? "ds64" : "JUNK");
+    PutLe(p + 4, 28, 4);
+    if (rf64) {
+        PutLe(p + 8, riffBytes, 8);
+        PutLe(p + 16, dataBytes, 8);
+        PutLe(p + 24, dataBytes / frameBytes_, 8);
+    }
+    p += 8 + 28;
+
+    PutTag(p, "fmt ");
+    PutLe(p + 4, extensible ? 40 : 16, 4);
+    PutLe(p + 8, extensible ? 0xFFFE : (integer ? 1 : 3), 2);
+    PutLe(p + 10, channels_, 2);
+    PutLe(p + 12, static_cast<uint32_t>(sampleRate_), 4);
+    PutLe(p + 16, static_cast<uint32_t>(sampleRate_) * frameBytes_, 4);
+    PutLe(p + 20, frameBytes_, 2);
+    PutLe(p + 22, bits, 2);
+    if (extensible) {
+        static const uint8_t kGuidTail[14] = {
+            0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+        };
+        PutLe(p + 24, 22, 2);           // Extension size
+        PutLe(p + 26, bits, 2);         // Valid bits
+        PutLe(p + 28, 0, 4);            // No speaker positions: discrete tracks
+        PutLe(p + 32, integer ? 1 : 3, 2);
+        std::memcpy(p + 34, kGuidTail, sizeof(kGuidTail));
+        p += 8 + 40;
+    } else {
+        p += 8 + 16;
+    }
+
+    // Pad so the audio starts on an aligned offset
+    uint8_t* data = header + kHeaderBytes - 8;
+    PutTag(p, "JUNK");
+    PutLe(p + 4, static_cast<uint64_t>(data - p - 8), 4);
+    PutTag(data, "data");
+    PutLe(data + 4, rf64 ? kRiffLimit : dataBytes, 4);
+
+    return file_->WriteAt(0, header, sizeof(header));
+}
@@ -0,0 +1,72 @@
+/**
+ * WavWriter - block-aligned WAV/RF64 file writer
+ *
+ * Encodes planar float audio to 16/24-bit PCM or float32 and writes it in
+ * large blocks at 4 KiB aligned file offsets (the header is padded to
+ * 4 KiB so the audio starts aligned), reserving file space ahead of the
+ * write position. Sync() writes out what is staged, rewrites the header
+ * with the sizes so far and flushes to disk, so a crash leaves a playable
+ * file. Files that outgrow 4 GB are promoted to RF64 (EBU Tech 3306)
+ * through a ds64 placeholder chunk.
+ *
+ * Not thread safe: use from one thread at a time.
+ */
+
+#ifndef WAV_WRITER_H
+#define WAV_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "sample_format.h"
+
+class WavWriter {
+public:
+    WavWriter();
+    ~WavWriter();
+
+    // Create the file and write an empty header. format is Int16, Int24 or
+    // Float32; blockBytes is rounded down to a multiple of 4 KiB.
+    bool Open(const std::string& path, double sampleRate, int channels, SampleFormat format,
+              bool dither, size_t blockBytes, double reserveSeconds);
+
+    // Encode frames from one array per channel, writing every full block
+    bool Append(const float* const* planes, size_t frames);
+    // Write the aligned part of what is staged, update the header, flush to disk
+    bool Sync();
+    // Write everything left, finalize the header, trim reserved space, close
+    bool Finish();
+    // Close without finalizing
+    void Close();
+
+    uint64_t DataBytes() const { return dataBytes_; }
+    double MaxWriteMs() const { return maxWriteMs_; }
+
+private:
+    class File;
+
+    bool WriteStaged(bool final);
+    bool WriteHeader();
+
+    std::unique_ptr<File> file_;
+    double sampleRate_;
+    int channels_;
+    SampleFormat format_;
+    bool dither_;
+    DitherState ditherState_;
+    size_t frameBytes_;
+    size_t blockBytes_;
+    uint64_t reserveStep_;          // Bytes reserved at a time
+    uint64_t allocated_;            // File bytes reserved so far
+    uint64_t dataBytes_;            // Audio bytes written
+
+    std::vector<uint8_t> stagingMemory_;
+    uint8_t* staging_;              // Aligned: one block, one more chunk, a pad byte
+    size_t staged_;
+    std::vector<float> interleaved_;    // Encoding scratch for multichannel files
+    double maxWriteMs_;
+};
+
+#endif // WAV_WRITER_H